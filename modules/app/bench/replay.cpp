@@ -0,0 +1,265 @@
+#include <tte/app/app.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/engine/trace.hpp>
+#include <tte/platform_layer/platform_layer.hpp>
+#include <tte/common/number_types.hpp>
+#include <tte/common/event.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// the app is built into the replayer as it is into tte (see main.cpp)
+#include "app.cpp"
+
+// tte_replay
+// replays traces recorded with tte --record-trace (see engine::TraceWriter) on the app, without a window unless --draw
+// is given, and prints the latency of handling each event as JSON:
+// {"benchmark": "tte_replay", "results": [{"trace": ..., "mode": ..., "events": ..., "p50_ns": ..., "p99_ns": ...,
+// "p999_ns": ..., "max_ns": ...}, ...]}
+// the records before the first event set up the buffer and cursor and are not measured. events go through
+// app::handle_event, except unknown events, which stand for input the app has no event for yet (e.g. a paste) and are
+// replayed from the engine calls recorded after them.
+//
+// usage: tte_replay [--engine | --draw] [--repeat N] trace...
+// --engine      replays every event from its recorded engine calls, without the app
+// --draw        gives the app a window of the headless platform layer (see platform_layer/headless.hpp), so each event
+//               is measured with the frame drawn after it
+// --repeat N    replays each trace N times, 1 by default
+//
+// bundled traces, in bench/traces:
+// typing.trace        typing and correcting prose in the middle of a small file
+// bulk_paste.trace    pasting blocks of 100 lines between bits of typing
+// mass_delete.trace   holding backspace, then deleting blocks of 150 lines of a 2000 line file
+
+namespace tte { namespace bench {
+    struct Options {
+        bool engine;
+        bool draw;
+        Length repeat;
+        // the traces are the rest of the arguments
+        int first_trace;
+    };
+
+    static bool first_result = true;
+
+    [[nodiscard]] static U64 get_nanoseconds() {
+        return static_cast<U64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                                    .count());
+    }
+
+    // applies the records up to the next event, from *index, which is left at the next event
+    [[nodiscard]] static bool apply_records(app::App& app,
+        const engine::TraceRecord* records,
+        const Length number_of_records,
+        const bool apply_engine_calls,
+        Length* index) {
+        for (; *index < number_of_records && records[*index].type != engine::TraceRecordType::Event; ++*index) {
+            const engine::TraceRecord& record = records[*index];
+            if (record.type == engine::TraceRecordType::Cursor) {
+                app.cursor = app::Cursor{record.line_index, record.character_index};
+            } else if (apply_engine_calls && !engine::apply_trace_record(*app.buffer, record)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the setup is mostly the lines of the buffer the trace starts from, which are inserted together, as inserting
+    // them one by one is quadratic
+    [[nodiscard]] static bool set_up(app::App& app,
+        const engine::TraceRecord* records,
+        const Length number_of_records,
+        Length* index) {
+        Length end = 0;
+        while (end < number_of_records && records[end].type == engine::TraceRecordType::InsertLine &&
+            records[end].line_index == records[0].line_index + end) {
+            ++end;
+        }
+
+        if (end != 0) {
+            const engine::Char** data_array = static_cast<const engine::Char**>(malloc(sizeof(engine::Char*) * end));
+            Length* data_length_array = static_cast<Length*>(malloc(sizeof(Length) * end));
+            for (Length i = 0; i < end; ++i) {
+                data_array[i] = records[i].data ? records[i].data : "";
+                data_length_array[i] = records[i].data_length;
+            }
+            const bool result =
+                engine::insert_lines(*app.buffer, end, records[0].line_index, data_array, data_length_array);
+            free(data_length_array);
+            free(static_cast<void*>(data_array));
+            if (!result) {
+                return false;
+            }
+        }
+
+        *index = end;
+        return apply_records(app, records, number_of_records, true, index);
+    }
+
+    static void close_window(app::App& app) {
+        if (app.font) {
+            platform_layer::close_font(&app.platform_layer, *app.font);
+            app.font = nullptr;
+        }
+        if (app.window) {
+            platform_layer::destroy_window(&app.platform_layer, *app.window);
+            app.window = nullptr;
+            platform_layer::deinit(&app.platform_layer);
+        }
+        free(static_cast<void*>(app.line_text));
+        app.line_text = nullptr;
+        free(static_cast<void*>(app.line_lengths));
+        app.line_lengths = nullptr;
+        free(static_cast<void*>(app.advances));
+        app.advances = nullptr;
+    }
+
+    // the window and font the app draws with, as app::init opens them
+    [[nodiscard]] static bool open_window(app::App& app) {
+        if (!platform_layer::init(&app.platform_layer)) {
+            return false;
+        }
+        app.window = platform_layer::create_window(&app.platform_layer, app::window_width, app::window_height);
+        if (!app.window) {
+            platform_layer::deinit(&app.platform_layer);
+            return false;
+        }
+        app.font = platform_layer::open_font(&app.platform_layer, nullptr, app.font_size);
+        if (!app.font) {
+            close_window(app);
+            return false;
+        }
+        return true;
+    }
+
+    // event_nanoseconds gets the time each event took, number_of_events the number of events
+    [[nodiscard]] static bool replay(const Options& options,
+        const engine::TraceRecord* records,
+        const Length number_of_records,
+        U64* event_nanoseconds,
+        Length* number_of_events) {
+        app::App app;
+        memset(static_cast<void*>(&app), 0, sizeof(app::App));
+        app.font_size = 16;
+        app.buffer = &engine::create_buffer();
+
+        Length index;
+        *number_of_events = 0;
+        bool result = (!options.draw || open_window(app)) && set_up(app, records, number_of_records, &index);
+        while (result && index < number_of_records) {
+            const common::Event& event = records[index].event;
+            ++index;
+            const bool from_engine_calls = options.engine || event.type == common::Event::Type::Unknown;
+            const U64 start = get_nanoseconds();
+            if (!from_engine_calls) {
+                app::handle_event(&app, event);
+            } else {
+                // the app did not see what the engine calls change
+                app.redraw = true;
+            }
+            result = apply_records(app, records, number_of_records, from_engine_calls, &index);
+            // as app::run draws after the events it handled. without a window the frame ends undrawn.
+            if (options.draw) {
+                app::draw(&app);
+            } else {
+                app::end_frame(&app);
+            }
+            event_nanoseconds[*number_of_events] = get_nanoseconds() - start;
+            ++*number_of_events;
+        }
+
+        close_window(app);
+        engine::destroy_buffer(*app.buffer);
+        return result;
+    }
+
+    // nearest rank
+    [[nodiscard]] static U64 get_percentile(const U64* sorted, const Length length, const Length per_mille) {
+        const Length rank = (length * per_mille + 999) / 1000;
+        return sorted[rank == 0 ? 0 : rank - 1];
+    }
+
+    [[nodiscard]] static bool replay_trace(const Options& options, const char* path) {
+        engine::Trace* trace = engine::load_trace(path);
+        if (!trace) {
+            fprintf(stderr, "failed to load trace: %s\n", path);
+            return false;
+        }
+
+        Length number_of_records;
+        const engine::TraceRecord* records = engine::get_trace_records(*trace, &number_of_records);
+        // at most one event per record
+        U64* event_nanoseconds = static_cast<U64*>(malloc(sizeof(U64) * (number_of_records * options.repeat + 1)));
+        Length number_of_events = 0;
+        bool result = true;
+        for (Length i = 0; i < options.repeat && result; ++i) {
+            Length replayed;
+            result = replay(options, records, number_of_records, event_nanoseconds + number_of_events, &replayed);
+            number_of_events += replayed;
+        }
+        engine::destroy_trace(*trace);
+
+        if (result && number_of_events == 0) {
+            fprintf(stderr, "trace has no events: %s\n", path);
+            result = false;
+        } else if (!result) {
+            fprintf(stderr, "failed to replay trace: %s\n", path);
+        } else {
+            std::sort(event_nanoseconds, event_nanoseconds + number_of_events);
+            printf("%s\n        {\"trace\": \"%s\", \"mode\": \"%s\", \"events\": %llu, \"p50_ns\": %llu, "
+                   "\"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}",
+                first_result ? "" : ",",
+                path,
+                options.engine ? "engine" : (options.draw ? "app_draw" : "app"),
+                static_cast<unsigned long long>(number_of_events),
+                static_cast<unsigned long long>(get_percentile(event_nanoseconds, number_of_events, 500)),
+                static_cast<unsigned long long>(get_percentile(event_nanoseconds, number_of_events, 990)),
+                static_cast<unsigned long long>(get_percentile(event_nanoseconds, number_of_events, 999)),
+                static_cast<unsigned long long>(event_nanoseconds[number_of_events - 1]));
+            fflush(stdout);
+            first_result = false;
+        }
+
+        free(event_nanoseconds);
+        return result;
+    }
+
+    [[nodiscard]] static bool parse_options(const int argc, char** argv, Options* options) {
+        options->engine = false;
+        options->draw = false;
+        options->repeat = 1;
+        int i = 1;
+        for (; i < argc && strncmp(argv[i], "--", 2) == 0; ++i) {
+            if (strcmp(argv[i], "--engine") == 0) {
+                options->engine = true;
+            } else if (strcmp(argv[i], "--draw") == 0) {
+                options->draw = true;
+            } else if (i + 1 < argc && strcmp(argv[i], "--repeat") == 0) {
+                options->repeat = strtoull(argv[++i], nullptr, 10);
+            } else {
+                return false;
+            }
+        }
+        options->first_trace = i;
+        return options->repeat != 0 && !(options->engine && options->draw) && i < argc;
+    }
+}}
+
+int main(int argc, char** argv) {
+    tte::bench::Options options;
+    if (!tte::bench::parse_options(argc, argv, &options)) {
+        fprintf(stderr, "usage: %s [--engine | --draw] [--repeat N] trace...\n", argv[0]);
+        return 1;
+    }
+
+    bool result = true;
+    printf("{\n    \"benchmark\": \"tte_replay\",\n    \"results\": [");
+    for (int i = options.first_trace; i < argc; ++i) {
+        result = tte::bench::replay_trace(options, argv[i]) && result;
+    }
+    printf("\n    ]\n}\n");
+    return result ? 0 : 1;
+}
@@ -4,7 +4,13 @@
 #include <tte/common/number_types.hpp>
 #include <tte/common/event.hpp>
 #include <tte/platform_layer/platform_layer.hpp>
+#include <tte/platform_layer/ttf.hpp>
 #include <tte/engine/engine.hpp>
+#include <tte/engine/file.hpp>
+#include <tte/engine/journal.hpp>
+#include <tte/engine/trace.hpp>
+#include <tte/engine/watch.hpp>
+#include <tte/engine/workspace.hpp>
 
 namespace tte { namespace app {
     struct Cursor {
@@ -16,10 +22,60 @@ namespace tte { namespace app {
         bool running;
         U32 font_size;
         platform_layer::Window* window;
+        engine::Workspace* workspace;
+        // may be nullptr, then the buffer is not backed by a file, not journaled and not owned by the workspace
+        engine::Document* document;
+        // buffer and journal of the current document, valid until the next call into the workspace
         engine::Buffer* buffer;
+        // may be nullptr, then the buffer is not backed by a file and not journaled
+        const char* file_path;
+        engine::Journal* journal;
+        // not nullptr while the file is loading
+        engine::FileLoad* file_load;
+        // not nullptr while the buffer follows changes to the file, which stops at the first edit
+        engine::FileWatch* file_watch;
+        // set before init to show the end of file_path as it grows (e.g. a log), see engine::follow_file. the buffer is
+        // not journaled and stops following at the first edit.
+        bool follow;
+        // 0 for no limit
+        Length follow_max_lines;
+        // set before init to record a trace of the session to (see engine::TraceWriter). the recording starts at the
+        // first edit after the file loaded, from the buffer and cursor at that point.
+        const char* trace_path;
+        // not nullptr while recording
+        engine::TraceWriter* trace;
         Cursor cursor;
+        // the row of the document at the top of the window, in pixels. edits scroll to the cursor.
+        Length scroll_y;
+        // what draw draws: the whole window if redraw, else the lines from damage_begin_line to damage_end_line, the
+        // lines the cursor moved from and to and the rows scrolling uncovered since the last frame
+        bool redraw;
+        Length damage_begin_line;
+        Length damage_end_line;
+        Cursor drawn_cursor;
+        Length drawn_scroll_y;
+        // see compress_cold_lines
+        U64 last_compress_milliseconds;
+        // the lines being drawn, one after another and each null terminated, and their lengths. reused between draws
+        // so drawing does not allocate.
+        char* line_text;
+        Length line_text_capacity;
+        Length* line_lengths;
+        Length line_lengths_capacity;
+        // the x of each byte of line advances_line and of its end, from platform_layer::get_advances, so the x of the
+        // cursor is a lookup while the cursor stays on the line. valid until an edit changes the line or the buffer
+        // changes otherwise (see redraw).
+        U32* advances;
+        Length advances_capacity;
+        Length advances_length;
+        Length advances_line;
+        bool advances_valid;
+        // the fonts of the font index, each opened when first used (see get_font), then the built-in font of the
+        // platform layer, so num_fonts + 1 of them, nullptr until opened
+        ttf::FontIndex* font_index;
         Length num_fonts;
-        platform_layer::Font* fonts;
+        platform_layer::Font** fonts;
+        // the font drawn with, one of fonts
         platform_layer::Font* font;
         platform_layer::PlatformLayer platform_layer;
     };
@@ -6,145 +6,805 @@
 #include <tte/common/assert.hpp>
 #include <tte/common/event.hpp>
 #include <tte/engine/engine.hpp>
+#include <tte/engine/file.hpp>
+#include <tte/engine/journal.hpp>
+#include <tte/engine/snapshot.hpp>
+#include <tte/engine/trace.hpp>
+#include <tte/engine/watch.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
-// TODO(TB): remove this include
-#include <filesystem>
+#include <cstring>
+#include <sys/stat.h>
 
 namespace tte { namespace app {
-    INIT_FUNCTION(init) {
-        const std::filesystem::path fonts_directory_path(
-            std::filesystem::relative(std::filesystem::path("resources/fonts")));
-        if (std::filesystem::directory_entry(fonts_directory_path).is_directory()) {
-            for (const auto& x : std::filesystem::directory_iterator(fonts_directory_path)) {
-                if (x.is_regular_file() && x.path().extension() == ".ttf") {
-                    printf(x.path().c_str());
-                    ttf::parse_file(std::filesystem::absolute(x.path()).c_str());
-                }
-            }
+    // #region internal
+    static const constexpr U64 journal_fsync_interval_milliseconds = 1000;
+    static const constexpr Length workspace_memory_budget = 512 * 1024 * 1024;
+    static const constexpr U32 window_width = 640;
+    static const constexpr U32 window_height = 480;
+    static const constexpr U32 load_progress_height = 4;
+    // lines further than this from the window are compressed, every compress_interval_milliseconds
+    static const constexpr Length cold_line_distance = 1024;
+    static const constexpr U64 compress_interval_milliseconds = 10000;
+    static const constexpr U64 watch_poll_interval_milliseconds = 100;
+    static const constexpr char* fonts_directory_path = "resources/fonts";
+    // see ttf::load_font_index
+    static const constexpr char* font_index_path = "resources/fonts.index";
+
+    // app state stored next to the buffer in the session file
+    struct Session {
+        Cursor cursor;
+        // the base file and journal the buffer in the session was made from
+        U64 base_size;
+        S64 base_modification_time_seconds;
+        S64 base_modification_time_nanoseconds;
+        Length journal_size;
+    };
+
+    // caller owns returned memory
+    [[nodiscard]] static char* append_extension(const char* path, const char* extension) {
+        const Length path_length = strlen(path);
+        const Length extension_length = strlen(extension);
+        char* result = static_cast<char*>(malloc(sizeof(char) * (path_length + extension_length + 1)));
+        memcpy(result, path, path_length);
+        memcpy(result + path_length, extension, extension_length + 1);
+        return result;
+    }
+
+    static void get_base_identity(
+        const char* path, U64* size, S64* modification_time_seconds, S64* modification_time_nanoseconds) {
+        struct stat data;
+        if (stat(path, &data) == 0) {
+            *size = static_cast<U64>(data.st_size);
+#if defined(__APPLE__)
+            *modification_time_seconds = static_cast<S64>(data.st_mtimespec.tv_sec);
+            *modification_time_nanoseconds = static_cast<S64>(data.st_mtimespec.tv_nsec);
+#else
+            *modification_time_seconds = static_cast<S64>(data.st_mtim.tv_sec);
+            *modification_time_nanoseconds = static_cast<S64>(data.st_mtim.tv_nsec);
+#endif
+        } else {
+            *size = 0;
+            *modification_time_seconds = 0;
+            *modification_time_nanoseconds = 0;
         }
+    }
 
-        if (!platform_layer::init(&app->platform_layer)) {
+    // restores app->buffer, app->journal and app->cursor from the session file without reading the base file or
+    // replaying the journal. the session is only used when the base file and journal are unchanged since it was
+    // written, and is removed once used so a crash later in this session falls back to the journal.
+    [[nodiscard]] static bool restore_session(App* app, const char* session_path, const char* journal_path) {
+        engine::Snapshot* snapshot = engine::open_snapshot(session_path);
+        if (!snapshot) {
             return false;
         }
 
-        app->font_size = 16;
-        app->buffer = &engine::create_buffer();
+        Session session;
+        U64 base_size;
+        S64 base_modification_time_seconds;
+        S64 base_modification_time_nanoseconds;
+        Length user_data_size;
+        const void* user_data = engine::get_snapshot_user_data(*snapshot, &user_data_size);
+        get_base_identity(
+            app->file_path, &base_size, &base_modification_time_seconds, &base_modification_time_nanoseconds);
+        bool valid = user_data_size == sizeof(Session);
+        if (valid) {
+            memcpy(&session, user_data, sizeof(Session));
+            valid = session.base_size == base_size &&
+                session.base_modification_time_seconds == base_modification_time_seconds &&
+                session.base_modification_time_nanoseconds == base_modification_time_nanoseconds;
+        }
 
-        if (!engine::insert_empty_line(*app->buffer, 0)) {
-            engine::destroy_buffer(*app->buffer);
-            platform_layer::deinit(&app->platform_layer);
+        engine::Journal* journal = nullptr;
+        if (valid) {
+            journal = engine::open_journal(journal_path, app->file_path, journal_fsync_interval_milliseconds);
+            valid = journal && engine::get_journal_size(*journal) == session.journal_size;
+        }
+
+        engine::Buffer* buffer = valid ? engine::create_buffer_from_snapshot(*snapshot) : nullptr;
+        engine::close_snapshot(*snapshot);
+        remove(session_path);
+        if (!buffer) {
+            if (journal) {
+                engine::close_journal(*journal);
+            }
             return false;
         }
 
-        app->window = platform_layer::create_window(&app->platform_layer, 640, 480);
-        if (!app->window) {
+        app->buffer = buffer;
+        app->journal = journal;
+        app->cursor = session.cursor;
+        return true;
+    }
+
+    static void save_session(App* app) {
+        if (!app->file_path || !app->journal || !engine::sync_journal(*app->journal)) {
+            return;
+        }
+
+        char* session_path = append_extension(app->file_path, ".session");
+        Session session;
+        session.cursor = app->cursor;
+        get_base_identity(app->file_path,
+            &session.base_size,
+            &session.base_modification_time_seconds,
+            &session.base_modification_time_nanoseconds);
+        session.journal_size = engine::get_journal_size(*app->journal);
+        if (!engine::write_snapshot(*app->buffer, session_path, &session, sizeof(Session))) {
+            TTE_DBG("Failed to write session: %s", session_path);
+        }
+        free(session_path);
+    }
+
+    static void stop_watch(App* app) {
+        if (app->file_watch) {
+            engine::unwatch_file(*app->file_watch);
+            app->file_watch = nullptr;
+        }
+    }
+
+    static void close_buffer(App* app) {
+        stop_watch(app);
+        if (app->file_load) {
+            engine::finish_file_load(*app->file_load);
+            app->file_load = nullptr;
+        }
+        if (app->document) {
+            // the workspace owns the buffer and journal
+            engine::close_document(*app->workspace, *app->document);
+            app->document = nullptr;
+        } else {
             engine::destroy_buffer(*app->buffer);
-            platform_layer::deinit(&app->platform_layer);
+        }
+        app->buffer = nullptr;
+        app->journal = nullptr;
+    }
+
+    // record_*
+    // records an edit of app->buffer in its journal and the trace being recorded
+    static void record_insert_empty_lines(App* app, const Length number_of_lines, const Length line_index) {
+        if (app->journal) {
+            engine::record_insert_empty_lines(*app->journal, number_of_lines, line_index);
+        }
+        if (app->trace) {
+            engine::trace_insert_empty_lines(*app->trace, number_of_lines, line_index);
+        }
+    }
+
+    static void record_insert_characters(App* app,
+        const Length line_index,
+        const Length character_index,
+        const char* data,
+        const Length data_length) {
+        if (app->journal) {
+            engine::record_insert_characters(*app->journal, line_index, character_index, data, data_length);
+        }
+        if (app->trace) {
+            engine::trace_insert_characters(*app->trace, line_index, character_index, data, data_length);
+        }
+    }
+
+    static void record_delete_characters(App* app,
+        const Length number_of_characters,
+        const Length line_index,
+        const Length character_index) {
+        if (app->journal) {
+            engine::record_delete_characters(*app->journal, number_of_characters, line_index, character_index);
+        }
+        if (app->trace) {
+            engine::trace_delete_characters(*app->trace, number_of_characters, line_index, character_index);
+        }
+    }
+
+    static void record_merge_lines(App* app, const Length line_index) {
+        if (app->journal) {
+            engine::record_merge_lines(*app->journal, line_index);
+        }
+        if (app->trace) {
+            engine::trace_merge_lines(*app->trace, line_index);
+        }
+    }
+
+    // records the buffer and cursor the trace starts from
+    static void start_trace(App* app) {
+        app->trace = engine::open_trace_writer(app->trace_path);
+        if (!app->trace) {
+            TTE_DBG("Failed to record trace: %s", app->trace_path);
+        } else {
+            engine::trace_buffer(*app->trace, *app->buffer);
+            engine::trace_cursor(*app->trace, app->cursor.line, app->cursor.character);
+        }
+        app->trace_path = nullptr;
+    }
+
+    // the cursor needs a line
+    [[nodiscard]] static bool ensure_line(App* app) {
+        if (engine::get_buffer_length(*app->buffer) != 0) {
+            return true;
+        }
+        if (!engine::insert_empty_line(*app->buffer, 0)) {
             return false;
         }
+        record_insert_empty_lines(app, 1, 0);
+        return true;
+    }
 
-        app->num_fonts = get_fonts(&app->platform_layer, &app->fonts, app->font_size);
+    // creates app->buffer from app->file_path and the edits in its journal that were not saved yet. without edits to
+    // replay the file is loaded in the background (see poll_load), so opening never waits for the whole file.
+    [[nodiscard]] static bool open_buffer(App* app) {
+        app->document = nullptr;
+        app->buffer = nullptr;
+        app->journal = nullptr;
+        app->file_load = nullptr;
+        app->file_watch = nullptr;
+        if (app->file_path && app->follow) {
+            app->buffer = &engine::create_buffer();
+            // logs repeat many of their lines
+            engine::enable_line_interning(*app->buffer);
+            app->file_watch = engine::follow_file(app->file_path, app->follow_max_lines);
+            if (!app->file_watch) {
+                TTE_DBG("Failed to follow file: %s", app->file_path);
+                close_buffer(app);
+                return false;
+            }
+            // the lines are read by poll_watch
+            return true;
+        } else if (app->file_path) {
+            char* journal_path = append_extension(app->file_path, ".journal");
+            char* session_path = append_extension(app->file_path, ".session");
+            if (restore_session(app, session_path, journal_path)) {
+                app->document = &engine::adopt_document(*app->workspace, app->file_path, *app->buffer, app->journal);
+                // without edits the session holds the file as it was, so the buffer can follow it
+                if (!engine::has_journal_records(journal_path) && engine::get_buffer_length(*app->buffer) != 0) {
+                    app->file_watch = engine::watch_file(app->file_path);
+                }
+            } else if (!engine::has_journal_records(journal_path)) {
+                app->buffer = &engine::create_buffer();
+                app->journal = engine::open_journal(journal_path, app->file_path, journal_fsync_interval_milliseconds);
+                app->file_load = &engine::start_file_load(app->file_path);
+                app->document = &engine::adopt_document(*app->workspace, app->file_path, *app->buffer, app->journal);
+            } else {
+                // when the file can not be loaded it is a new file
+                app->document = &engine::open_document(*app->workspace, app->file_path, false);
+                app->buffer = &engine::get_document_buffer(*app->workspace, *app->document);
+                app->journal = engine::get_document_journal(*app->document);
+            }
+            free(session_path);
+            free(journal_path);
+        } else {
+            app->buffer = &engine::create_buffer();
+        }
 
-    #if TTE_SDL
-        if (app->num_fonts == 0) {
-            TTE_DBG("Could not find any fonts");
-            platform_layer::destroy_window(*app->window);
-            engine::destroy_buffer(*app->buffer);
-            platform_layer::deinit();
+        if (!app->file_load && !ensure_line(app)) {
+            close_buffer(app);
             return false;
         }
-    #endif
+        return true;
+    }
+
+    // appends the lines loaded so far
+    static void poll_load(App* app) {
+        if (!app->file_load || !engine::poll_file_load(*app->file_load, *app->buffer)) {
+            return;
+        }
+
+        if (!engine::file_load_succeeded(*app->file_load)) {
+            // same as a file that can not be loaded, it is a new file
+            TTE_DBG("Failed to load file: %s", app->file_path);
+        }
+        engine::finish_file_load(*app->file_load);
+        app->file_load = nullptr;
+        // an empty file gets a line that is not in the file, so the buffer would not match it
+        if (!app->file_watch && engine::get_buffer_length(*app->buffer) != 0) {
+            app->file_watch = engine::watch_file(app->file_path);
+        }
+        if (!ensure_line(app)) {
+            TTE_DBG("Failed to insert line");
+        }
+    }
+
+    // while the file is loading the rest of it is appended after the last line, which has to stay the last line for
+    // the journal to match the file, so only the lines before it can be edited
+    [[nodiscard]] static bool can_edit(App* app) {
+        return !app->file_load || app->cursor.line + 1 < engine::get_buffer_length(*app->buffer);
+    }
+
+    // the number of lines that fit in the window
+    [[nodiscard]] static Length get_visible_lines(App* app) { return window_height / app->font_size + 1; }
+
+    // the first line in the window, which may be partly above it
+    [[nodiscard]] static Length get_scroll_line(App* app) { return app->scroll_y / app->font_size; }
+
+    // scrolls as little as it takes for the whole cursor line to be in the window
+    static void scroll_to_cursor(App* app) {
+        const Length cursor_y = app->cursor.line * app->font_size;
+        if (cursor_y < app->scroll_y) {
+            app->scroll_y = cursor_y;
+        } else if (cursor_y + app->font_size > app->scroll_y + window_height) {
+            app->scroll_y = cursor_y + app->font_size - window_height;
+        }
+    }
+
+    // applies changes other programs made to the file
+    // returns true if the buffer changed
+    [[nodiscard]] static bool poll_watch(App* app) {
+        const engine::FileChange change = engine::poll_file_watch(*app->file_watch, *app->buffer);
+        if (change == engine::FileChange::None) {
+            return false;
+        }
+        if (app->follow) {
+            if (change == engine::FileChange::Failed) {
+                TTE_DBG("Failed to follow file: %s", app->file_path);
+                stop_watch(app);
+            }
+            // scrolls to the end
+            const Length buffer_length = engine::get_buffer_length(*app->buffer);
+            app->cursor = Cursor{buffer_length == 0 ? 0 : buffer_length - 1, 0};
+            scroll_to_cursor(app);
+            return true;
+        }
+        if (change == engine::FileChange::Failed) {
+            TTE_DBG("Failed to follow file: %s", app->file_path);
+            stop_watch(app);
+        } else if (app->journal && !engine::reset_journal(*app->journal)) {
+            // the buffer is the file again, so the journal must have nothing to replay on top of it
+            TTE_DBG("Failed to reset journal");
+        }
 
-        app->font = app->fonts;
+        const Length buffer_length = engine::get_buffer_length(*app->buffer);
+        if (buffer_length == 0) {
+            stop_watch(app);
+            app->cursor = Cursor{0, 0};
+            if (!ensure_line(app)) {
+                TTE_DBG("Failed to insert line");
+            }
+        } else if (app->cursor.line >= buffer_length) {
+            app->cursor.line = buffer_length - 1;
+            app->cursor.character = 0;
+        } else {
+            app->cursor.character =
+                std::min(app->cursor.character, engine::get_line_length(*app->buffer, app->cursor.line));
+        }
         return true;
     }
 
-    DEINIT_FUNCTION(deinit) {
-        free(app->fonts);
-        platform_layer::destroy_window(&app->platform_layer, *app->window);
-        engine::destroy_buffer(*app->buffer);
-        platform_layer::deinit(&app->platform_layer);
+    [[nodiscard]] static U64 get_milliseconds() {
+        return static_cast<U64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                                    .count());
     }
 
-    DRAW_FUNCTION(draw) {
-        platform_layer::clear_buffer(&app->platform_layer, *app->window, 0xFF, 0x00, 0xFF, 0xFF);
-        Length buffer_length = engine::get_buffer_length(*app->buffer);
-
-        if (app->cursor.line < buffer_length) {
-            char* line = engine::line_to_c_string(*app->buffer, app->cursor.line);
-            TTE_ASSERT(line);
-            U32 x = platform_layer::get_cursor_x(&app->platform_layer, *app->font, line, app->cursor.character);
-            free(static_cast<void*>(line));
-            U32 y = static_cast<U32>(app->cursor.line * app->font_size);
+    // compresses the lines far from the window, which were not viewed or edited for a while (e.g. most of a large log)
+    static void compress_cold_lines(App* app) {
+        const U64 now = get_milliseconds();
+        if (now - app->last_compress_milliseconds < compress_interval_milliseconds) {
+            return;
+        }
+        app->last_compress_milliseconds = now;
+
+        const Length buffer_length = engine::get_buffer_length(*app->buffer);
+        const Length scroll_line = get_scroll_line(app);
+        const Length hot_begin = scroll_line > cold_line_distance ? scroll_line - cold_line_distance : 0;
+        const Length hot_end = std::min(buffer_length, scroll_line + get_visible_lines(app) + cold_line_distance);
+        if (hot_end < buffer_length && !engine::compress_lines(*app->buffer, buffer_length - hot_end, hot_end)) {
+            TTE_DBG("Failed to compress lines");
+        }
+        if (!engine::compress_lines(*app->buffer, hot_begin, 0)) {
+            TTE_DBG("Failed to compress lines");
+        }
+    }
+
+    // reads the lines from line_index into app->line_text and app->line_lengths, with one walk of the buffer
+    static void read_lines(App* app, const Length number_of_lines, const Length line_index) {
+        if (number_of_lines > app->line_lengths_capacity) {
+            free(static_cast<void*>(app->line_lengths));
+            app->line_lengths_capacity = std::max(number_of_lines, app->line_lengths_capacity * 2);
+            app->line_lengths = static_cast<Length*>(malloc(sizeof(Length) * app->line_lengths_capacity));
+        }
+        for (;;) {
+            const Length size = engine::copy_lines(*app->buffer,
+                number_of_lines,
+                line_index,
+                app->line_text,
+                app->line_text_capacity,
+                app->line_lengths);
+            if (size <= app->line_text_capacity) {
+                return;
+            }
+            free(static_cast<void*>(app->line_text));
+            app->line_text_capacity = std::max(size, app->line_text_capacity * 2);
+            app->line_text = static_cast<char*>(malloc(sizeof(char) * app->line_text_capacity));
+        }
+    }
+
+    // fills the part of the rectangle in the window
+    static void fill_window_rect(App* app, U32 x, S64 y, U32 width, S64 height, U8 r, U8 g, U8 b) {
+        const S64 begin_y = std::max<S64>(y, 0);
+        const S64 end_y = std::min<S64>(y + height, window_height);
+        if (begin_y < end_y) {
             platform_layer::fill_rect(&app->platform_layer,
                 *app->window,
                 x,
-                y,
-                static_cast<U32>(app->font_size * 0.1f),
-                app->font_size,
-                0xFF,
-                0,
-                0);
+                static_cast<U32>(begin_y),
+                width,
+                static_cast<U32>(end_y - begin_y),
+                r,
+                g,
+                b);
+        }
+    }
+
+    // the x in the window of the character at character_index of the line at line_index, whose text is line
+    [[nodiscard]] static U32 get_character_x(App* app,
+        const Length line_index,
+        const char* line,
+        const Length line_length,
+        const Length character_index) {
+        if (!app->advances_valid || app->advances_line != line_index) {
+            if (line_length + 1 > app->advances_capacity) {
+                free(static_cast<void*>(app->advances));
+                app->advances_capacity = std::max(line_length + 1, app->advances_capacity * 2);
+                app->advances = static_cast<U32*>(malloc(sizeof(U32) * app->advances_capacity));
+            }
+            platform_layer::get_advances(&app->platform_layer, *app->font, line, line_length, app->advances);
+            app->advances_length = line_length;
+            app->advances_line = line_index;
+            app->advances_valid = true;
+        }
+        TTE_ASSERT(app->advances_length == line_length);
+        return app->advances[std::min(character_index, app->advances_length)];
+    }
+
+    // draws the lines in the rows from begin_y to end_y of the window, all of each line, with their background if
+    // fill_background
+    static void draw_lines(App* app, const U32 begin_y, const U32 end_y, const bool fill_background) {
+        // only the lines in the rows are read and drawn
+        const Length buffer_length = engine::get_buffer_length(*app->buffer);
+        const Length first_line = (app->scroll_y + begin_y) / app->font_size;
+        const Length end_line = std::min(buffer_length, (app->scroll_y + end_y + app->font_size - 1) / app->font_size);
+        const Length number_of_lines = end_line > first_line ? end_line - first_line : 0;
+        const S64 first_line_y = static_cast<S64>(first_line * app->font_size) - static_cast<S64>(app->scroll_y);
+        if (fill_background) {
+            const S64 fill_begin_y = std::min<S64>(begin_y, first_line_y);
+            const S64 fill_end_y =
+                std::max<S64>(end_y, first_line_y + static_cast<S64>(number_of_lines * app->font_size));
+            fill_window_rect(app, 0, fill_begin_y, window_width, fill_end_y - fill_begin_y, 0xFF, 0x00, 0xFF);
         }
+        read_lines(app, number_of_lines, first_line);
 
-        for (Length i = 0; i < buffer_length; ++i) {
-            if (!engine::line_empty(*app->buffer, i)) {
-                char* line = engine::line_to_c_string(*app->buffer, i);
-                TTE_ASSERT(line);
-#if TTE_SDL
-                platform_layer::render_text(*app->window,
+        const char* line = app->line_text;
+        for (Length i = 0; i < number_of_lines; ++i) {
+            const S64 y = first_line_y + static_cast<S64>(i * app->font_size);
+            if (first_line + i == app->cursor.line) {
+                const U32 x = get_character_x(app, first_line + i, line, app->line_lengths[i], app->cursor.character);
+                fill_window_rect(app,
+                    x,
+                    y,
+                    static_cast<U32>(static_cast<float>(app->font_size) * 0.1f),
+                    app->font_size,
+                    0xFF,
+                    0,
+                    0);
+            }
+            if (app->line_lengths[i] != 0) {
+                platform_layer::render_text(&app->platform_layer,
+                    *app->window,
                     *app->font,
                     line,
                     0,
-                    static_cast<S32>(i * app->font_size),
+                    static_cast<S32>(y),
                     0xFF,
                     0x39,
                     0xA1);
-#endif
-                free(static_cast<void*>(line));
             }
+            line += app->line_lengths[i] + 1;
+        }
+    }
+
+    // marks the lines from begin_line to end_line to be drawn in the next frame, with the lines marked before
+    static void damage_lines(App* app, const Length begin_line, const Length end_line) {
+        if (app->damage_begin_line == app->damage_end_line) {
+            app->damage_begin_line = begin_line;
+            app->damage_end_line = end_line;
+        } else {
+            app->damage_begin_line = std::min(app->damage_begin_line, begin_line);
+            app->damage_end_line = std::max(app->damage_end_line, end_line);
+        }
+    }
+
+    // marks the lines from begin_line to end_line, which an edit changed, and scrolls to the cursor the edit moved.
+    // the buffer no longer matches the file, so the file is no longer watched or followed.
+    static void edit_lines(App* app, const Length begin_line, const Length end_line) {
+        stop_watch(app);
+        app->follow = false;
+        scroll_to_cursor(app);
+        damage_lines(app, begin_line, end_line);
+        if (app->advances_line >= begin_line && app->advances_line < end_line) {
+            app->advances_valid = false;
+        }
+    }
+
+    // scrolls dy pixels towards the end of the document, no further than its last line at the bottom of the window
+    static void scroll(App* app, const S64 dy) {
+        const Length document_height = engine::get_buffer_length(*app->buffer) * app->font_size;
+        const S64 max_scroll_y = document_height > window_height ? static_cast<S64>(document_height - window_height) : 0;
+        const S64 scroll_y = std::min(std::max<S64>(static_cast<S64>(app->scroll_y) + dy, 0), max_scroll_y);
+        app->scroll_y = static_cast<Length>(scroll_y);
+    }
+
+    // the next frame draws what changed since this one
+    static void end_frame(App* app) {
+        app->redraw = false;
+        app->damage_begin_line = 0;
+        app->damage_end_line = 0;
+        app->drawn_cursor = app->cursor;
+        app->drawn_scroll_y = app->scroll_y;
+    }
+
+    // draws the whole window, and the load progress over its bottom while a file loads
+    static void draw_whole(App* app) {
+        // the buffer may have changed without an edit (e.g. a file loaded)
+        if (app->redraw) {
+            app->advances_valid = false;
+        }
+        platform_layer::clear_buffer(&app->platform_layer, *app->window, 0xFF, 0x00, 0xFF, 0xFF);
+        draw_lines(app, 0, window_height, false);
+
+        if (app->file_load) {
+            Length loaded_size;
+            Length file_size;
+            engine::get_file_load_progress(*app->file_load, &loaded_size, &file_size);
+            const U32 width =
+                file_size == 0 ? 0 : static_cast<U32>(static_cast<U64>(window_width) * loaded_size / file_size);
+            platform_layer::fill_rect(&app->platform_layer,
+                *app->window,
+                0,
+                window_height - load_progress_height,
+                width,
+                load_progress_height,
+                0xFF,
+                0x39,
+                0xA1);
         }
 
         platform_layer::show_buffer(&app->platform_layer, *app->window);
+        end_frame(app);
+    }
+
+    // how long run can wait for events: not at all while a file loads or the file watch has more of the file to read,
+    // and no longer than the file watch and the journal can wait to be polled and committed
+    [[nodiscard]] static U64 get_wait_milliseconds(App* app) {
+        if (app->file_load || (app->file_watch && engine::is_file_watch_pending(*app->file_watch))) {
+            return 0;
+        }
+        return app->file_watch ? watch_poll_interval_milliseconds : journal_fsync_interval_milliseconds;
+    }
+
+    // the font at index of the font index, or the built-in font of the platform layer for num_fonts, opened the first
+    // time it is asked for. nullptr if it cannot be opened.
+    [[nodiscard]] static platform_layer::Font* get_font(App* app, const Length index) {
+        TTE_ASSERT(index <= app->num_fonts);
+        if (!app->fonts[index]) {
+            const char* path = index < app->num_fonts ? ttf::get_font_path(*app->font_index, index) : nullptr;
+            app->fonts[index] = platform_layer::open_font(&app->platform_layer, path, app->font_size);
+        }
+        return app->fonts[index];
+    }
+
+    // opens the font to draw with, chosen from the font index without opening the others: the first monospaced regular
+    // font, else the first monospaced font, else the first font. if it cannot be opened the others are tried in order,
+    // then the built-in font.
+    [[nodiscard]] static platform_layer::Font* open_chosen_font(App* app) {
+        Length chosen = app->num_fonts;
+        U32 chosen_rank = 0;
+        for (Length i = 0; i < app->num_fonts; ++i) {
+            const ttf::FontInfo& info = ttf::get_font_info(*app->font_index, i);
+            const bool regular = strcmp(info.subfamily, "Regular") == 0 || strcmp(info.subfamily, "Book") == 0;
+            const U32 rank = (info.monospaced ? 2u : 0u) + (regular ? 1u : 0u);
+            if (chosen == app->num_fonts || rank > chosen_rank) {
+                chosen = i;
+                chosen_rank = rank;
+            }
+        }
+
+        if (platform_layer::Font* font = get_font(app, chosen)) {
+            return font;
+        }
+        for (Length i = 0; i <= app->num_fonts; ++i) {
+            if (i != chosen) {
+                if (platform_layer::Font* font = get_font(app, i)) {
+                    return font;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    static void close_fonts(App* app) {
+        for (Length i = 0; i <= app->num_fonts; ++i) {
+            if (app->fonts[i]) {
+                platform_layer::close_font(&app->platform_layer, *app->fonts[i]);
+            }
+        }
+        free(static_cast<void*>(app->fonts));
+        app->fonts = nullptr;
+        app->font = nullptr;
+        ttf::destroy_font_index(*app->font_index);
+        app->font_index = nullptr;
+    }
+
+    // #endregion
+
+    INIT_FUNCTION(init) {
+        if (!platform_layer::init(&app->platform_layer)) {
+            return false;
+        }
+
+        app->font_size = 16;
+        app->workspace = &engine::create_workspace(workspace_memory_budget);
+        if (!open_buffer(app)) {
+            engine::destroy_workspace(*app->workspace);
+            platform_layer::deinit(&app->platform_layer);
+            return false;
+        }
+
+        app->window = platform_layer::create_window(&app->platform_layer, window_width, window_height);
+        if (!app->window) {
+            close_buffer(app);
+            engine::destroy_workspace(*app->workspace);
+            platform_layer::deinit(&app->platform_layer);
+            return false;
+        }
+
+        app->font_index = &ttf::load_font_index(fonts_directory_path, font_index_path);
+        app->num_fonts = ttf::get_font_count(*app->font_index);
+        app->fonts = static_cast<platform_layer::Font**>(calloc(app->num_fonts + 1, sizeof(platform_layer::Font*)));
+        app->font = open_chosen_font(app);
+
+    #if !TTE_MACOS
+        if (!app->font) {
+            TTE_DBG("Could not open any fonts");
+            close_fonts(app);
+            platform_layer::destroy_window(&app->platform_layer, *app->window);
+            close_buffer(app);
+            engine::destroy_workspace(*app->workspace);
+            platform_layer::deinit(&app->platform_layer);
+            return false;
+        }
+    #endif
+
+        app->redraw = true;
+        return true;
+    }
+
+    DEINIT_FUNCTION(deinit) {
+        close_fonts(app);
+        platform_layer::destroy_window(&app->platform_layer, *app->window);
+        // a session of a partly loaded file would restore only part of it
+        if (!app->file_load) {
+            save_session(app);
+        }
+        close_buffer(app);
+        if (app->trace && !engine::close_trace_writer(*app->trace)) {
+            TTE_DBG("Failed to write trace");
+        }
+        engine::destroy_workspace(*app->workspace);
+        free(static_cast<void*>(app->line_text));
+        free(static_cast<void*>(app->line_lengths));
+        free(static_cast<void*>(app->advances));
+        platform_layer::deinit(&app->platform_layer);
+    }
+
+    DRAW_FUNCTION(draw) {
+        const S64 distance = static_cast<S64>(app->scroll_y) - static_cast<S64>(app->drawn_scroll_y);
+        // the load progress is drawn over the bottom of the window and does not scroll
+        if (app->redraw || app->file_load || distance >= window_height || -distance >= window_height ||
+            !platform_layer::buffer_kept(&app->platform_layer, *app->window)) {
+            draw_whole(app);
+            return;
+        }
+
+        if (app->cursor.line != app->drawn_cursor.line || app->cursor.character != app->drawn_cursor.character) {
+            damage_lines(app, app->drawn_cursor.line, app->drawn_cursor.line + 1);
+            damage_lines(app, app->cursor.line, app->cursor.line + 1);
+        }
+        // nothing changed since the last frame
+        if (distance == 0 && app->damage_begin_line == app->damage_end_line) {
+            return;
+        }
+        if (distance != 0 &&
+            !platform_layer::scroll_buffer(&app->platform_layer, *app->window, static_cast<S32>(-distance))) {
+            draw_whole(app);
+            return;
+        }
+
+        // the rows the scroll uncovered
+        if (distance > 0) {
+            draw_lines(app, static_cast<U32>(window_height - distance), window_height, true);
+        } else if (distance < 0) {
+            draw_lines(app, 0, static_cast<U32>(-distance), true);
+        }
+        // the lines below the window are not drawn
+        const Length end_line = std::min(app->damage_end_line, get_scroll_line(app) + get_visible_lines(app) + 1);
+        const S64 begin_y = std::max<S64>(
+            static_cast<S64>(app->damage_begin_line * app->font_size) - static_cast<S64>(app->scroll_y), 0);
+        const S64 end_y =
+            std::min<S64>(static_cast<S64>(end_line * app->font_size) - static_cast<S64>(app->scroll_y), window_height);
+        if (begin_y < end_y) {
+            draw_lines(app, static_cast<U32>(begin_y), static_cast<U32>(end_y), true);
+        }
+
+        if (distance != 0) {
+            platform_layer::show_buffer(&app->platform_layer, *app->window);
+        } else {
+            platform_layer::show_buffer_rect(&app->platform_layer,
+                *app->window,
+                0,
+                static_cast<U32>(begin_y),
+                window_width,
+                static_cast<U32>(end_y - begin_y));
+        }
+        end_frame(app);
     }
 
     HANDLE_EVENT_FUNCTION(handle_event) {
+        // the recording starts at the first edit after the file loaded, so the buffer it starts from is complete
+        if (app->trace_path && !app->file_load && event.type == common::Event::Type::KeyDown) {
+            start_trace(app);
+        }
+        if (app->trace) {
+            engine::trace_event(*app->trace, event);
+        }
+
         if (event.type == common::Event::Type::Quit) {
             app->running = false;
         }
 #if TTE_HOT_RELOAD
         else if (event.type == common::Event::Type::DidHotReload) {
-            draw(app);
+            app->redraw = true;
         }
 #endif
         else if (event.type == common::Event::Type::WindowClose) {
             app->running = false;
         } else if (event.type == common::Event::Type::WindowResized) {
-            draw(app);
-        } else if (event.type == common::Event::Type::KeyDown) {
+            app->redraw = true;
+        } else if (event.type == common::Event::Type::MouseWheel) {
+            scroll(app, event.wheel.y);
+        } else if (event.type == common::Event::Type::KeyDown && can_edit(app)) {
+            // a followed file may have no lines yet for the keys that insert. keys that change nothing, as backspace
+            // at the start of the buffer, keep following.
+            if (event.key.keycode != common::KeyCode::Unknown && event.key.keycode != common::KeyCode::Backspace &&
+                !ensure_line(app)) {
+                return;
+            }
             if (event.key.keycode == common::KeyCode::Backspace) {
                 if (app->cursor.character == 0) {
                     if (app->cursor.line != 0) {
                         const Length old_line_length =
                             engine::get_line_length(*app->buffer, app->cursor.line - 1);
                         if (engine::merge_lines(*app->buffer, app->cursor.line - 1)) {
+                            record_merge_lines(app, app->cursor.line - 1);
                             app->cursor.line = app->cursor.line - 1;
                             app->cursor.character = old_line_length;
-                            draw(app);
+                            // the lines after it moved up, the last line drawn is gone
+                            edit_lines(app, app->cursor.line, engine::get_buffer_length(*app->buffer) + 1);
                         }
                     }
                 } else {
                     if (engine::delete_character(*app->buffer, app->cursor.line, app->cursor.character - 1)) {
+                        record_delete_characters(app, 1, app->cursor.line, app->cursor.character - 1);
                         --app->cursor.character;
-                        draw(app);
+                        edit_lines(app, app->cursor.line, app->cursor.line + 1);
                     } else {
                         TTE_ASSERT(false);
                     }
                 }
             } else if (event.key.keycode == common::KeyCode::Space) {
                 if (engine::insert_character(*app->buffer, app->cursor.line, app->cursor.character, ' ')) {
+                    record_insert_characters(app, app->cursor.line, app->cursor.character, " ", 1);
                     ++app->cursor.character;
-                    draw(app);
+                    edit_lines(app, app->cursor.line, app->cursor.line + 1);
                 } else {
                     TTE_ASSERT(false);
                 }
@@ -152,17 +812,18 @@ namespace tte { namespace app {
                 const bool result = engine::insert_empty_line(*app->buffer, app->cursor.line + 1);
                 TTE_ASSERT(result);
                 if (result) {
+                    record_insert_empty_lines(app, 1, app->cursor.line + 1);
                     ++app->cursor.line;
                     app->cursor.character = 0;
-                    draw(app);
+                    // the lines after it moved down
+                    edit_lines(app, app->cursor.line, engine::get_buffer_length(*app->buffer));
                 }
             } else if (event.key.keycode != common::KeyCode::Unknown) {
-                if (engine::insert_character(*app->buffer,
-                        app->cursor.line,
-                        app->cursor.character,
-                        platform_layer::get_key_code_character(event.key.keycode))) {
+                const char character = platform_layer::get_key_code_character(event.key.keycode);
+                if (engine::insert_character(*app->buffer, app->cursor.line, app->cursor.character, character)) {
+                    record_insert_characters(app, app->cursor.line, app->cursor.character, &character, 1);
                     ++app->cursor.character;
-                    draw(app);
+                    edit_lines(app, app->cursor.line, app->cursor.line + 1);
                 } else {
                     TTE_ASSERT(false);
                 }
@@ -170,7 +831,22 @@ namespace tte { namespace app {
         }
     }
 
+    // handles the events since the last run, then draws them in one frame
     RUN_FUNCTION(run) {
+        platform_layer::wait_for_events(&app->platform_layer, get_wait_milliseconds(app));
         platform_layer::run(&app->platform_layer);
+        if (app->file_load) {
+            poll_load(app);
+            app->redraw = true;
+        }
+        if (app->file_watch && poll_watch(app)) {
+            app->redraw = true;
+        }
+        if (app->journal && !engine::commit_journal(*app->journal)) {
+            TTE_DBG("Failed to commit journal");
+        }
+        compress_cold_lines(app);
+        engine::enforce_workspace_budget(*app->workspace);
+        draw(app);
     }
 }}
@@ -5,6 +5,7 @@
 #include <tte/common/event.hpp>
 #include <tte/app/app.hpp>
 #include <cstdlib>
+#include <cstring>
 #include <dlfcn.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -111,7 +112,7 @@ namespace tte { namespace app {
     }
 }}
 
-int main() {
+int main(int argc, char** argv) {
 #if TTE_HOT_RELOAD
     if (!tte::app::load_app_lib_dll()) {
         TTE_DBG("Failed to load app lib dll");
@@ -120,6 +121,18 @@ int main() {
 #endif
 
     tte::app::app.platform_layer.handle_event = &tte::app::handle_event;
+    // tte [--follow [--max-lines <number>]] [--record-trace <path>] [file]
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--follow") == 0) {
+            tte::app::app.follow = true;
+        } else if (strcmp(argv[i], "--max-lines") == 0 && i + 1 < argc) {
+            tte::app::app.follow_max_lines = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--record-trace") == 0 && i + 1 < argc) {
+            tte::app::app.trace_path = argv[++i];
+        } else {
+            tte::app::app.file_path = argv[i];
+        }
+    }
 
 #if TTE_HOT_RELOAD
     tte::app::app_lib.init(&tte::app::app);
@@ -146,7 +159,6 @@ int main() {
 #else
         tte::app::run(&tte::app::app);
 #endif
-        // TODO(TB): sleep?
     }
 
 #if TTE_HOT_RELOAD
@@ -0,0 +1,350 @@
+#include <tte/app/app.hpp>
+#include <tte/platform_layer/platform_layer.hpp>
+#include <tte/platform_layer/headless.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/allocation_tracker.hpp>
+#include <tte/common/event.hpp>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+// the app is built into the tests as it is into tte (see main.cpp)
+#include "app.cpp"
+
+static tte::app::App* handled_app;
+
+static void handle_event(tte::common::Event event) { tte::app::handle_event(handled_app, event); }
+
+[[nodiscard]] static tte::common::Event key_down(const tte::common::KeyCode keycode) {
+    tte::common::Event result;
+    result.type = tte::common::Event::Type::KeyDown;
+    result.key.keycode = keycode;
+    result.key.repeat = 0;
+    return result;
+}
+
+[[nodiscard]] static tte::common::Event mouse_wheel(const tte::S32 y) {
+    tte::common::Event result;
+    result.type = tte::common::Event::Type::MouseWheel;
+    result.wheel.y = y;
+    return result;
+}
+
+[[nodiscard]] static std::string to_string(tte::engine::Buffer& buffer) {
+    char* data = tte::engine::buffer_to_c_string(buffer);
+    std::string result(data);
+    free(static_cast<void*>(data));
+    return result;
+}
+
+[[nodiscard]] static std::string get_framebuffer(tte::platform_layer::Window& window) {
+    tte::U32 width;
+    tte::U32 height;
+    const tte::U8* framebuffer = tte::platform_layer::get_framebuffer(window, &width, &height);
+    return std::string(reinterpret_cast<const char*>(framebuffer), static_cast<tte::Length>(width) * height * 4);
+}
+
+// r, g, b of the pixel
+[[nodiscard]] static std::string get_pixel(tte::platform_layer::Window& window, const tte::U32 x, const tte::U32 y) {
+    tte::U32 width;
+    tte::U32 height;
+    const tte::U8* pixel = tte::platform_layer::get_framebuffer(window, &width, &height) + (y * width + x) * 4;
+    char result[16];
+    snprintf(result, sizeof(result), "%02X%02X%02X", pixel[0], pixel[1], pixel[2]);
+    return result;
+}
+
+TEST(draw, redrawingUnchangedContentAllocatesNothing) {
+    if (!tte::common::is_counting_allocations()) {
+        GTEST_SKIP() << "allocations are not counted in this build";
+    }
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    ASSERT_TRUE(tte::platform_layer::init(&app.platform_layer));
+    app.font_size = 16;
+    app.window = tte::platform_layer::create_window(&app.platform_layer, 640, 480);
+    ASSERT_TRUE(app.window);
+    app.font = tte::platform_layer::open_font(&app.platform_layer, nullptr, app.font_size);
+    app.buffer = &tte::engine::create_buffer();
+    // more lines than fit in the window, some longer than the first line drawn
+    for (tte::Length i = 0; i < 40; ++i) {
+        const std::string line = std::string(i % 7 * 10, 'a') + " line " + std::to_string(i);
+        ASSERT_TRUE(tte::engine::insert_line(*app.buffer, i, line.c_str()));
+    }
+    app.cursor = tte::app::Cursor{5, 3};
+    app.scroll_y = 2 * app.font_size + 5;
+
+    tte::app::draw(&app);
+    const tte::common::AllocationScope scope = tte::common::start_allocation_scope();
+    app.redraw = true;
+    tte::app::draw(&app);
+    const tte::common::AllocationCounts counts = tte::common::get_allocation_counts(scope);
+    ASSERT_EQ(tte::platform_layer::get_frame_count(*app.window), 2);
+    ASSERT_EQ(counts.allocations, 0);
+    ASSERT_EQ(counts.frees, 0);
+
+    free(static_cast<void*>(app.line_text));
+    free(static_cast<void*>(app.line_lengths));
+    free(static_cast<void*>(app.advances));
+    tte::engine::destroy_buffer(*app.buffer);
+    tte::platform_layer::close_font(&app.platform_layer, *app.font);
+    tte::platform_layer::destroy_window(&app.platform_layer, *app.window);
+    tte::platform_layer::deinit(&app.platform_layer);
+}
+
+TEST(draw, queuedEventsEditAndRedraw) {
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    ASSERT_TRUE(tte::app::init(&app));
+    tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::H));
+    tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::I));
+    tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::Return));
+    tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::A));
+
+    // quits once the events ran out
+    app.running = true;
+    while (app.running) {
+        tte::app::run(&app);
+    }
+    ASSERT_EQ(tte::platform_layer::get_queued_events(&app.platform_layer), 0);
+    ASSERT_EQ(to_string(*app.buffer), "hi\na\n");
+    // the edits are drawn together in one frame, and the run that quit had nothing to draw
+    ASSERT_EQ(tte::platform_layer::get_frame_count(*app.window), 1);
+
+    // the cursor after the a on the second line, the a drawn before it and the background after it
+    const tte::U32 glyph_width = tte::platform_layer::get_glyph_width(*app.font);
+    const tte::U32 middle_y = app.font_size + app.font_size / 2;
+    ASSERT_EQ(get_pixel(*app.window, glyph_width, middle_y), "FF0000");
+    ASSERT_EQ(get_pixel(*app.window, glyph_width / 2, middle_y), "FF39A1");
+    ASSERT_EQ(get_pixel(*app.window, glyph_width * 3, middle_y), "FF00FF");
+    tte::app::deinit(&app);
+}
+
+TEST(draw, cursorStaysInWindow) {
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    ASSERT_TRUE(tte::app::init(&app));
+    const tte::Length whole_lines = tte::app::window_height / app.font_size;
+    for (tte::Length i = 0; i < whole_lines + 5; ++i) {
+        tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::Return));
+    }
+    tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::A));
+
+    app.running = true;
+    while (app.running) {
+        tte::app::run(&app);
+    }
+    // scrolled just far enough for the last line, where the cursor is, to be drawn whole at the bottom
+    ASSERT_EQ(app.cursor.line, whole_lines + 5);
+    ASSERT_EQ(app.scroll_y, 6 * app.font_size);
+    const tte::U32 glyph_width = tte::platform_layer::get_glyph_width(*app.font);
+    const tte::U32 middle_y = static_cast<tte::U32>((whole_lines - 1) * app.font_size + app.font_size / 2);
+    ASSERT_EQ(get_pixel(*app.window, glyph_width / 2, middle_y), "FF39A1");
+    ASSERT_EQ(get_pixel(*app.window, glyph_width, middle_y), "FF0000");
+
+    // and back up to the first line
+    for (tte::Length i = 0; i < whole_lines + 6; ++i) {
+        tte::platform_layer::push_event(&app.platform_layer, key_down(tte::common::KeyCode::Backspace));
+    }
+    app.running = true;
+    while (app.running) {
+        tte::app::run(&app);
+    }
+    ASSERT_EQ(to_string(*app.buffer), "\n");
+    ASSERT_EQ(app.scroll_y, 0);
+    tte::app::deinit(&app);
+}
+
+TEST(draw, scrollingDrawsSameFrameAsDrawingWhole) {
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    ASSERT_TRUE(tte::app::init(&app));
+    for (tte::Length i = 0; i < 100; ++i) {
+        const std::string line = std::string(i % 5 * 3, 'a') + " line " + std::to_string(i);
+        ASSERT_TRUE(tte::engine::insert_line(*app.buffer, i, line.c_str()));
+    }
+    app.cursor = tte::app::Cursor{12, 4};
+    tte::app::draw(&app);
+
+    // within a line, across lines, both ways, a whole window and past both ends
+    const tte::S32 distances[] = {5, 37, 16, -20, 3, 100, -7, 480, -600, 1, 1000000, -1, -1000000};
+    for (const tte::S32 distance : distances) {
+        const tte::Length frames = tte::platform_layer::get_frame_count(*app.window);
+        tte::app::handle_event(&app, mouse_wheel(distance));
+        tte::app::draw(&app);
+        ASSERT_EQ(tte::platform_layer::get_frame_count(*app.window), frames + 1) << distance;
+        const std::string scrolled = get_framebuffer(*app.window);
+        app.redraw = true;
+        tte::app::draw(&app);
+        ASSERT_TRUE(get_framebuffer(*app.window) == scrolled) << distance;
+    }
+    // no further than the last line at the bottom, and back to the top
+    ASSERT_EQ(app.scroll_y, 0);
+    tte::app::handle_event(&app, mouse_wheel(1000000));
+    ASSERT_EQ(app.scroll_y, 101 * app.font_size - tte::app::window_height);
+
+    // scrolling does not move the cursor, the next edit scrolls back to it
+    ASSERT_EQ(app.cursor.line, 12);
+    tte::app::handle_event(&app, key_down(tte::common::KeyCode::A));
+    ASSERT_EQ(app.scroll_y, 12 * app.font_size);
+    tte::app::deinit(&app);
+}
+
+TEST(draw, editsDrawOnlyTheLinesTheyChange) {
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    ASSERT_TRUE(tte::app::init(&app));
+    for (tte::Length i = 0; i < 20; ++i) {
+        const std::string line = std::string(i % 4 * 5, 'a') + " line " + std::to_string(i);
+        ASSERT_TRUE(tte::engine::insert_line(*app.buffer, i, line.c_str()));
+    }
+    app.cursor = tte::app::Cursor{7, 3};
+    tte::app::draw(&app);
+
+    // a character is a strip one line high, the lines after a new or merged line down to the last line drawn
+    const tte::U32 line_y = 7 * app.font_size;
+    const struct {
+        tte::common::KeyCode keycode;
+        tte::U32 y;
+        tte::U32 height;
+    } edits[] = {
+        {tte::common::KeyCode::B, line_y, app.font_size},
+        {tte::common::KeyCode::Backspace, line_y, app.font_size},
+        {tte::common::KeyCode::Return, line_y, 15 * app.font_size},
+        {tte::common::KeyCode::Backspace, line_y, 15 * app.font_size},
+    };
+    for (const auto& edit : edits) {
+        tte::app::handle_event(&app, key_down(edit.keycode));
+        tte::app::draw(&app);
+        tte::U32 x;
+        tte::U32 y;
+        tte::U32 width;
+        tte::U32 height;
+        tte::platform_layer::get_drawn_rect(*app.window, &x, &y, &width, &height);
+        ASSERT_EQ(y, edit.y);
+        ASSERT_EQ(height, edit.height);
+        ASSERT_EQ(width, tte::app::window_width);
+        const std::string edited = get_framebuffer(*app.window);
+        app.redraw = true;
+        tte::app::draw(&app);
+        ASSERT_TRUE(get_framebuffer(*app.window) == edited);
+    }
+    tte::app::deinit(&app);
+}
+
+TEST(draw, cursorFollowsEditsOfItsLine) {
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    ASSERT_TRUE(tte::app::init(&app));
+    const tte::U32 glyph_width = tte::platform_layer::get_glyph_width(*app.font);
+    const tte::U32 middle_y = app.font_size / 2;
+    const tte::common::KeyCode keycodes[] = {tte::common::KeyCode::A,
+        tte::common::KeyCode::B,
+        tte::common::KeyCode::Return,
+        tte::common::KeyCode::C,
+        tte::common::KeyCode::Backspace,
+        tte::common::KeyCode::Backspace};
+    // the cursor after each key, in characters of the first line or of the second
+    const tte::U32 xs[] = {1, 2, 0, 1, 0, 2};
+    const tte::U32 ys[] = {0, 0, 1, 1, 1, 0};
+    for (tte::Length i = 0; i < sizeof(keycodes) / sizeof(keycodes[0]); ++i) {
+        tte::app::handle_event(&app, key_down(keycodes[i]));
+        tte::app::draw(&app);
+        const tte::U32 y = ys[i] * app.font_size + middle_y;
+        ASSERT_EQ(get_pixel(*app.window, xs[i] * glyph_width, y), "FF0000") << i;
+        // the line the cursor left is drawn without it
+        if (i != 0 && ys[i - 1] != ys[i]) {
+            ASSERT_NE(get_pixel(*app.window, xs[i - 1] * glyph_width, ys[i - 1] * app.font_size + middle_y), "FF0000")
+                << i;
+        }
+    }
+    ASSERT_EQ(to_string(*app.buffer), "ab\n");
+    tte::app::deinit(&app);
+}
+
+TEST(draw, followedFileLargerThanAPollIsReadWithoutWaiting) {
+    // more than a poll of the file watch reads, see max_poll_size
+    const tte::Length number_of_lines = 200 * 1024;
+    const std::string line(99, 'a');
+    const std::string path = testing::TempDir() + "followed.log";
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(file);
+    for (tte::Length i = 0; i < number_of_lines; ++i) {
+        ASSERT_EQ(fprintf(file, "%s\n", line.c_str()), 100);
+    }
+    ASSERT_EQ(fclose(file), 0);
+
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    app.file_path = path.c_str();
+    app.follow = true;
+    ASSERT_TRUE(tte::app::init(&app));
+    // each run reads a poll of the file, and does not wait for events while there is more of it to read
+    tte::Length runs = 0;
+    while (tte::engine::get_buffer_length(*app.buffer) < number_of_lines) {
+        ASSERT_LT(runs, 8u);
+        if (runs != 0) {
+            ASSERT_EQ(tte::app::get_wait_milliseconds(&app), 0u);
+        }
+        tte::app::run(&app);
+        ++runs;
+    }
+    ASSERT_GT(runs, 1u);
+    ASSERT_EQ(tte::engine::get_buffer_length(*app.buffer), number_of_lines);
+    ASSERT_EQ(app.cursor.line, number_of_lines - 1);
+    // all of it was read, so run waits for the file to change again
+    ASSERT_NE(tte::app::get_wait_milliseconds(&app), 0u);
+    tte::app::deinit(&app);
+    remove(path.c_str());
+}
+
+TEST(draw, keysThatChangeNothingKeepFollowing) {
+    const std::string path = testing::TempDir() + "followed_keys.log";
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fclose(file), 0);
+
+    tte::app::App app;
+    memset(static_cast<void*>(&app), 0, sizeof(tte::app::App));
+    handled_app = &app;
+    app.platform_layer.handle_event = &handle_event;
+    app.file_path = path.c_str();
+    app.follow = true;
+    ASSERT_TRUE(tte::app::init(&app));
+    tte::app::run(&app);
+    // backspace at the start of the buffer and unknown keys edit nothing
+    tte::app::handle_event(&app, key_down(tte::common::KeyCode::Unknown));
+    tte::app::handle_event(&app, key_down(tte::common::KeyCode::Backspace));
+    ASSERT_TRUE(app.follow);
+    ASSERT_TRUE(app.file_watch);
+    ASSERT_EQ(tte::engine::get_buffer_length(*app.buffer), 0u);
+
+    file = fopen(path.c_str(), "ab");
+    ASSERT_TRUE(file);
+    ASSERT_GE(fputs("abc\n", file), 0);
+    ASSERT_EQ(fclose(file), 0);
+    for (tte::Length runs = 0; tte::engine::get_buffer_length(*app.buffer) == 0; ++runs) {
+        ASSERT_LT(runs, 50u);
+        tte::app::run(&app);
+    }
+    ASSERT_EQ(to_string(*app.buffer), "abc\n");
+
+    // typing does, and the buffer no longer follows the file
+    tte::app::handle_event(&app, key_down(tte::common::KeyCode::A));
+    ASSERT_FALSE(app.follow);
+    ASSERT_FALSE(app.file_watch);
+    tte::app::deinit(&app);
+    remove(path.c_str());
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+
+namespace tte { namespace common {
+    // allocation tracker
+    // opt-in: only test and benchmark executables link tte_allocation_tracker, which interposes malloc, calloc, realloc
+    // and free (and with them operator new and delete) to count the allocations of each thread. needs glibc and a build
+    // without sanitizers, otherwise nothing is counted (see is_counting_allocations).
+    struct AllocationCounts {
+        // malloc, calloc and realloc calls
+        U64 allocations;
+        // free calls, not counting free(nullptr)
+        U64 frees;
+    };
+
+    // AllocationScope
+    // counts the allocations of the thread that started it, see get_allocation_counts
+    struct AllocationScope {
+        AllocationCounts start;
+    };
+
+    [[nodiscard]] extern bool is_counting_allocations();
+    [[nodiscard]] extern AllocationScope start_allocation_scope();
+    // get_allocation_counts
+    // the allocations and frees of the calling thread since the scope started
+    [[nodiscard]] extern AllocationCounts get_allocation_counts(const AllocationScope& scope);
+}}
@@ -45,7 +45,7 @@ namespace tte { namespace common {
             DidHotReload = 0,
 #endif
             Null = 0,
-            Unknown, Quit, KeyDown, KeyUp, WindowClose, WindowResized
+            Unknown, Quit, KeyDown, KeyUp, WindowClose, WindowResized, MouseWheel
         };
 
         struct KeyData {
@@ -53,10 +53,16 @@ namespace tte { namespace common {
             KeyCode keycode;
         };
 
+        struct WheelData {
+            // pixels to scroll, towards the end of the document if positive
+            S32 y;
+        };
+
         Type type;
 
         union {
             KeyData key;
+            WheelData wheel;
         };
     };
 }}
@@ -0,0 +1,67 @@
+#include <tte/common/allocation_tracker.hpp>
+#include <tte/common/number_types.hpp>
+#include <cstddef>
+
+#if defined(__has_feature)
+    #if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+        #define TTE_SANITIZED 1
+    #endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    #define TTE_SANITIZED 1
+#endif
+
+// sanitizers interpose the allocator themselves
+#if defined(__GLIBC__) && !defined(TTE_SANITIZED)
+    #define TTE_COUNT_ALLOCATIONS 1
+#else
+    #define TTE_COUNT_ALLOCATIONS 0
+#endif
+
+namespace {
+    // zero initialised, so the allocator can count into them before anything else ran
+    thread_local tte::common::AllocationCounts allocation_counts;
+}
+
+#if TTE_COUNT_ALLOCATIONS
+extern "C" {
+    extern void* __libc_malloc(size_t size);
+    extern void* __libc_calloc(size_t number, size_t size);
+    extern void* __libc_realloc(void* memory, size_t size);
+    extern void __libc_free(void* memory);
+
+    // every allocation of the process, including those of operator new, goes through these
+    void* malloc(size_t size) noexcept {
+        ++allocation_counts.allocations;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t number, size_t size) noexcept {
+        ++allocation_counts.allocations;
+        return __libc_calloc(number, size);
+    }
+
+    void* realloc(void* memory, size_t size) noexcept {
+        ++allocation_counts.allocations;
+        return __libc_realloc(memory, size);
+    }
+
+    void free(void* memory) noexcept {
+        if (memory) {
+            ++allocation_counts.frees;
+        }
+        __libc_free(memory);
+    }
+}
+#endif
+
+namespace tte { namespace common {
+    bool is_counting_allocations() { return TTE_COUNT_ALLOCATIONS; }
+
+    AllocationScope start_allocation_scope() { return AllocationScope{allocation_counts}; }
+
+    AllocationCounts get_allocation_counts(const AllocationScope& scope) {
+        return AllocationCounts{allocation_counts.allocations - scope.start.allocations,
+            allocation_counts.frees - scope.start.frees};
+    }
+}}
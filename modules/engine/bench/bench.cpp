@@ -0,0 +1,472 @@
+#include <tte/engine/engine.hpp>
+#include <tte/common/allocation_tracker.hpp>
+#include <tte/common/number_types.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+
+// tte_engine_bench
+// measures the operations of engine.hpp on buffers of 1k to 10M lines, at the first, middle and last line, then
+// again with line interning enabled and after compressing the whole buffer (names ending in :interned and
+// :compressed), and prints the results as JSON:
+// {"benchmark": "tte_engine_bench", "results": [{"operation": ..., "lines": ..., "position": ..., "iterations": ...,
+// "ns_per_op": ..., "allocations_per_op": ..., "peak_rss_bytes": ...}, ...]}
+// allocations_per_op is null where allocations can not be counted (see common::is_counting_allocations).
+// peak_rss_bytes is the peak of the process so far.
+//
+// options:
+// --max-lines N      largest buffer measured, 10000000 by default
+// --min-time-ms N    time each operation is measured for at least, 50 by default
+// --filter TEXT      only measures operations whose name contains TEXT
+
+namespace tte { namespace bench {
+    static const constexpr Length line_counts[] = {1000, 10000, 100000, 1000000, 10000000};
+    static const constexpr Length line_length = 48;
+    static const char* const line_text = "000000000000 the quick brown fox jumps over it..";
+    // lines inserted or deleted at once by insert_lines and delete_lines
+    static const constexpr Length batch_lines = 16;
+    // lines read at once by copy_lines, about a window
+    static const constexpr Length window_lines = 32;
+    // lines compressed at once by compress_lines, about a block of compressed lines
+    static const constexpr Length compress_batch_lines = 1024;
+    static const constexpr Length max_iterations = 1000000;
+
+    enum class Position { Head, Middle, Tail };
+    static const constexpr Position positions[] = {Position::Head, Position::Middle, Position::Tail};
+
+    struct Options {
+        Length max_lines;
+        U64 min_time_nanoseconds;
+        const char* filter;
+    };
+
+    struct Result {
+        U64 iterations;
+        U64 nanoseconds;
+        U64 allocations;
+    };
+
+    // an operation measured n times in a row. the operations that change the buffer are measured together with one that
+    // undoes them, so every operation runs on a buffer of the same size.
+    typedef void operation_function(engine::Buffer& buffer, const Length line_index, const Length n);
+
+    static bool first_result = true;
+
+    [[nodiscard]] static U64 get_nanoseconds() {
+        return static_cast<U64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                                    .count());
+    }
+
+    [[nodiscard]] static U64 get_peak_rss_bytes() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#if defined(__APPLE__)
+        return static_cast<U64>(usage.ru_maxrss);
+#else
+        return static_cast<U64>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    [[nodiscard]] static const char* get_position_name(const Position position) {
+        switch (position) {
+            case Position::Head:
+                return "head";
+            case Position::Middle:
+                return "middle";
+            case Position::Tail:
+                return "tail";
+        }
+        return "";
+    }
+
+    [[nodiscard]] static Length get_line_index(const Length number_of_lines, const Position position) {
+        switch (position) {
+            case Position::Head:
+                return 0;
+            case Position::Middle:
+                return number_of_lines / 2;
+            case Position::Tail:
+                return number_of_lines - 1;
+        }
+        return 0;
+    }
+
+    [[nodiscard]] static char** create_lines(const Length number_of_lines) {
+        char** data = static_cast<char**>(malloc(sizeof(char*) * number_of_lines));
+        for (Length i = 0; i < number_of_lines; ++i) {
+            // numbered, so the lines differ
+            data[i] = static_cast<char*>(malloc(sizeof(char) * (line_length + 1)));
+            memcpy(data[i], line_text, line_length + 1);
+            for (Length digit = 0, number = i; digit < 12; ++digit, number /= 10) {
+                data[i][11 - digit] = static_cast<char>('0' + number % 10);
+            }
+        }
+        return data;
+    }
+
+    static void destroy_lines(char** data, const Length number_of_lines) {
+        for (Length i = 0; i < number_of_lines; ++i) {
+            free(data[i]);
+        }
+        free(data);
+    }
+
+    [[nodiscard]] static Result
+    run(operation_function* operation, engine::Buffer& buffer, const Length line_index, const Length n) {
+        const common::AllocationScope scope = common::start_allocation_scope();
+        const U64 start = get_nanoseconds();
+        operation(buffer, line_index, n);
+        const U64 end = get_nanoseconds();
+        return Result{n, end - start, common::get_allocation_counts(scope).allocations};
+    }
+
+    // doubles the runs until they take long enough to estimate how many runs take min_time, then measures that many
+    [[nodiscard]] static Result
+    measure(const Options& options, operation_function* operation, engine::Buffer& buffer, const Length line_index) {
+        Length n = 1;
+        Result estimate = run(operation, buffer, line_index, n);
+        while (estimate.nanoseconds < options.min_time_nanoseconds / 16 && n < max_iterations) {
+            n *= 2;
+            estimate = run(operation, buffer, line_index, n);
+        }
+        n = static_cast<Length>(static_cast<double>(n) * static_cast<double>(options.min_time_nanoseconds) /
+            static_cast<double>(estimate.nanoseconds == 0 ? 1 : estimate.nanoseconds));
+        n = n < 1 ? 1 : (n > max_iterations ? max_iterations : n);
+        return run(operation, buffer, line_index, n);
+    }
+
+    static void print_result(const char* operation,
+        const Length number_of_lines,
+        const char* position,
+        const Result& result) {
+        printf("%s\n        {\"operation\": \"%s\", \"lines\": %llu, \"position\": \"%s\", \"iterations\": %llu, "
+               "\"ns_per_op\": %.2f, ",
+            first_result ? "" : ",",
+            operation,
+            static_cast<unsigned long long>(number_of_lines),
+            position,
+            static_cast<unsigned long long>(result.iterations),
+            static_cast<double>(result.nanoseconds) / static_cast<double>(result.iterations));
+        if (common::is_counting_allocations()) {
+            printf("\"allocations_per_op\": %.2f, ",
+                static_cast<double>(result.allocations) / static_cast<double>(result.iterations));
+        } else {
+            printf("\"allocations_per_op\": null, ");
+        }
+        printf("\"peak_rss_bytes\": %llu}", static_cast<unsigned long long>(get_peak_rss_bytes()));
+        fflush(stdout);
+        first_result = false;
+    }
+
+    // #region operations
+    static void insert_and_delete_empty_line(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_empty_line(buffer, line_index);
+            result = engine::delete_line(buffer, line_index);
+        }
+    }
+
+    static void insert_and_delete_line(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result =
+                engine::insert_line(buffer, line_index, "inserted line with some text in it", 34);
+            result = engine::delete_line(buffer, line_index);
+        }
+    }
+
+    static void insert_and_delete_empty_lines(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_empty_lines(buffer, batch_lines, line_index);
+            result = engine::delete_lines(buffer, batch_lines, line_index);
+        }
+    }
+
+    static void insert_and_delete_lines(engine::Buffer& buffer, const Length line_index, const Length n) {
+        const char* data[batch_lines];
+        Length lengths[batch_lines];
+        for (Length i = 0; i < batch_lines; ++i) {
+            data[i] = "inserted line with some text in it";
+            lengths[i] = 34;
+        }
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_lines(buffer, batch_lines, line_index, data, lengths);
+            result = engine::delete_lines(buffer, batch_lines, line_index);
+        }
+    }
+
+    // typing and deleting in the middle of the line
+    static void insert_and_delete_character(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_character(buffer, line_index, line_length / 2, 'x');
+            result = engine::delete_character(buffer, line_index, line_length / 2);
+        }
+    }
+
+    static void insert_and_delete_characters(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_characters(buffer, line_index, line_length / 2, "pasted", 6);
+            result = engine::delete_characters(buffer, 6, line_index, line_length / 2);
+        }
+    }
+
+    static void insert_empty_line_and_merge_lines(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result = engine::insert_empty_line(buffer, line_index + 1);
+            result = engine::merge_lines(buffer, line_index);
+        }
+    }
+
+    static void get_buffer_length(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result = engine::get_buffer_length(buffer);
+        }
+    }
+
+    static void get_line_length(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result = engine::get_line_length(buffer, line_index);
+        }
+    }
+
+    static void line_empty(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile bool result = engine::line_empty(buffer, line_index);
+        }
+    }
+
+    static void line_to_c_string(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            free(engine::line_to_c_string(buffer, line_index));
+        }
+    }
+
+    static void buffer_to_c_string(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            free(engine::buffer_to_c_string(buffer));
+        }
+    }
+
+    static void get_buffer_memory_usage(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result = engine::get_buffer_memory_usage(buffer);
+        }
+    }
+
+    static void reclaim_buffer_memory(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            engine::reclaim_buffer_memory(buffer);
+        }
+    }
+
+    static void copy_line(engine::Buffer& buffer, const Length line_index, const Length n) {
+        engine::Char data[line_length + 1];
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result = engine::copy_line(buffer, line_index, data, line_length + 1);
+        }
+    }
+
+    // the lines of a window from the line, fewer at the tail
+    static void copy_lines(engine::Buffer& buffer, const Length line_index, const Length n) {
+        engine::Char data[window_lines * (line_length + 1)];
+        Length line_lengths[window_lines];
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result =
+                engine::copy_lines(buffer, window_lines, line_index, data, sizeof(data), line_lengths);
+        }
+    }
+
+    // compresses lines inserted for it, as compressing lines that are already compressed does nothing
+    static void insert_compress_and_delete_lines(engine::Buffer& buffer, const Length line_index, const Length n) {
+        const char* data[compress_batch_lines];
+        Length lengths[compress_batch_lines];
+        for (Length i = 0; i < compress_batch_lines; ++i) {
+            data[i] = line_text;
+            lengths[i] = line_length;
+        }
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] bool result =
+                engine::insert_lines(buffer, compress_batch_lines, line_index, data, lengths);
+            result = engine::compress_lines(buffer, compress_batch_lines, line_index);
+            result = engine::delete_lines(buffer, compress_batch_lines, line_index);
+        }
+    }
+
+    static void set_decompressed_cache_budget(engine::Buffer& buffer, const Length line_index, const Length n) {
+        for (Length i = 0; i < n; ++i) {
+            engine::set_decompressed_cache_budget(buffer, 8 * 1024 * 1024);
+        }
+    }
+
+    // reads the line and one half the buffer away in turn, with no budget for decompressed blocks, so every read
+    // decompresses its block, except in buffers small enough to be one block
+    static void copy_line_uncached(engine::Buffer& buffer, const Length line_index, const Length n) {
+        const Length buffer_length = engine::get_buffer_length(buffer);
+        const Length other_line_index = (line_index + buffer_length / 2) % buffer_length;
+        engine::Char data[line_length + 1];
+        engine::set_decompressed_cache_budget(buffer, 0);
+        for (Length i = 0; i < n; ++i) {
+            [[maybe_unused]] volatile Length result =
+                engine::copy_line(buffer, i % 2 == 0 ? line_index : other_line_index, data, line_length + 1);
+        }
+        engine::set_decompressed_cache_budget(buffer, 8 * 1024 * 1024);
+    }
+    // #endregion
+
+    struct Operation {
+        const char* name;
+        operation_function* function;
+        // false for operations that do not depend on the line, which are measured once per buffer
+        bool positional;
+    };
+
+    static const Operation operations[] = {
+        {"insert_empty_line+delete_line", &insert_and_delete_empty_line, true},
+        {"insert_line+delete_line", &insert_and_delete_line, true},
+        {"insert_empty_lines+delete_lines", &insert_and_delete_empty_lines, true},
+        {"insert_lines+delete_lines", &insert_and_delete_lines, true},
+        {"insert_character+delete_character", &insert_and_delete_character, true},
+        {"insert_characters+delete_characters", &insert_and_delete_characters, true},
+        {"insert_empty_line+merge_lines", &insert_empty_line_and_merge_lines, true},
+        {"get_line_length", &get_line_length, true},
+        {"line_empty", &line_empty, true},
+        {"line_to_c_string", &line_to_c_string, true},
+        {"copy_line", &copy_line, true},
+        {"copy_lines", &copy_lines, true},
+        {"insert_lines+compress_lines+delete_lines", &insert_compress_and_delete_lines, true},
+        {"get_buffer_length", &get_buffer_length, false},
+        {"get_buffer_memory_usage", &get_buffer_memory_usage, false},
+        {"buffer_to_c_string", &buffer_to_c_string, false},
+        {"reclaim_buffer_memory", &reclaim_buffer_memory, false},
+    };
+
+    // measured after enable_line_interning, inserting a line the buffer already has
+    static const Operation interned_operations[] = {
+        {"insert_line+delete_line:interned", &insert_and_delete_line, true},
+    };
+
+    // measured after compress_lines of the whole buffer
+    static const Operation compressed_operations[] = {
+        {"copy_line:compressed", &copy_line, true},
+        {"copy_line:compressed,uncached", &copy_line_uncached, true},
+        {"copy_lines:compressed", &copy_lines, true},
+        {"line_to_c_string:compressed", &line_to_c_string, true},
+        {"set_decompressed_cache_budget", &set_decompressed_cache_budget, false},
+    };
+
+    template <Length length>
+    static void measure_operations(const Options& options,
+        const Operation (&measured_operations)[length],
+        engine::Buffer& buffer,
+        const Length number_of_lines) {
+        for (const Operation& operation : measured_operations) {
+            if (options.filter && !strstr(operation.name, options.filter)) {
+                continue;
+            }
+            if (!operation.positional) {
+                print_result(operation.name, number_of_lines, "none", measure(options, operation.function, buffer, 0));
+                continue;
+            }
+            for (const Position position : positions) {
+                const Length line_index = get_line_index(number_of_lines, position);
+                print_result(operation.name,
+                    number_of_lines,
+                    get_position_name(position),
+                    measure(options, operation.function, buffer, line_index));
+            }
+        }
+    }
+
+    static void bench_buffer(const Options& options, const Length number_of_lines) {
+        const bool measure_create = !options.filter || strstr("create_buffer", options.filter);
+        const bool measure_destroy = !options.filter || strstr("destroy_buffer", options.filter);
+        char** lines = create_lines(number_of_lines);
+        const common::AllocationScope scope = common::start_allocation_scope();
+        const U64 start = get_nanoseconds();
+        engine::Buffer& buffer = engine::create_buffer();
+        [[maybe_unused]] const bool inserted = engine::insert_lines(buffer, number_of_lines, 0, lines);
+        const U64 end = get_nanoseconds();
+        const U64 create_allocations = common::get_allocation_counts(scope).allocations;
+        destroy_lines(lines, number_of_lines);
+        if (measure_create) {
+            // create_buffer and insert_lines of all lines at once, per line
+            print_result("create_buffer",
+                number_of_lines,
+                "all",
+                Result{number_of_lines, end - start, create_allocations});
+        }
+
+        measure_operations(options, operations, buffer, number_of_lines);
+
+        // lines inserted from here on are interned, the lines already in the buffer are not
+        const U64 intern_start = get_nanoseconds();
+        engine::enable_line_interning(buffer);
+        const U64 intern_end = get_nanoseconds();
+        if (!options.filter || strstr("enable_line_interning", options.filter)) {
+            print_result("enable_line_interning", number_of_lines, "none", Result{1, intern_end - intern_start, 0});
+        }
+        measure_operations(options, interned_operations, buffer, number_of_lines);
+
+        const common::AllocationScope compress_scope = common::start_allocation_scope();
+        const U64 compress_start = get_nanoseconds();
+        [[maybe_unused]] const bool compressed = engine::compress_lines(buffer, number_of_lines, 0);
+        const U64 compress_end = get_nanoseconds();
+        if (!options.filter || strstr("compress_lines", options.filter)) {
+            // compress_lines of all lines at once, per line
+            print_result("compress_lines",
+                number_of_lines,
+                "all",
+                Result{number_of_lines,
+                    compress_end - compress_start,
+                    common::get_allocation_counts(compress_scope).allocations});
+        }
+        measure_operations(options, compressed_operations, buffer, number_of_lines);
+
+        const U64 destroy_start = get_nanoseconds();
+        engine::destroy_buffer(buffer);
+        const U64 destroy_end = get_nanoseconds();
+        if (measure_destroy) {
+            // per line
+            print_result("destroy_buffer", number_of_lines, "all", Result{number_of_lines, destroy_end - destroy_start, 0});
+        }
+    }
+
+    [[nodiscard]] static bool parse_options(const int argc, char** argv, Options* options) {
+        options->max_lines = 10000000;
+        options->min_time_nanoseconds = 50 * 1000 * 1000;
+        options->filter = nullptr;
+        for (int i = 1; i < argc; ++i) {
+            if (i + 1 < argc && strcmp(argv[i], "--max-lines") == 0) {
+                options->max_lines = strtoull(argv[++i], nullptr, 10);
+            } else if (i + 1 < argc && strcmp(argv[i], "--min-time-ms") == 0) {
+                options->min_time_nanoseconds = strtoull(argv[++i], nullptr, 10) * 1000 * 1000;
+            } else if (i + 1 < argc && strcmp(argv[i], "--filter") == 0) {
+                options->filter = argv[++i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}}
+
+int main(int argc, char** argv) {
+    tte::bench::Options options;
+    if (!tte::bench::parse_options(argc, argv, &options)) {
+        fprintf(stderr, "usage: %s [--max-lines N] [--min-time-ms N] [--filter TEXT]\n", argv[0]);
+        return 1;
+    }
+
+    printf("{\n    \"benchmark\": \"tte_engine_bench\",\n    \"results\": [");
+    for (const tte::Length number_of_lines : tte::bench::line_counts) {
+        if (number_of_lines <= options.max_lines) {
+            tte::bench::bench_buffer(options, number_of_lines);
+        }
+    }
+    printf("\n    ]\n}\n");
+    return 0;
+}
@@ -5,10 +5,37 @@
 
 namespace tte { namespace engine {
     using Char = char;
+    // Buffer
+    // one thread (the writer) may edit a buffer while any number of other threads read it. create_buffer,
+    // destroy_buffer, reclaim_buffer_memory and the functions that edit the buffer are writer only, the functions that
+    // read it can be called from any thread at any time and see every line either as it was before or after an edit.
+    // lines that are edited or deleted are freed once no reader can still be reading them (epoch based reclamation):
+    // readers never block the writer and the writer never waits for readers.
     struct Buffer;
 
     [[nodiscard]] extern Buffer& create_buffer();
+    // destroy_buffer
+    // there must be no readers
     extern void destroy_buffer(Buffer&);
+    // reclaim_buffer_memory
+    // frees the memory of edited and deleted lines that no reader can still be reading. edits do this as they go, call
+    // it when the writer is done editing for a while.
+    extern void reclaim_buffer_memory(Buffer&);
+    // enable_line_interning
+    // lines inserted or loaded afterwards share their data with the identical lines of the buffer (e.g. the repeated
+    // lines of a log), so each copy of a line costs about the line itself. an edited line gets data of its own.
+    // lines already in the buffer keep their data. writer only.
+    extern void enable_line_interning(Buffer&);
+    // compress_lines
+    // compresses the data of the lines (e.g. lines that were not viewed or edited for a while) in blocks of about
+    // 64 KB. reading a compressed line decompresses its block into a cache of recently read blocks, editing it gives
+    // it data of its own again. the memory the lines borrowed from (e.g. the text of a loaded file) is freed once no
+    // line borrows from it. lines that do not compress well are left as they are. writer only.
+    [[nodiscard]] extern bool compress_lines(Buffer&, const Length number_of_lines, const Length line_index);
+    // set_decompressed_cache_budget
+    // bytes of decompressed blocks kept for reading compressed lines, the block read last is kept even if it does not
+    // fit. 8 MB by default. writer only.
+    extern void set_decompressed_cache_budget(Buffer&, const Length budget);
     [[nodiscard]] extern bool insert_empty_line(Buffer&, const Length line_index);
     [[nodiscard]] extern bool insert_line(Buffer&, const Length line_index, const Char* data);
     [[nodiscard]] extern bool insert_line(Buffer&, const Length line_index, const Char* data, const Length data_length);
@@ -37,14 +64,35 @@ namespace tte { namespace engine {
         const Length line_index,
         const Length character_index);
     [[nodiscard]] extern bool merge_lines(Buffer&, const Length line_index);
+    // get_buffer_length
+    // constant time. a reader may see the length from just before or after an edit.
     [[nodiscard]] extern Length get_buffer_length(Buffer&);
     [[nodiscard]] extern Length get_line_length(Buffer&, const Length line_index);
     // line_to_c_string
     // caller owns returned memory
     // may return nullptr
     [[nodiscard]] extern char* line_to_c_string(Buffer&, const Length line_index);
+    // copy_line
+    // copies up to capacity characters of the line to data and returns the length of the line, 0 when there is no such
+    // line. does not allocate for lines that are not compressed, so it can be called for every line drawn.
+    [[nodiscard]] extern Length copy_line(Buffer&, const Length line_index, Char* data, const Length capacity);
+    // copy_lines
+    // copies number_of_lines lines from line_index to data, one after another and each followed by a null character,
+    // as many of them as fit in capacity, and sets their lengths in line_lengths, 0 for lines past the end of the
+    // buffer. returns the capacity all of them need. finds line_index once, so reading the lines in a window costs about
+    // as much as reading the first of them. does not allocate for lines that are not compressed.
+    [[nodiscard]] extern Length copy_lines(Buffer&,
+        const Length number_of_lines,
+        const Length line_index,
+        Char* data,
+        const Length capacity,
+        Length* line_lengths);
     // buffer_to_c_string
     // caller owns returned memory
     [[nodiscard]] extern char* buffer_to_c_string(Buffer&);
     [[nodiscard]] extern bool line_empty(Buffer& buffer, const Length line_index);
+    // get_buffer_memory_usage
+    // bytes allocated by the buffer for its lines and decompressed blocks, memory the lines borrow from (a mapped
+    // snapshot, file contents shared between buffers) is not included
+    [[nodiscard]] extern Length get_buffer_memory_usage(Buffer&);
 }}
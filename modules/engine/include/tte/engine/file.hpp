@@ -0,0 +1,38 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/engine/engine.hpp>
+
+namespace tte { namespace engine {
+    // load_file
+    // appends the lines of the file at path to the end of the buffer, lines are separated by '\n' and a trailing '\n'
+    // does not produce an extra empty line (the inverse of buffer_to_c_string)
+    [[nodiscard]] extern bool load_file(Buffer&, const char* path);
+    // save_file
+    // writes buffer_to_c_string to a temporary file next to path and renames it over path
+    [[nodiscard]] extern bool save_file(Buffer&, const char* path);
+
+    // FileLoad
+    // loads a file progressively: a background thread reads and splits the file into lines, starting with a small
+    // chunk so the first screen is ready quickly, and the writer appends the lines read so far with poll_file_load.
+    // the lines loaded so far can be read and edited while the rest of the file is loading, the rest is appended
+    // after the last line of the buffer. nothing on the calling thread waits for disk I/O.
+    struct FileLoad;
+
+    // start_file_load
+    // same lines as load_file once done
+    [[nodiscard]] extern FileLoad& start_file_load(const char* path);
+    // poll_file_load
+    // appends the lines read so far to the end of the buffer, always the same buffer. writer only.
+    // returns true once all lines have been appended or loading failed
+    [[nodiscard]] extern bool poll_file_load(FileLoad&, Buffer&);
+    // get_file_load_progress
+    // file_size is 0 until the file has been opened
+    extern void get_file_load_progress(FileLoad&, Length* loaded_size, Length* file_size);
+    // file_load_succeeded
+    // valid once poll_file_load returned true
+    [[nodiscard]] extern bool file_load_succeeded(FileLoad&);
+    // finish_file_load
+    // stops loading if it is not done yet, lines that were not appended yet are dropped
+    extern void finish_file_load(FileLoad&);
+}}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/engine/engine.hpp>
+
+namespace tte { namespace engine {
+    // Journal
+    // append-only binary log of the edits made to a buffer since its base file was last saved.
+    // records are written to the journal file every commit and fsynced at most once per fsync interval, so a crash
+    // loses at most one interval of edits. the journal only ever grows by the size of the edits, and adjacent edits
+    // (typing, backspacing) are coalesced when the journal is compacted.
+    struct Journal;
+
+    // open_journal
+    // continues the journal at journal_path if it was written against the current base file, otherwise starts a new one
+    // base_path may not exist yet (new file)
+    // returns nullptr on failure
+    [[nodiscard]] extern Journal* open_journal(const char* journal_path,
+        const char* base_path,
+        const U64 fsync_interval_milliseconds);
+    // close_journal
+    // syncs any pending records before closing
+    extern void close_journal(Journal&);
+
+    // record_*
+    // call after the matching engine function succeeded, with the values it was called with
+    extern void record_insert_empty_lines(Journal&, const Length number_of_lines, const Length line_index);
+    extern void record_insert_line(Journal&, const Length line_index, const Char* data, const Length data_length);
+    extern void record_insert_characters(Journal&,
+        const Length line_index,
+        const Length character_index,
+        const Char* data,
+        const Length data_length);
+    extern void record_delete_lines(Journal&, const Length number_of_lines, const Length line_index);
+    extern void record_delete_characters(Journal&,
+        const Length number_of_characters,
+        const Length line_index,
+        const Length character_index);
+    extern void record_merge_lines(Journal&, const Length line_index);
+
+    // commit_journal
+    // group commit: writes pending records, fsyncs when the fsync interval has elapsed and compacts the journal when
+    // it has grown enough since the last compaction. cheap to call every frame.
+    [[nodiscard]] extern bool commit_journal(Journal&);
+    // sync_journal
+    // writes pending records and fsyncs now
+    [[nodiscard]] extern bool sync_journal(Journal&);
+    // compact_journal
+    // rewrites the journal with adjacent records coalesced
+    [[nodiscard]] extern bool compact_journal(Journal&);
+    // reset_journal
+    // call after the buffer has been saved to the base file, drops all records
+    [[nodiscard]] extern bool reset_journal(Journal&);
+    [[nodiscard]] extern Length get_journal_size(Journal&);
+
+    // has_journal_records
+    // true if there is a journal at journal_path with records in it, which may or may not apply to the base file
+    [[nodiscard]] extern bool has_journal_records(const char* journal_path);
+    // replay_journal
+    // applies the records of the journal at journal_path to a buffer that holds the contents of the base file at
+    // base_path. a torn record at the end of the journal (crash mid write) ends the replay.
+    // returns true when there is no journal to replay
+    // returns false if the journal was not written against this base file or a record could not be applied
+    [[nodiscard]] extern bool replay_journal(Buffer&, const char* journal_path, const char* base_path);
+}}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/engine/engine.hpp>
+
+namespace tte { namespace engine {
+    // Snapshot
+    // versioned session file holding the lines and text of a buffer plus opaque user data (app state). the lines are
+    // stored as the buffer links them, so opening a snapshot maps the file and validates its header, and a buffer
+    // created from it links the lines of the mapping as they are: no line or text is read until it is accessed.
+    struct Snapshot;
+
+    // write_snapshot
+    // writes to a temporary file next to path and renames it over path. writer only, see Buffer
+    [[nodiscard]] extern bool
+    write_snapshot(Buffer&, const char* path, const void* user_data, const Length user_data_size);
+    // open_snapshot
+    // returns nullptr if the file does not exist or is not a valid snapshot of this version
+    [[nodiscard]] extern Snapshot* open_snapshot(const char* path);
+    // close_snapshot
+    // buffers created from the snapshot stay valid
+    extern void close_snapshot(Snapshot&);
+    // get_snapshot_user_data
+    // points into the mapping, valid until the snapshot is closed
+    [[nodiscard]] extern const void* get_snapshot_user_data(Snapshot&, Length* user_data_size);
+    // create_buffer_from_snapshot
+    // the buffer links the lines of the snapshot, so one buffer can be created from a snapshot, nullptr after that
+    [[nodiscard]] extern Buffer* create_buffer_from_snapshot(Snapshot&);
+}}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/common/event.hpp>
+#include <tte/engine/engine.hpp>
+
+namespace tte { namespace engine {
+    // Trace
+    // text log of the events of an editing session and the engine calls each of them made, so real editing patterns
+    // can be replayed by benchmarks (see tte_replay). one record per line:
+    //  tte_trace 1
+    //  cursor <line_index> <character_index>
+    //  event <type> [<keycode> <repeat>]   (keycode and repeat only for key_down and key_up)
+    //  event mouse_wheel <y>
+    //  insert_empty_lines <number_of_lines> <line_index>
+    //  insert_line <line_index> <data_length> <data>
+    //  insert_characters <line_index> <character_index> <data_length> <data>
+    //  delete_lines <number_of_lines> <line_index>
+    //  delete_characters <number_of_characters> <line_index> <character_index>
+    //  merge_lines <line_index>
+    // the engine calls after an event are the calls made while handling it, the calls before the first event set up
+    // the buffer. data is written as is, its length says where it ends.
+    struct TraceWriter;
+    struct Trace;
+
+    enum class TraceRecordType : U8 {
+        Cursor,
+        Event,
+        InsertEmptyLines,
+        InsertLine,
+        InsertCharacters,
+        DeleteLines,
+        DeleteCharacters,
+        MergeLines,
+    };
+
+    struct TraceRecord {
+        TraceRecordType type;
+        // Event
+        common::Event event;
+        // number of lines or characters
+        Length number;
+        Length line_index;
+        Length character_index;
+        // points into the trace, not null terminated, nullptr when data_length is 0
+        const Char* data;
+        Length data_length;
+    };
+
+    // open_trace_writer
+    // starts a new trace at path
+    // returns nullptr on failure
+    [[nodiscard]] extern TraceWriter* open_trace_writer(const char* path);
+    // close_trace_writer
+    // returns false if any record could not be written
+    [[nodiscard]] extern bool close_trace_writer(TraceWriter&);
+
+    // trace_buffer
+    // writes the lines of the buffer as insert_line records, to set up the buffer a trace starts from
+    extern void trace_buffer(TraceWriter&, Buffer&);
+    extern void trace_cursor(TraceWriter&, const Length line_index, const Length character_index);
+    extern void trace_event(TraceWriter&, const common::Event& event);
+    // trace_*
+    // call after the matching engine function succeeded, with the values it was called with
+    extern void trace_insert_empty_lines(TraceWriter&, const Length number_of_lines, const Length line_index);
+    extern void trace_insert_line(TraceWriter&, const Length line_index, const Char* data, const Length data_length);
+    extern void trace_insert_characters(TraceWriter&,
+        const Length line_index,
+        const Length character_index,
+        const Char* data,
+        const Length data_length);
+    extern void trace_delete_lines(TraceWriter&, const Length number_of_lines, const Length line_index);
+    extern void trace_delete_characters(TraceWriter&,
+        const Length number_of_characters,
+        const Length line_index,
+        const Length character_index);
+    extern void trace_merge_lines(TraceWriter&, const Length line_index);
+
+    // load_trace
+    // returns nullptr if the trace can not be read or is malformed
+    [[nodiscard]] extern Trace* load_trace(const char* path);
+    extern void destroy_trace(Trace&);
+    // get_trace_records
+    // valid until the trace is destroyed
+    [[nodiscard]] extern const TraceRecord* get_trace_records(Trace&, Length* number_of_records);
+    // apply_trace_record
+    // makes the engine call of the record, cursor and event records are not engine calls and do nothing
+    [[nodiscard]] extern bool apply_trace_record(Buffer&, const TraceRecord&);
+}}
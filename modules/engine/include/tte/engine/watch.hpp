@@ -0,0 +1,42 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/engine/engine.hpp>
+
+namespace tte { namespace engine {
+    // FileWatch
+    // follows changes other programs make to the file a buffer was loaded from (inotify on linux, otherwise the file
+    // is checked every poll). appended bytes are read from where the file ended and appended to the buffer, so a
+    // growing file is never read again from its start. other changes are reconciled by replacing only the lines
+    // between the unchanged start and unchanged end of the file. the buffer must hold exactly the contents of the file
+    // (no unsaved edits) whenever the watch is polled.
+    struct FileWatch;
+
+    enum class FileChange {
+        None,
+        Appended,
+        Changed,
+        // the file could not be read, the buffer may hold part of the change
+        Failed
+    };
+
+    // watch_file
+    // call right after the buffer was loaded from path
+    // returns nullptr if the file can not be opened
+    [[nodiscard]] extern FileWatch* watch_file(const char* path);
+    // follow_file
+    // watch for an empty buffer that is only ever changed by polling (e.g. a growing log file): the polls read the whole
+    // file and then what is appended to it. when the file changes other than by appending it is read again from its
+    // start. when max_lines is not 0 the oldest lines are deleted to keep at most max_lines lines, and the memory they
+    // were read into is freed.
+    // returns nullptr if the file can not be opened
+    [[nodiscard]] extern FileWatch* follow_file(const char* path, const Length max_lines);
+    extern void unwatch_file(FileWatch&);
+    // poll_file_watch
+    // applies the changes made to the file since the last poll to the buffer, always the same buffer. reads a few MB at
+    // most, the rest is read by the next polls (see is_file_watch_pending). never waits for changes. writer only.
+    [[nodiscard]] extern FileChange poll_file_watch(FileWatch&, Buffer&);
+    // is_file_watch_pending
+    // true when the last poll did not read all of the file, so the next poll has changes without waiting
+    [[nodiscard]] extern bool is_file_watch_pending(FileWatch&);
+}}
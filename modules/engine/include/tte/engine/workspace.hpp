@@ -0,0 +1,56 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/engine/journal.hpp>
+
+namespace tte { namespace engine {
+    // Workspace
+    // the open documents and a memory budget for their buffers. buffers of documents that have not been used
+    // recently are evicted (destroyed) when the workspace is over budget and restored from their file and journal when
+    // used again. files are read once and their contents shared by every buffer made from them, including copies of
+    // the same content under another path.
+    // a workspace and every buffer it gives out must be written from one thread, which is the writer of all of them
+    // (see Buffer): the workspace evicts buffers, and the contents shared between buffers are counted and released
+    // without synchronisation. other threads may still read the buffers as any buffer is read.
+    struct Workspace;
+    struct Document;
+
+    [[nodiscard]] extern Workspace& create_workspace(const Length memory_budget);
+    // destroy_workspace
+    // closes all documents
+    extern void destroy_workspace(Workspace&);
+
+    // open_document
+    // documents that are not read_only are journaled next to path (see Journal), which also restores edits that were
+    // not saved when the editor last exited. read_only documents must not be edited.
+    // the buffer is loaded on the first get_document_buffer
+    [[nodiscard]] extern Document& open_document(Workspace&, const char* path, const bool read_only);
+    // adopt_document
+    // opens a document from a buffer (and its journal, may be nullptr) the caller already restored, the workspace
+    // takes ownership of both
+    [[nodiscard]] extern Document& adopt_document(Workspace&, const char* path, Buffer&, Journal*);
+    // close_document
+    // syncs the journal, edits that were not saved stay in the journal
+    extern void close_document(Workspace&, Document&);
+
+    // get_document_buffer
+    // loads the buffer if it was evicted, makes the document the most recently used one and evicts the least recently
+    // used documents until the workspace is within budget. buffers of other documents may be evicted, so only the
+    // returned buffer stays valid until the next call into the workspace.
+    [[nodiscard]] extern Buffer& get_document_buffer(Workspace&, Document&);
+    // get_document_journal
+    // nullptr for read only documents, and documents whose journal could not be replayed or opened (those documents
+    // are never evicted)
+    [[nodiscard]] extern Journal* get_document_journal(Document&);
+    [[nodiscard]] extern const char* get_document_path(Document&);
+    [[nodiscard]] extern bool is_document_loaded(Document&);
+
+    // enforce_workspace_budget
+    // evicts the least recently used documents, except the most recently used one, until the workspace is within
+    // budget. call after edits, which grow buffers.
+    extern void enforce_workspace_budget(Workspace&);
+    // get_workspace_memory_usage
+    // loaded buffers plus the file contents they share
+    [[nodiscard]] extern Length get_workspace_memory_usage(Workspace&);
+}}
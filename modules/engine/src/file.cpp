@@ -0,0 +1,88 @@
+#include <tte/engine/file.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace tte { namespace engine {
+    bool load_file(Buffer& buffer, const char* path) {
+        TTE_ASSERT(path);
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        const long file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (file_size < 0) {
+            fclose(file);
+            return false;
+        }
+
+        const Length size = static_cast<Length>(file_size);
+        Char* data = static_cast<Char*>(malloc(sizeof(Char) * (size + 1)));
+        const bool read_success = size == 0 || fread(data, size, 1, file) == 1;
+        fclose(file);
+        if (!read_success) {
+            free(data);
+            return false;
+        }
+
+        Length number_of_lines = 0;
+        for (Length i = 0; i < size; ++i) {
+            if (data[i] == '\n') {
+                ++number_of_lines;
+            }
+        }
+        if (size != 0 && data[size - 1] != '\n') {
+            ++number_of_lines;
+        }
+
+        const Char** data_array = static_cast<const Char**>(malloc(sizeof(const Char*) * number_of_lines));
+        Length* data_length_array = static_cast<Length*>(malloc(sizeof(Length) * number_of_lines));
+        Length line_begin = 0;
+        Length line = 0;
+        for (Length i = 0; i <= size && line < number_of_lines; ++i) {
+            if (i == size || data[i] == '\n') {
+                data_array[line] = data + line_begin;
+                data_length_array[line] = i - line_begin;
+                ++line;
+                line_begin = i + 1;
+            }
+        }
+        TTE_ASSERT(line == number_of_lines);
+
+        const bool result =
+            insert_lines(buffer, number_of_lines, get_buffer_length(buffer), data_array, data_length_array);
+        free(static_cast<void*>(data_length_array));
+        free(static_cast<void*>(data_array));
+        free(data);
+        return result;
+    }
+
+    bool save_file(Buffer& buffer, const char* path) {
+        TTE_ASSERT(path);
+        const Length path_length = strlen(path);
+        char* temporary_path = static_cast<char*>(malloc(sizeof(char) * (path_length + 5)));
+        memcpy(temporary_path, path, path_length);
+        memcpy(temporary_path + path_length, ".tmp", 5);
+
+        char* data = buffer_to_c_string(buffer);
+        const Length size = strlen(data);
+        bool result = false;
+        if (FILE* file = fopen(temporary_path, "wb")) {
+            result = size == 0 || fwrite(data, size, 1, file) == 1;
+            result = fclose(file) == 0 && result;
+            result = result && rename(temporary_path, path) == 0;
+            if (!result) {
+                remove(temporary_path);
+            }
+        }
+
+        free(data);
+        free(temporary_path);
+        return result;
+    }
+}}
@@ -0,0 +1,716 @@
+#include <tte/engine/journal.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace tte { namespace engine {
+    // #region internal
+    // file layout (native endianness, the journal never leaves the machine that wrote it):
+    //  header: U32 magic, U32 version, U64 base file size, S64 base file modification time seconds, S64 nanoseconds
+    //  record: U32 checksum (of the rest of the record), U8 type, U64 number, U64 line_index, U64 character_index,
+    //          U64 data_length, data
+    static const constexpr U32 journal_magic = 0x4A455454;
+    static const constexpr U32 journal_version = 2;
+    static const constexpr Length journal_header_size = sizeof(U32) * 2 + sizeof(U64) + sizeof(S64) * 2;
+    static const constexpr Length record_header_size = sizeof(U32) + sizeof(U8) + sizeof(U64) * 4;
+    static const constexpr Length journal_compaction_threshold = 1024 * 1024;
+
+    enum class RecordType : U8 {
+        InsertEmptyLines = 1,
+        InsertLine,
+        InsertCharacters,
+        DeleteLines,
+        DeleteCharacters,
+        MergeLines,
+    };
+
+    struct Record {
+        RecordType type;
+        Length number;
+        Length line_index;
+        Length character_index;
+        // owned, nullptr when data_length is 0
+        Char* data;
+        Length data_length;
+    };
+
+    struct BaseIdentity {
+        U64 size;
+        S64 modification_time_seconds;
+        S64 modification_time_nanoseconds;
+    };
+
+    struct Journal {
+        int file;
+        char* path;
+        char* base_path;
+        BaseIdentity base_identity;
+        U64 fsync_interval_milliseconds;
+        U64 last_sync_milliseconds;
+        bool needs_sync;
+        // bytes in the journal file
+        Length size;
+        Length size_after_compaction;
+        Record* pending;
+        Length pending_length;
+        Length pending_capacity;
+    };
+
+    [[nodiscard]] static U64 get_milliseconds() {
+        return static_cast<U64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                                    .count());
+    }
+
+    [[nodiscard]] static char* copy_string(const char* string) {
+        const Length length = strlen(string);
+        char* result = static_cast<char*>(malloc(sizeof(char) * (length + 1)));
+        memcpy(result, string, length + 1);
+        return result;
+    }
+
+    [[nodiscard]] static BaseIdentity get_base_identity(const char* base_path) {
+        struct stat data;
+        if (stat(base_path, &data) == 0) {
+#if defined(__APPLE__)
+            return BaseIdentity{static_cast<U64>(data.st_size),
+                static_cast<S64>(data.st_mtimespec.tv_sec),
+                static_cast<S64>(data.st_mtimespec.tv_nsec)};
+#else
+            return BaseIdentity{static_cast<U64>(data.st_size),
+                static_cast<S64>(data.st_mtim.tv_sec),
+                static_cast<S64>(data.st_mtim.tv_nsec)};
+#endif
+        }
+        return BaseIdentity{0, 0, 0};
+    }
+
+    [[nodiscard]] static bool is_same_base_identity(const BaseIdentity& a, const BaseIdentity& b) {
+        return a.size == b.size && a.modification_time_seconds == b.modification_time_seconds &&
+            a.modification_time_nanoseconds == b.modification_time_nanoseconds;
+    }
+
+    // fsyncs the directory holding path, so a rename in it survives a crash
+    [[nodiscard]] static bool sync_parent_directory(const char* path) {
+        const char* const slash = strrchr(path, '/');
+        int directory;
+        if (!slash) {
+            directory = open(".", O_RDONLY);
+        } else {
+            const Length length = slash == path ? 1 : static_cast<Length>(slash - path);
+            char* directory_path = static_cast<char*>(malloc(sizeof(char) * (length + 1)));
+            memcpy(directory_path, path, length);
+            directory_path[length] = '\0';
+            directory = open(directory_path, O_RDONLY);
+            free(directory_path);
+        }
+        if (directory == -1) {
+            return false;
+        }
+        const bool result = fsync(directory) == 0;
+        close(directory);
+        return result;
+    }
+
+    // fnv-1a
+    [[nodiscard]] static U32 checksum(const U8* data, const Length size) {
+        U32 result = 2166136261u;
+        for (Length i = 0; i < size; ++i) {
+            result = (result ^ data[i]) * 16777619u;
+        }
+        return result;
+    }
+
+    // caller owns returned memory
+    // may return nullptr
+    [[nodiscard]] static U8* read_whole_file(const char* path, Length* size) {
+        const int file = open(path, O_RDONLY);
+        if (file == -1) {
+            return nullptr;
+        }
+
+        struct stat data;
+        if (fstat(file, &data) != 0) {
+            close(file);
+            return nullptr;
+        }
+
+        *size = static_cast<Length>(data.st_size);
+        U8* result = static_cast<U8*>(malloc(*size + 1));
+        Length read_size = 0;
+        while (read_size < *size) {
+            const ssize_t amount = read(file, result + read_size, *size - read_size);
+            if (amount <= 0) {
+                break;
+            }
+            read_size += static_cast<Length>(amount);
+        }
+        close(file);
+
+        if (read_size != *size) {
+            free(result);
+            return nullptr;
+        }
+        return result;
+    }
+
+    [[nodiscard]] static bool write_all(const int file, const U8* data, const Length size) {
+        Length written = 0;
+        while (written < size) {
+            const ssize_t amount = write(file, data + written, size - written);
+            if (amount <= 0) {
+                return false;
+            }
+            written += static_cast<Length>(amount);
+        }
+        return true;
+    }
+
+    static void write_header(U8* out, const BaseIdentity& base_identity) {
+        memcpy(out, &journal_magic, sizeof(U32));
+        memcpy(out + sizeof(U32), &journal_version, sizeof(U32));
+        memcpy(out + sizeof(U32) * 2, &base_identity.size, sizeof(U64));
+        memcpy(out + sizeof(U32) * 2 + sizeof(U64), &base_identity.modification_time_seconds, sizeof(S64));
+        memcpy(out + sizeof(U32) * 2 + sizeof(U64) + sizeof(S64), &base_identity.modification_time_nanoseconds,
+            sizeof(S64));
+    }
+
+    [[nodiscard]] static bool read_header(const U8* data, const Length size, BaseIdentity* base_identity) {
+        if (size < journal_header_size) {
+            return false;
+        }
+
+        U32 magic;
+        U32 version;
+        memcpy(&magic, data, sizeof(U32));
+        memcpy(&version, data + sizeof(U32), sizeof(U32));
+        if (magic != journal_magic || version != journal_version) {
+            return false;
+        }
+
+        memcpy(&base_identity->size, data + sizeof(U32) * 2, sizeof(U64));
+        memcpy(&base_identity->modification_time_seconds, data + sizeof(U32) * 2 + sizeof(U64), sizeof(S64));
+        memcpy(&base_identity->modification_time_nanoseconds, data + sizeof(U32) * 2 + sizeof(U64) + sizeof(S64),
+            sizeof(S64));
+        return true;
+    }
+
+    [[nodiscard]] static Length get_record_size(const Record& record) { return record_header_size + record.data_length; }
+
+    static void write_record(U8* out, const Record& record) {
+        U8* at = out + sizeof(U32);
+        *at = static_cast<U8>(record.type);
+        at += sizeof(U8);
+        memcpy(at, &record.number, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(at, &record.line_index, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(at, &record.character_index, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(at, &record.data_length, sizeof(U64));
+        at += sizeof(U64);
+        if (record.data_length != 0) {
+            memcpy(at, record.data, record.data_length);
+        }
+        const U32 sum = checksum(out + sizeof(U32), get_record_size(record) - sizeof(U32));
+        memcpy(out, &sum, sizeof(U32));
+    }
+
+    // returns the number of bytes the record takes up, 0 when the record is torn or corrupt
+    // result->data is owned by the caller when the return value is not 0
+    [[nodiscard]] static Length read_record(const U8* data, const Length size, Record* result) {
+        if (size < record_header_size) {
+            return 0;
+        }
+
+        const U8* at = data + sizeof(U32);
+        const U8 type = *at;
+        at += sizeof(U8);
+        memcpy(&result->number, at, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(&result->line_index, at, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(&result->character_index, at, sizeof(U64));
+        at += sizeof(U64);
+        memcpy(&result->data_length, at, sizeof(U64));
+        at += sizeof(U64);
+        if (result->data_length > size - record_header_size ||
+            type < static_cast<U8>(RecordType::InsertEmptyLines) || type > static_cast<U8>(RecordType::MergeLines)) {
+            return 0;
+        }
+
+        U32 sum;
+        memcpy(&sum, data, sizeof(U32));
+        if (sum != checksum(data + sizeof(U32), record_header_size - sizeof(U32) + result->data_length)) {
+            return 0;
+        }
+
+        result->type = static_cast<RecordType>(type);
+        result->data = nullptr;
+        if (result->data_length != 0) {
+            result->data = static_cast<Char*>(malloc(sizeof(Char) * result->data_length));
+            memcpy(result->data, at, result->data_length);
+        }
+        return record_header_size + result->data_length;
+    }
+
+    // number of bytes from the beginning of data that hold valid records (excluding the header)
+    [[nodiscard]] static Length get_valid_records_size(const U8* data, const Length size) {
+        Length at = 0;
+        Record record;
+        while (Length record_size = read_record(data + at, size - at, &record)) {
+            free(record.data);
+            at += record_size;
+        }
+        return at;
+    }
+
+    static void free_records(Record* records, const Length length) {
+        for (Length i = 0; i < length; ++i) {
+            free(records[i].data);
+        }
+        free(records);
+    }
+
+    // an insert that has since been fully deleted again
+    [[nodiscard]] static bool is_empty_record(const Record& record) {
+        return record.type == RecordType::InsertCharacters && record.data_length == 0;
+    }
+
+    // coalesces next into previous when applying previous then next is equivalent to applying the merged previous.
+    // previous may become an empty record, which the caller should drop.
+    [[nodiscard]] static bool merge_records(Record& previous, const Record& next) {
+        if (previous.line_index != next.line_index) {
+            return false;
+        }
+
+        if (previous.type == RecordType::InsertCharacters && next.type == RecordType::InsertCharacters) {
+            // typing
+            if (next.character_index < previous.character_index ||
+                next.character_index > previous.character_index + previous.data_length) {
+                return false;
+            }
+            const Length offset = next.character_index - previous.character_index;
+            Char* data = static_cast<Char*>(malloc(sizeof(Char) * (previous.data_length + next.data_length)));
+            if (offset != 0) {
+                memcpy(data, previous.data, offset);
+            }
+            memcpy(data + offset, next.data, next.data_length);
+            if (previous.data_length - offset != 0) {
+                memcpy(data + offset + next.data_length, previous.data + offset, previous.data_length - offset);
+            }
+            free(previous.data);
+            previous.data = data;
+            previous.data_length += next.data_length;
+            return true;
+        }
+
+        if (previous.type == RecordType::InsertCharacters && next.type == RecordType::DeleteCharacters) {
+            // deleting characters that were just typed
+            if (next.character_index < previous.character_index ||
+                next.character_index + next.number > previous.character_index + previous.data_length) {
+                return false;
+            }
+            const Length offset = next.character_index - previous.character_index;
+            memmove(previous.data + offset,
+                previous.data + offset + next.number,
+                previous.data_length - offset - next.number);
+            previous.data_length -= next.number;
+            return true;
+        }
+
+        if (previous.type == RecordType::DeleteCharacters && next.type == RecordType::DeleteCharacters) {
+            if (next.character_index + next.number == previous.character_index) {
+                // backspace
+                previous.character_index = next.character_index;
+                previous.number += next.number;
+                return true;
+            } else if (next.character_index == previous.character_index) {
+                // delete
+                previous.number += next.number;
+                return true;
+            }
+            return false;
+        }
+
+        if (previous.type == RecordType::DeleteLines && next.type == RecordType::DeleteLines) {
+            previous.number += next.number;
+            return true;
+        }
+
+        return false;
+    }
+
+    // takes ownership of record.data
+    static void push_record(Record** records, Length* length, Length* capacity, const Record& record) {
+        if (*length != 0 && merge_records((*records)[*length - 1], record)) {
+            free(record.data);
+            if (is_empty_record((*records)[*length - 1])) {
+                free((*records)[*length - 1].data);
+                --*length;
+            }
+            return;
+        }
+
+        if (*length == *capacity) {
+            *capacity = *capacity == 0 ? 16 : *capacity * 2;
+            Record* new_records = static_cast<Record*>(malloc(sizeof(Record) * *capacity));
+            if (*length != 0) {
+                memcpy(new_records, *records, sizeof(Record) * *length);
+            }
+            free(*records);
+            *records = new_records;
+        }
+        (*records)[*length] = record;
+        ++*length;
+    }
+
+    static void push_pending(Journal& journal,
+        const RecordType type,
+        const Length number,
+        const Length line_index,
+        const Length character_index,
+        const Char* data,
+        const Length data_length) {
+        Record record{type, number, line_index, character_index, nullptr, data_length};
+        if (data_length != 0) {
+            record.data = static_cast<Char*>(malloc(sizeof(Char) * data_length));
+            memcpy(record.data, data, data_length);
+        }
+        push_record(&journal.pending, &journal.pending_length, &journal.pending_capacity, record);
+    }
+
+    [[nodiscard]] static U8* serialize_records(const Record* records, const Length length, Length* size) {
+        *size = 0;
+        for (Length i = 0; i < length; ++i) {
+            *size += get_record_size(records[i]);
+        }
+
+        U8* result = static_cast<U8*>(malloc(*size));
+        U8* at = result;
+        for (Length i = 0; i < length; ++i) {
+            write_record(at, records[i]);
+            at += get_record_size(records[i]);
+        }
+        return result;
+    }
+
+    [[nodiscard]] static bool write_pending(Journal& journal) {
+        if (journal.pending_length == 0) {
+            return true;
+        }
+
+        Length size;
+        U8* data = serialize_records(journal.pending, journal.pending_length, &size);
+        const bool result = write_all(journal.file, data, size);
+        free(data);
+        if (!result) {
+            // the file may now end in a torn record, the next open_journal or replay_journal ignores it
+            return false;
+        }
+
+        for (Length i = 0; i < journal.pending_length; ++i) {
+            free(journal.pending[i].data);
+        }
+        journal.pending_length = 0;
+        journal.size += size;
+        journal.needs_sync = true;
+        return true;
+    }
+
+    [[nodiscard]] static bool start_new_journal(Journal& journal) {
+        U8 header[journal_header_size];
+        write_header(header, journal.base_identity);
+        if (ftruncate(journal.file, 0) != 0 || lseek(journal.file, 0, SEEK_SET) != 0 ||
+            !write_all(journal.file, header, journal_header_size) || fsync(journal.file) != 0) {
+            return false;
+        }
+        journal.size = journal.size_after_compaction = journal_header_size;
+        journal.needs_sync = false;
+        journal.last_sync_milliseconds = get_milliseconds();
+        return true;
+    }
+
+    [[nodiscard]] static bool apply_record(Buffer& buffer, const Record& record) {
+        switch (record.type) {
+            case RecordType::InsertEmptyLines: {
+                return insert_empty_lines(buffer, record.number, record.line_index);
+            }
+            case RecordType::InsertLine: {
+                return insert_line(buffer, record.line_index, record.data ? record.data : "", record.data_length);
+            }
+            case RecordType::InsertCharacters: {
+                return insert_characters(buffer,
+                    record.line_index,
+                    record.character_index,
+                    record.data ? record.data : "",
+                    record.data_length);
+            }
+            case RecordType::DeleteLines: {
+                return delete_lines(buffer, record.number, record.line_index);
+            }
+            case RecordType::DeleteCharacters: {
+                return delete_characters(buffer, record.number, record.line_index, record.character_index);
+            }
+            case RecordType::MergeLines: {
+                return merge_lines(buffer, record.line_index);
+            }
+        }
+        return false;
+    }
+
+    // #endregion
+
+    Journal* open_journal(const char* journal_path, const char* base_path, const U64 fsync_interval_milliseconds) {
+        TTE_ASSERT(journal_path);
+        TTE_ASSERT(base_path);
+        const BaseIdentity base_identity = get_base_identity(base_path);
+
+        // continue an existing journal of the same base file, dropping a torn record at its end
+        Length valid_size = 0;
+        Length existing_size;
+        if (U8* existing = read_whole_file(journal_path, &existing_size)) {
+            BaseIdentity existing_base_identity;
+            if (read_header(existing, existing_size, &existing_base_identity) &&
+                is_same_base_identity(existing_base_identity, base_identity)) {
+                valid_size = journal_header_size +
+                    get_valid_records_size(existing + journal_header_size, existing_size - journal_header_size);
+            }
+            free(existing);
+        }
+
+        const int file = open(journal_path, O_WRONLY | O_CREAT, 0644);
+        if (file == -1) {
+            TTE_DBG("Failed to open journal: %s", journal_path);
+            return nullptr;
+        }
+
+        Journal* journal = static_cast<Journal*>(malloc(sizeof(Journal)));
+        memset(journal, 0, sizeof(Journal));
+        journal->file = file;
+        journal->path = copy_string(journal_path);
+        journal->base_path = copy_string(base_path);
+        journal->base_identity = base_identity;
+        journal->fsync_interval_milliseconds = fsync_interval_milliseconds;
+
+        bool success;
+        if (valid_size == 0) {
+            success = start_new_journal(*journal);
+        } else {
+            success = ftruncate(file, static_cast<off_t>(valid_size)) == 0 &&
+                lseek(file, static_cast<off_t>(valid_size), SEEK_SET) == static_cast<off_t>(valid_size);
+            journal->size = journal->size_after_compaction = valid_size;
+            journal->last_sync_milliseconds = get_milliseconds();
+        }
+
+        if (!success) {
+            close_journal(*journal);
+            return nullptr;
+        }
+        return journal;
+    }
+
+    void close_journal(Journal& journal) {
+        if (!sync_journal(journal)) {
+            TTE_DBG("Failed to sync journal: %s", journal.path);
+        }
+        close(journal.file);
+        free_records(journal.pending, journal.pending_length);
+        free(journal.path);
+        free(journal.base_path);
+        free(&journal);
+    }
+
+    void record_insert_empty_lines(Journal& journal, const Length number_of_lines, const Length line_index) {
+        if (number_of_lines != 0) {
+            push_pending(journal, RecordType::InsertEmptyLines, number_of_lines, line_index, 0, nullptr, 0);
+        }
+    }
+
+    void record_insert_line(Journal& journal, const Length line_index, const Char* data, const Length data_length) {
+        push_pending(journal, RecordType::InsertLine, 1, line_index, 0, data, data_length);
+    }
+
+    void record_insert_characters(Journal& journal,
+        const Length line_index,
+        const Length character_index,
+        const Char* data,
+        const Length data_length) {
+        if (data_length != 0) {
+            push_pending(journal, RecordType::InsertCharacters, 0, line_index, character_index, data, data_length);
+        }
+    }
+
+    void record_delete_lines(Journal& journal, const Length number_of_lines, const Length line_index) {
+        if (number_of_lines != 0) {
+            push_pending(journal, RecordType::DeleteLines, number_of_lines, line_index, 0, nullptr, 0);
+        }
+    }
+
+    void record_delete_characters(Journal& journal,
+        const Length number_of_characters,
+        const Length line_index,
+        const Length character_index) {
+        if (number_of_characters != 0) {
+            push_pending(
+                journal, RecordType::DeleteCharacters, number_of_characters, line_index, character_index, nullptr, 0);
+        }
+    }
+
+    void record_merge_lines(Journal& journal, const Length line_index) {
+        push_pending(journal, RecordType::MergeLines, 0, line_index, 0, nullptr, 0);
+    }
+
+    bool commit_journal(Journal& journal) {
+        if (!write_pending(journal)) {
+            return false;
+        }
+
+        const U64 now = get_milliseconds();
+        if (journal.needs_sync && now - journal.last_sync_milliseconds >= journal.fsync_interval_milliseconds) {
+            if (fsync(journal.file) != 0) {
+                return false;
+            }
+            journal.needs_sync = false;
+            journal.last_sync_milliseconds = now;
+        }
+
+        if (journal.size >= journal_compaction_threshold && journal.size >= journal.size_after_compaction * 2) {
+            return compact_journal(journal);
+        }
+        return true;
+    }
+
+    bool sync_journal(Journal& journal) {
+        if (!write_pending(journal)) {
+            return false;
+        }
+
+        if (journal.needs_sync) {
+            if (fsync(journal.file) != 0) {
+                return false;
+            }
+            journal.needs_sync = false;
+            journal.last_sync_milliseconds = get_milliseconds();
+        }
+        return true;
+    }
+
+    bool compact_journal(Journal& journal) {
+        if (!sync_journal(journal)) {
+            return false;
+        }
+
+        Length size;
+        U8* data = read_whole_file(journal.path, &size);
+        if (!data) {
+            return false;
+        }
+        TTE_ASSERT(size == journal.size);
+
+        Record* records = nullptr;
+        Length length = 0;
+        Length capacity = 0;
+        Length at = journal_header_size;
+        Record record;
+        while (Length record_size = read_record(data + at, size - at, &record)) {
+            push_record(&records, &length, &capacity, record);
+            at += record_size;
+        }
+
+        Length records_size;
+        U8* records_data = serialize_records(records, length, &records_size);
+        free_records(records, length);
+
+        // write the compacted journal next to the journal and rename it over, so a crash leaves one or the other
+        const Length path_length = strlen(journal.path);
+        char* temporary_path = static_cast<char*>(malloc(sizeof(char) * (path_length + 5)));
+        memcpy(temporary_path, journal.path, path_length);
+        memcpy(temporary_path + path_length, ".tmp", 5);
+
+        bool result = false;
+        const int file = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file != -1) {
+            result = write_all(file, data, journal_header_size) && write_all(file, records_data, records_size) &&
+                fsync(file) == 0 && rename(temporary_path, journal.path) == 0;
+            if (result) {
+                close(journal.file);
+                journal.file = file;
+                journal.size = journal.size_after_compaction = journal_header_size + records_size;
+                // the rename is durable only once the directory entry is
+                result = sync_parent_directory(journal.path);
+            } else {
+                close(file);
+                remove(temporary_path);
+            }
+        }
+
+        free(temporary_path);
+        free(records_data);
+        free(data);
+        return result;
+    }
+
+    bool reset_journal(Journal& journal) {
+        free_records(journal.pending, journal.pending_length);
+        journal.pending = nullptr;
+        journal.pending_length = 0;
+        journal.pending_capacity = 0;
+        journal.base_identity = get_base_identity(journal.base_path);
+        return start_new_journal(journal);
+    }
+
+    Length get_journal_size(Journal& journal) {
+        Length result = journal.size;
+        for (Length i = 0; i < journal.pending_length; ++i) {
+            result += get_record_size(journal.pending[i]);
+        }
+        return result;
+    }
+
+    bool has_journal_records(const char* journal_path) {
+        TTE_ASSERT(journal_path);
+        struct stat data;
+        return stat(journal_path, &data) == 0 && static_cast<Length>(data.st_size) > journal_header_size;
+    }
+
+    bool replay_journal(Buffer& buffer, const char* journal_path, const char* base_path) {
+        TTE_ASSERT(journal_path);
+        TTE_ASSERT(base_path);
+        Length size;
+        U8* data = read_whole_file(journal_path, &size);
+        if (!data) {
+            // nothing to replay
+            return true;
+        }
+
+        BaseIdentity journal_base_identity;
+        const BaseIdentity base_identity = get_base_identity(base_path);
+        if (!read_header(data, size, &journal_base_identity) ||
+            !is_same_base_identity(journal_base_identity, base_identity)) {
+            free(data);
+            return false;
+        }
+
+        bool result = true;
+        Length at = journal_header_size;
+        Record record;
+        while (Length record_size = read_record(data + at, size - at, &record)) {
+            result = apply_record(buffer, record);
+            free(record.data);
+            if (!result) {
+                break;
+            }
+            at += record_size;
+        }
+
+        free(data);
+        return result;
+    }
+}}
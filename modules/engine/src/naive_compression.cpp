@@ -0,0 +1,401 @@
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    // of the uncompressed data of a block. larger blocks compress better, smaller blocks are faster to decompress
+    // when only one of their lines is read.
+    static const constexpr Length compressed_block_size = 64 * 1024;
+    static const constexpr Length default_decompressed_cache_budget = 8 * 1024 * 1024;
+
+    // the codec is an LZ77 in the style of LZ4. the compressed data is a list of sequences, each a token byte with the
+    // number of literals in the high 4 bits and the match length minus min_match_length in the low 4 bits, then the
+    // literals, then the 2 byte offset back to the match. a length of 15 is continued by the bytes after the literals
+    // (after the offset for the match length), each adding up to 255. the last sequence has literals only.
+    static const constexpr Length min_match_length = 4;
+    static const constexpr Length max_match_offset = 0xFFFF;
+    static const constexpr Length match_table_bits = 12;
+
+    // a block of compressed lines, allocated together with the lines and followed by the compressed data
+    struct CompressedBlock {
+        // memory is the block itself
+        Storage storage;
+        DecompressedCache* cache;
+        Length number_of_lines;
+        Length decompressed_size;
+        Length compressed_size;
+        // lines of the block that are not retired, the block is removed from the buffer when none are left. writer
+        // only.
+        Length line_count;
+        // nullptr when the block is not in the cache. decompressed, newer and older are guarded by the cache mutex.
+        Char* decompressed;
+        CompressedBlock* newer;
+        CompressedBlock* older;
+    };
+
+    // the recently read blocks of a buffer, decompressed
+    struct DecompressedCache {
+        pthread_mutex_t mutex;
+        Buffer* buffer;
+        Length budget;
+        Length size;
+        CompressedBlock* newest;
+        CompressedBlock* oldest;
+    };
+
+    [[nodiscard]] static inline Line* get_block_lines(CompressedBlock& block) {
+        return reinterpret_cast<Line*>(&block + 1);
+    }
+
+    [[nodiscard]] static inline U8* get_compressed_data(CompressedBlock& block) {
+        return reinterpret_cast<U8*>(get_block_lines(block) + block.number_of_lines);
+    }
+
+    [[nodiscard]] static inline CompressedBlock& get_block(const Line& line) {
+        TTE_ASSERT(line.flags & line_flags::compressed_data);
+        return *reinterpret_cast<CompressedBlock*>(line.data);
+    }
+
+    [[nodiscard]] static inline U32 read_u32(const U8* data) {
+        U32 result;
+        memcpy(&result, data, sizeof(U32));
+        return result;
+    }
+
+    // worst case size of the compressed data
+    [[nodiscard]] static inline Length get_compress_bound(const Length size) { return size + size / 255 + 16; }
+
+    // writes the part of a length over 15
+    [[nodiscard]] static inline U8* write_length(U8* out, Length length) {
+        for (; length >= 255; length -= 255) {
+            *out++ = 255;
+        }
+        *out++ = static_cast<U8>(length);
+        return out;
+    }
+
+    [[nodiscard]] static inline Length read_length(const U8*& data) {
+        Length result = 0;
+        U8 byte;
+        do {
+            byte = *data++;
+            result += byte;
+        } while (byte == 255);
+        return result;
+    }
+
+    // match_length is 0 for the last sequence
+    [[nodiscard]] static U8* write_sequence(U8* out,
+        const U8* literals,
+        const Length literal_length,
+        const Length offset,
+        const Length match_length) {
+        const Length match_code = match_length == 0 ? 0 : match_length - min_match_length;
+        *out++ = static_cast<U8>((std::min<Length>(literal_length, 15) << 4) | std::min<Length>(match_code, 15));
+        if (literal_length >= 15) {
+            out = write_length(out, literal_length - 15);
+        }
+        memcpy(out, literals, literal_length);
+        out += literal_length;
+        if (match_length != 0) {
+            out[0] = static_cast<U8>(offset & 0xFF);
+            out[1] = static_cast<U8>(offset >> 8);
+            out += 2;
+            if (match_code >= 15) {
+                out = write_length(out, match_code - 15);
+            }
+        }
+        return out;
+    }
+
+    // compress
+    // out must have room for get_compress_bound(size) bytes
+    // returns the size of the compressed data
+    [[nodiscard]] static Length compress(const U8* data, const Length size, U8* out) {
+        // the last position of each hashed 4 bytes, a match is only used after checking the bytes do match
+        U32 table[1 << match_table_bits];
+        memset(table, 0, sizeof(table));
+        U8* const out_begin = out;
+        Length anchor = 0;
+        Length i = 0;
+        while (i + min_match_length <= size) {
+            const U32 sequence = read_u32(data + i);
+            const U32 slot = (sequence * 2654435761u) >> (32 - match_table_bits);
+            const Length candidate = table[slot];
+            table[slot] = static_cast<U32>(i);
+            if (candidate < i && i - candidate <= max_match_offset && read_u32(data + candidate) == sequence) {
+                Length match_length = min_match_length;
+                while (i + match_length < size && data[candidate + match_length] == data[i + match_length]) {
+                    ++match_length;
+                }
+                out = write_sequence(out, data + anchor, i - anchor, i - candidate, match_length);
+                i += match_length;
+                anchor = i;
+            } else {
+                ++i;
+            }
+        }
+        out = write_sequence(out, data + anchor, size - anchor, 0, 0);
+        return static_cast<Length>(out - out_begin);
+    }
+
+    static void decompress(const U8* data, const Length size, U8* out, [[maybe_unused]] const Length out_size) {
+        const U8* const end = data + size;
+        [[maybe_unused]] U8* const out_begin = out;
+        for (;;) {
+            const U8 token = *data++;
+            Length literal_length = static_cast<Length>(token >> 4);
+            if (literal_length == 15) {
+                literal_length += read_length(data);
+            }
+            memcpy(out, data, literal_length);
+            out += literal_length;
+            data += literal_length;
+            if (data == end) {
+                break;
+            }
+
+            const Length offset = static_cast<Length>(data[0]) | static_cast<Length>(data[1]) << 8;
+            data += 2;
+            Length match_length = static_cast<Length>(token & 15);
+            if (match_length == 15) {
+                match_length += read_length(data);
+            }
+            match_length += min_match_length;
+            const U8* match = out - offset;
+            if (offset >= match_length) {
+                memcpy(out, match, match_length);
+            } else {
+                // the match repeats the bytes it is copying
+                for (Length i = 0; i < match_length; ++i) {
+                    out[i] = match[i];
+                }
+            }
+            out += match_length;
+        }
+        TTE_ASSERT(out == out_begin + out_size);
+    }
+
+    // the cache mutex must be locked
+    static void unlink_block(DecompressedCache& cache, CompressedBlock& block) {
+        (block.newer ? block.newer->older : cache.newest) = block.older;
+        (block.older ? block.older->newer : cache.oldest) = block.newer;
+        block.newer = nullptr;
+        block.older = nullptr;
+    }
+
+    // the cache mutex must be locked
+    static void evict_block(DecompressedCache& cache, CompressedBlock& block) {
+        unlink_block(cache, block);
+        free(block.decompressed);
+        block.decompressed = nullptr;
+        cache.size -= block.decompressed_size;
+        cache.buffer->memory_usage.fetch_sub(block.decompressed_size, std::memory_order_relaxed);
+    }
+
+    // get_decompressed
+    // the decompressed data of block, which becomes the newest block of the cache. the oldest blocks are evicted to
+    // keep the cache within its budget, except for block itself. the cache mutex must be locked.
+    [[nodiscard]] static const Char* get_decompressed(DecompressedCache& cache, CompressedBlock& block) {
+        if (block.decompressed) {
+            unlink_block(cache, block);
+        } else {
+            while (cache.oldest && cache.size + block.decompressed_size > cache.budget) {
+                evict_block(cache, *cache.oldest);
+            }
+            block.decompressed = static_cast<Char*>(malloc(sizeof(Char) * block.decompressed_size));
+            decompress(get_compressed_data(block),
+                block.compressed_size,
+                reinterpret_cast<U8*>(block.decompressed),
+                block.decompressed_size);
+            cache.size += block.decompressed_size;
+            cache.buffer->memory_usage.fetch_add(block.decompressed_size, std::memory_order_relaxed);
+        }
+        block.older = cache.newest;
+        (cache.newest ? cache.newest->newer : cache.oldest) = &block;
+        cache.newest = &block;
+        return block.decompressed;
+    }
+
+    static void release_compressed_block(Storage& storage) {
+        CompressedBlock& block = reinterpret_cast<CompressedBlock&>(storage);
+        DecompressedCache& cache = *block.cache;
+        pthread_mutex_lock(&cache.mutex);
+        if (block.decompressed) {
+            evict_block(cache, block);
+        }
+        pthread_mutex_unlock(&cache.mutex);
+        free(&block);
+    }
+
+    [[nodiscard]] static DecompressedCache& get_decompressed_cache(Buffer& buffer) {
+        if (!buffer.decompressed_cache) {
+            DecompressedCache* cache = static_cast<DecompressedCache*>(malloc(sizeof(DecompressedCache)));
+            memset(static_cast<void*>(cache), 0, sizeof(DecompressedCache));
+            pthread_mutex_init(&cache->mutex, nullptr);
+            cache->buffer = &buffer;
+            cache->budget = default_decompressed_cache_budget;
+            buffer.decompressed_cache = cache;
+        }
+        return *buffer.decompressed_cache;
+    }
+
+    // scratch memory of compress_lines
+    struct CompressScratch {
+        U8* data;
+        U8* compressed;
+        Length capacity;
+    };
+
+    // compress_block
+    // replaces the number_of_lines lines from link, which are not compressed and have size bytes of data, with the
+    // lines of a block, unless the block would save too little. sets compressed when it replaces them.
+    // returns the link after the lines
+    [[nodiscard]] static std::atomic<Line*>* compress_block(Buffer& buffer,
+        std::atomic<Line*>* link,
+        const Length number_of_lines,
+        const Length size,
+        CompressScratch& scratch,
+        bool* compressed) {
+        if (size > scratch.capacity) {
+            free(scratch.data);
+            free(scratch.compressed);
+            scratch.capacity = std::max(size, compressed_block_size * 2);
+            scratch.data = static_cast<U8*>(malloc(scratch.capacity));
+            scratch.compressed = static_cast<U8*>(malloc(get_compress_bound(scratch.capacity)));
+        }
+
+        Length offset = 0;
+        Line* line = get_next(*link);
+        for (Length i = 0; i < number_of_lines; ++i) {
+            copy_line_data(buffer, *line, 0, line->length, reinterpret_cast<Char*>(scratch.data + offset));
+            offset += line->length;
+            line = get_next(line->next);
+        }
+        const Length compressed_size = size == 0 ? 0 : compress(scratch.data, size, scratch.compressed);
+        // less than an eighth smaller is not worth decompressing to read
+        if (size == 0 || compressed_size > size - size / 8) {
+            for (Length i = 0; i < number_of_lines; ++i) {
+                link = &get_next(*link)->next;
+            }
+            return link;
+        }
+
+        const Length block_size = sizeof(CompressedBlock) + sizeof(Line) * number_of_lines + compressed_size;
+        CompressedBlock* block = static_cast<CompressedBlock*>(malloc(block_size));
+        memset(static_cast<void*>(block), 0, sizeof(CompressedBlock));
+        block->storage = Storage{0, block, block_size, &release_compressed_block};
+        block->cache = &get_decompressed_cache(buffer);
+        block->number_of_lines = number_of_lines;
+        block->decompressed_size = size;
+        block->compressed_size = compressed_size;
+        block->line_count = number_of_lines;
+        memcpy(get_compressed_data(*block), scratch.compressed, compressed_size);
+        add_storage(buffer, block->storage, block_size);
+        *compressed = true;
+
+        Line* const lines = get_block_lines(*block);
+        offset = 0;
+        for (Length i = 0; i < number_of_lines; ++i) {
+            Line& new_line = lines[i];
+            memset(static_cast<void*>(&new_line), 0, sizeof(Line));
+            new_line.data = reinterpret_cast<Char*>(block);
+            new_line.length = get_next(*link)->length;
+            new_line.flags = line_flags::borrowed_line | line_flags::compressed_data;
+            new_line.compressed_offset = static_cast<U32>(offset);
+            offset += new_line.length;
+            replace_line(buffer, *link, new_line);
+            link = &new_line.next;
+        }
+        return link;
+    }
+
+    // #endregion
+
+    void copy_compressed_data(Buffer& buffer, const Line& line, const Length offset, const Length length, Char* out) {
+        CompressedBlock& block = get_block(line);
+        DecompressedCache& cache = *block.cache;
+        pthread_mutex_lock(&cache.mutex);
+        memcpy(out, get_decompressed(cache, block) + line.compressed_offset + offset, length);
+        pthread_mutex_unlock(&cache.mutex);
+    }
+
+    bool is_compressed_data(Buffer& buffer, const Line& line, const Char* data) {
+        CompressedBlock& block = get_block(line);
+        DecompressedCache& cache = *block.cache;
+        pthread_mutex_lock(&cache.mutex);
+        const bool result = memcmp(get_decompressed(cache, block) + line.compressed_offset, data, line.length) == 0;
+        pthread_mutex_unlock(&cache.mutex);
+        return result;
+    }
+
+    void release_compressed_line(Buffer& buffer, Line& line) {
+        CompressedBlock& block = get_block(line);
+        TTE_ASSERT(block.line_count > 0);
+        if (--block.line_count == 0) {
+            remove_storage(buffer, block.storage);
+        }
+    }
+
+    void destroy_decompressed_cache(Buffer& buffer) {
+        if (DecompressedCache* const cache = buffer.decompressed_cache) {
+            TTE_ASSERT(!cache->newest);
+            pthread_mutex_destroy(&cache->mutex);
+            free(cache);
+            buffer.decompressed_cache = nullptr;
+        }
+    }
+
+    bool compress_lines(Buffer& buffer, const Length number_of_lines, const Length line_index) {
+        std::atomic<Line*>* link = get_link_internal(buffer, line_index);
+        if (!link || !get_next(*link)) {
+            return number_of_lines == 0;
+        }
+
+        CompressScratch scratch = {};
+        bool compressed = false;
+        Length remaining_lines = number_of_lines;
+        while (remaining_lines != 0 && get_next(*link)) {
+            // the run of lines that are not compressed yet, up to the size of a block
+            Length block_lines = 0;
+            Length size = 0;
+            for (Line* line = get_next(*link); line && block_lines < remaining_lines &&
+                 !(line->flags & line_flags::compressed_data) && size < compressed_block_size;
+                 line = get_next(line->next)) {
+                size += line->length;
+                ++block_lines;
+            }
+            if (block_lines == 0) {
+                link = &get_next(*link)->next;
+                --remaining_lines;
+                continue;
+            }
+            link = compress_block(buffer, link, block_lines, size, scratch, &compressed);
+            remaining_lines -= block_lines;
+        }
+        free(scratch.data);
+        free(scratch.compressed);
+
+        if (compressed) {
+            // e.g. the text of a loaded file, which the compressed lines no longer borrow from
+            remove_unused_storages(buffer);
+            advance_epoch(buffer);
+        }
+        return true;
+    }
+
+    void set_decompressed_cache_budget(Buffer& buffer, const Length budget) {
+        DecompressedCache& cache = get_decompressed_cache(buffer);
+        pthread_mutex_lock(&cache.mutex);
+        cache.budget = budget;
+        while (cache.oldest && cache.size > cache.budget) {
+            evict_block(cache, *cache.oldest);
+        }
+        pthread_mutex_unlock(&cache.mutex);
+    }
+}}
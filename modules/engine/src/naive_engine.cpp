@@ -1,124 +1,547 @@
 
 #include <tte/engine/engine.hpp>
 #include <tte/common/assert.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <thread>
+#include "naive_engine_internal.hpp"
 
 namespace tte { namespace engine {
     // #region internal
-    struct Line {
-        Char* data;
-        Length length;
-        Line* next;
-    };
-
-    struct Buffer {
-        Line* first_line;
-    };
-
-    static inline void insert_empty_line_internal(Line** line) {
-        TTE_ASSERT(line);
-        // next could be nullptr
-        Line* const next = *line;
-        *line = static_cast<Line*>(malloc(sizeof(Line)));
-        memset(*line, 0, sizeof(Line));
-        (*line)->next = next;
-        TTE_ASSERT(*line);
-    }
-
-    static inline void insert_line_internal(Line** line, const Char* data, const Length data_length) {
-        TTE_ASSERT(line);
+    // line memory comes in size classes, 16 byte steps up to 256 bytes and then powers of two up to 64 KiB. retired
+    // blocks go back to the free blocks of their buffer instead of being freed, so an edit that replaces a line with
+    // one of about its size (typing) allocates nothing once the buffer has been edited for a bit.
+    static const constexpr Length small_block_step = 16;
+    static const constexpr Length max_small_block_size = 256;
+    static const constexpr Length small_block_class_count = max_small_block_size / small_block_step;
+    static const constexpr Length max_block_size = 64 * 1024;
+
+    // block_size_class_count for sizes that are too large to recycle
+    [[nodiscard]] static inline Length get_block_class(const Length size) {
+        if (size <= max_small_block_size) {
+            return size == 0 ? 0 : (size - 1) / small_block_step;
+        }
+        if (size > max_block_size) {
+            return block_size_class_count;
+        }
+        Length result = small_block_class_count;
+        for (Length block_size = max_small_block_size * 2; block_size < size; block_size *= 2) {
+            ++result;
+        }
+        return result;
+    }
+
+    [[nodiscard]] static inline Length get_block_size(const Length block_class, const Length size) {
+        if (block_class == block_size_class_count) {
+            return size;
+        } else if (block_class < small_block_class_count) {
+            return (block_class + 1) * small_block_step;
+        }
+        return max_small_block_size << (block_class - small_block_class_count + 1);
+    }
+
+    // allocate_block
+    // allocates at least size bytes of line memory, a free block of the buffer when there is one. blocks count towards
+    // the memory usage of the buffer from when they are allocated until they are freed, see recycle_block.
+    [[nodiscard]] static inline void* allocate_block(Buffer& buffer, const Length size) {
+        const Length block_class = get_block_class(size);
+        const Length block_size = get_block_size(block_class, size);
+        if (block_class != block_size_class_count && buffer.free_blocks[block_class]) {
+            FreeBlock* const block = buffer.free_blocks[block_class];
+            buffer.free_blocks[block_class] = block->next;
+            buffer.free_blocks_size -= block_size;
+            return block;
+        }
+        void* result = malloc(block_size);
+        TTE_ASSERT(result);
+        buffer.memory_usage.fetch_add(block_size, std::memory_order_relaxed);
+        return result;
+    }
+
+    // recycle_block
+    // keeps a retired block of line memory that no reader can see anymore for the next edits, or frees it
+    static void recycle_block(Buffer& buffer, void* memory, const Length size) {
+        const Length block_class = get_block_class(size);
+        const Length block_size = get_block_size(block_class, size);
+        if (block_class == block_size_class_count || buffer.free_blocks_size + block_size > max_free_blocks_size) {
+            free(memory);
+            buffer.memory_usage.fetch_sub(block_size, std::memory_order_relaxed);
+            return;
+        }
+        FreeBlock* const block = static_cast<FreeBlock*>(memory);
+        block->next = buffer.free_blocks[block_class];
+        buffer.free_blocks[block_class] = block;
+        buffer.free_blocks_size += block_size;
+    }
+
+    static void free_blocks(Buffer& buffer) {
+        for (Length i = 0; i < block_size_class_count; ++i) {
+            while (FreeBlock* const block = buffer.free_blocks[i]) {
+                buffer.free_blocks[i] = block->next;
+                free(block);
+            }
+        }
+        buffer.memory_usage.fetch_sub(buffer.free_blocks_size, std::memory_order_relaxed);
+        buffer.free_blocks_size = 0;
+    }
+
+    // create_line
+    // creates a line that owns data_length bytes of data, which the caller writes to line->data. short lines are
+    // allocated together with their data, longer lines allocate their data separately.
+    [[nodiscard]] static inline Line* create_line(Buffer& buffer, const Length data_length, Line* next) {
+        const bool is_inline = data_length <= max_inline_line_length;
+        Line* line =
+            static_cast<Line*>(allocate_block(buffer, sizeof(Line) + (is_inline ? sizeof(Char) * data_length : 0)));
+        memset(static_cast<void*>(line), 0, sizeof(Line));
+        line->data =
+            is_inline ? get_inline_data(*line) : static_cast<Char*>(allocate_block(buffer, sizeof(Char) * data_length));
+        line->length = data_length;
+        line->next.store(next, std::memory_order_relaxed);
+        line->flags = is_inline ? line_flags::inline_data : 0;
+        return line;
+    }
+
+    // create_line
+    // creates a line with a copy of data, or data shared with identical lines when the buffer interns lines
+    [[nodiscard]] static inline Line*
+    create_line(Buffer& buffer, const Char* data, const Length data_length, Line* next) {
         // when data is nullptr, data_length must be 0. data_length could be 0 when data is not nullptr.
         TTE_ASSERT(data != nullptr || data_length == 0);
-        insert_empty_line_internal(line);
-        TTE_ASSERT(*line);
-        (*line)->data = static_cast<Char*>(malloc(sizeof(const Char) * data_length));
-        memcpy((*line)->data, static_cast<const void*>(data), data_length);
-        (*line)->length = data_length;
+        if (buffer.intern_table && data_length != 0) {
+            Line* line = static_cast<Line*>(allocate_block(buffer, sizeof(Line)));
+            memset(static_cast<void*>(line), 0, sizeof(Line));
+            line->data = intern_data(buffer, data, data_length);
+            line->length = data_length;
+            line->next.store(next, std::memory_order_relaxed);
+            line->flags = line_flags::interned_data;
+            return line;
+        }
+        Line* line = create_line(buffer, data_length, next);
+        if (data_length != 0) {
+            memcpy(line->data, data, data_length);
+        }
+        return line;
     }
 
-    [[nodiscard]] static inline Line** get_line_internal(Buffer& buffer, const Length line_index) {
-        Length i = 0;
-        Line** line = &buffer.first_line;
-        while (line) {
-            if (i == line_index) {
-                return line;
-            } else if (*line) {
-                line = &(*line)->next;
-                ++i;
-            } else {
-                break;
+    std::atomic<Line*>* get_link_internal(Buffer& buffer, const Length line_index) {
+        std::atomic<Line*>* link = &buffer.first_line;
+        for (Length i = 0; i < line_index; ++i) {
+            Line* const line = get_next(*link);
+            if (!line) {
+                return nullptr;
             }
+            link = &line->next;
+        }
+        return link;
+    }
+
+    // the line whose next is link, nullptr for the first line of the buffer
+    [[nodiscard]] static inline Line* get_link_owner(Buffer& buffer, std::atomic<Line*>& link) {
+        if (&link == &buffer.first_line) {
+            return nullptr;
+        }
+        return reinterpret_cast<Line*>(reinterpret_cast<U8*>(&link) - offsetof(Line, next));
+    }
+
+    // links the lines from first to last, which must already link to what link links to, at link
+    static inline void link_lines(Buffer& buffer, std::atomic<Line*>& link, Line* first, Line* last) {
+        publish(link, first);
+        if (!get_next(last->next)) {
+            buffer.last_line = last;
+            buffer.last_link = first == last ? &link : nullptr;
         }
+    }
 
-        return nullptr;
+    [[nodiscard]] static std::atomic<Line*>& get_last_link(Buffer& buffer) {
+        if (!buffer.last_link) {
+            std::atomic<Line*>* link = &buffer.first_line;
+            while (get_next(*link) != buffer.last_line) {
+                link = &get_next(*link)->next;
+            }
+            buffer.last_link = link;
+        }
+        return *buffer.last_link;
     }
 
-    [[nodiscard]] static inline Line** get_closest_line_internal(Buffer& buffer,
-        const Length line_index) {
-        Line** line = &buffer.first_line;
-        for (Length i = 0; i < line_index && line && *line; ++i) {
-            line = &(*line)->next;
+    // for readers, between enter_read and exit_read
+    [[nodiscard]] static inline Line* read_line_internal(Buffer& buffer, const Length line_index) {
+        Line* line = read_next(buffer.first_line);
+        for (Length i = 0; i < line_index && line; ++i) {
+            line = read_next(line->next);
         }
         return line;
     }
 
-    [[nodiscard]] static bool
-    insert_characters(Line& line, const Length character_index, const Char* data, const Length data_length) {
-        if (character_index <= line.length) {
-            Char* new_data = static_cast<Char*>(malloc(sizeof(Char) * (line.length + data_length)));
-            memcpy(new_data, line.data, character_index);
-            memcpy(new_data + character_index, data, data_length);
-            memcpy(new_data + character_index + data_length,
-                line.data + character_index,
-                line.length - character_index);
+    // interned data is freed with the intern table, compressed lines with their block
+    static void free_line(Line& line) {
+        if (!(line.flags &
+                (line_flags::borrowed_data | line_flags::inline_data | line_flags::interned_data |
+                    line_flags::compressed_data))) {
             free(line.data);
-            line.data = new_data;
-            line.length = line.length + data_length;
+        }
+        if (!(line.flags & line_flags::borrowed_line)) {
+            free(&line);
+        }
+    }
+
+    static void retire_block(Buffer& buffer, void* memory, const Length size);
+
+    static void retire_line(Buffer& buffer, Line& line) {
+        if (line.flags & line_flags::compressed_data) {
+            release_compressed_line(buffer, line);
+            return;
+        }
+        if (line.flags & line_flags::inline_data) {
+            retire_block(buffer, &line, sizeof(Line) + line.length);
+            return;
+        }
+        if (line.flags & line_flags::interned_data) {
+            release_interned_data(buffer, line.data);
+        } else if (!(line.flags & line_flags::borrowed_data)) {
+            retire_block(buffer, line.data, line.length);
+        }
+        if (!(line.flags & line_flags::borrowed_line)) {
+            retire_block(buffer, &line, sizeof(Line));
+        }
+    }
+
+    static void free_retired_list(Buffer& buffer, RetiredList& list) {
+        for (Length i = 0; i < list.length; ++i) {
+            if (list.memory[i].block) {
+                recycle_block(buffer, list.memory[i].memory, list.memory[i].size);
+                continue;
+            } else if (list.memory[i].storage) {
+                release_storage(*list.memory[i].storage);
+            } else {
+                free(list.memory[i].memory);
+            }
+            buffer.memory_usage.fetch_sub(list.memory[i].size, std::memory_order_relaxed);
+        }
+        list.length = 0;
+    }
+
+    // advance_epoch
+    // advances the epoch if every reader entered in the current epoch, and frees the memory retired two epochs ago,
+    // which no reader can still see. never waits for readers, when a reader is still reading in an older epoch the
+    // memory is freed by a later call.
+    void advance_epoch(Buffer& buffer) {
+        // links the writer changed must be visible to readers that enter after the check below
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const U64 epoch = buffer.epoch.load(std::memory_order_relaxed);
+        for (Length i = 0; i < max_readers; ++i) {
+            const U64 reader_epoch = buffer.reader_epochs[i].load(std::memory_order_acquire);
+            if (reader_epoch != 0 && reader_epoch != epoch) {
+                return;
+            }
+        }
+        buffer.epoch.store(epoch + 1, std::memory_order_seq_cst);
+        free_retired_list(buffer, buffer.retired[(epoch + 2) % retired_list_count]);
+    }
+
+    void replace_line(Buffer& buffer, std::atomic<Line*>& link, Line& line) {
+        Line* const old_line = get_next(link);
+        TTE_ASSERT(old_line);
+        line.next.store(get_next(old_line->next), std::memory_order_relaxed);
+        link_lines(buffer, link, &line, &line);
+        retire_line(buffer, *old_line);
+    }
+
+    [[nodiscard]] static bool insert_characters(Buffer& buffer,
+        std::atomic<Line*>& link,
+        const Length character_index,
+        const Char* data,
+        const Length data_length) {
+        const Line& line = *get_next(link);
+        if (character_index <= line.length) {
+            Line& new_line = *create_line(buffer, line.length + data_length, nullptr);
+            copy_line_data(buffer, line, 0, character_index, new_line.data);
+            memcpy(new_line.data + character_index, data, data_length);
+            copy_line_data(buffer,
+                line,
+                character_index,
+                line.length - character_index,
+                new_line.data + character_index + data_length);
+            replace_line(buffer, link, new_line);
             return true;
         }
         return data_length == 0;
     }
 
-    static void destroy_line(Line& line) {
-        free(line.data);
-        free(&line);
+    Length enter_read(Buffer& buffer) {
+        for (;;) {
+            for (Length i = 0; i < max_readers; ++i) {
+                U64 expected = 0;
+                if (buffer.reader_epochs[i].load(std::memory_order_relaxed) == 0 &&
+                    buffer.reader_epochs[i].compare_exchange_strong(
+                        expected, buffer.epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst)) {
+                    // the writer must see this reader before the reader reads any link, see advance_epoch
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    return i;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void exit_read(Buffer& buffer, const Length slot) {
+        TTE_ASSERT(slot < max_readers);
+        buffer.reader_epochs[slot].store(0, std::memory_order_release);
     }
 
-    static void destroy_lines(Line* line) {
-        Line* next;
-        while (line) {
-            next = line->next;
-            destroy_line(*line);
-            line = next;
+    static void retire(Buffer& buffer, const RetiredMemory& memory) {
+        RetiredList& list = buffer.retired[buffer.epoch.load(std::memory_order_relaxed) % retired_list_count];
+        if (list.length == list.capacity) {
+            list.capacity = list.capacity == 0 ? 64 : list.capacity * 2;
+            RetiredMemory* retired = static_cast<RetiredMemory*>(malloc(sizeof(RetiredMemory) * list.capacity));
+            if (list.length != 0) {
+                memcpy(retired, list.memory, sizeof(RetiredMemory) * list.length);
+            }
+            free(list.memory);
+            list.memory = retired;
+        }
+        list.memory[list.length] = memory;
+        ++list.length;
+    }
+
+    void retire_memory(Buffer& buffer, void* memory, const Length size) {
+        retire(buffer, RetiredMemory{memory, size, nullptr, false});
+    }
+
+    // retire_block
+    // retires a block of line memory, see recycle_block
+    static void retire_block(Buffer& buffer, void* memory, const Length size) {
+        retire(buffer, RetiredMemory{memory, size, nullptr, true});
+    }
+
+    void add_storage(Buffer& buffer, Storage& storage, const Length counted_size) {
+        if (buffer.storages_length == buffer.storages_capacity) {
+            buffer.storages_capacity = buffer.storages_capacity == 0 ? 4 : buffer.storages_capacity * 2;
+            BufferStorage* storages =
+                static_cast<BufferStorage*>(malloc(sizeof(BufferStorage) * buffer.storages_capacity));
+            if (buffer.storages_length != 0) {
+                memcpy(storages, buffer.storages, sizeof(BufferStorage) * buffer.storages_length);
+            }
+            free(buffer.storages);
+            buffer.storages = storages;
+        }
+        retain_storage(storage);
+        buffer.storages[buffer.storages_length] = BufferStorage{&storage, counted_size};
+        ++buffer.storages_length;
+        buffer.memory_usage.fetch_add(counted_size, std::memory_order_relaxed);
+    }
+
+    void remove_storage(Buffer& buffer, Storage& storage) {
+        // storages are removed in about the order they were added, so the search is short
+        Length index = 0;
+        while (index < buffer.storages_length && buffer.storages[index].storage != &storage) {
+            ++index;
+        }
+        TTE_ASSERT(index < buffer.storages_length);
+        const Length counted_size = buffer.storages[index].counted_size;
+        memmove(buffer.storages + index,
+            buffer.storages + index + 1,
+            sizeof(BufferStorage) * (buffer.storages_length - index - 1));
+        --buffer.storages_length;
+        retire(buffer, RetiredMemory{storage.memory, counted_size, &storage, false});
+    }
+
+    // whether address is in the memory of storage or right after it (e.g. the data of an empty last line)
+    [[nodiscard]] static inline bool is_in_storage(const Storage& storage, const void* address) {
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(storage.memory);
+        const uintptr_t value = reinterpret_cast<uintptr_t>(address);
+        return value >= begin && value - begin <= storage.size;
+    }
+
+    [[nodiscard]] static inline uintptr_t get_storage_address(const Buffer& buffer, const Length index) {
+        return reinterpret_cast<uintptr_t>(buffer.storages[index].storage->memory);
+    }
+
+    // marks the storage address is in as used, order is the indices of the storages by address
+    static void mark_storage(const Buffer& buffer, const Length* order, bool* used, const void* address) {
+        // the first storage that starts after address
+        const uintptr_t value = reinterpret_cast<uintptr_t>(address);
+        Length low = 0;
+        Length high = buffer.storages_length;
+        while (low < high) {
+            const Length middle = low + (high - low) / 2;
+            if (get_storage_address(buffer, order[middle]) <= value) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low != 0 && is_in_storage(*buffer.storages[order[low - 1]].storage, address)) {
+            used[order[low - 1]] = true;
+        }
+    }
+
+    void remove_unused_storages(Buffer& buffer) {
+        const Length storages_length = buffer.storages_length;
+        if (storages_length == 0) {
+            return;
+        }
+
+        // the storages by address, so the storage a line borrows from is found by binary search
+        Length* order = static_cast<Length*>(malloc(sizeof(Length) * storages_length));
+        bool* used = static_cast<bool*>(malloc(sizeof(bool) * storages_length));
+        for (Length i = 0; i < storages_length; ++i) {
+            order[i] = i;
+            used[i] = false;
+        }
+        std::sort(order, order + storages_length, [&buffer](const Length a, const Length b) {
+            return get_storage_address(buffer, a) < get_storage_address(buffer, b);
+        });
+        for (Line* line = get_next(buffer.first_line); line; line = get_next(line->next)) {
+            if (line->flags & line_flags::borrowed_line) {
+                mark_storage(buffer, order, used, line);
+            }
+            if (line->flags & line_flags::borrowed_data) {
+                mark_storage(buffer, order, used, line->data);
+            }
+        }
+
+        Length length = 0;
+        for (Length i = 0; i < storages_length; ++i) {
+            const BufferStorage storage = buffer.storages[i];
+            if (used[i]) {
+                buffer.storages[length] = storage;
+                ++length;
+            } else {
+                retire(buffer, RetiredMemory{storage.storage->memory, storage.counted_size, storage.storage, false});
+            }
+        }
+        buffer.storages_length = length;
+        free(used);
+        free(order);
+    }
+
+    void release_allocation(Storage& storage) {
+        free(storage.memory);
+        free(&storage);
+    }
+
+    Storage* create_lines_from_text(Char* text, const Length text_size) {
+        Length number_of_lines = 0;
+        for (Length i = 0; i < text_size; ++i) {
+            if (text[i] == '\n') {
+                ++number_of_lines;
+            }
+        }
+        if (text_size != 0 && text[text_size - 1] != '\n') {
+            ++number_of_lines;
+        }
+        if (number_of_lines == 0) {
+            return nullptr;
+        }
+
+        // a line that is deleted is only released with the storage
+        Line* lines = static_cast<Line*>(malloc(sizeof(Line) * number_of_lines));
+        Char* line_begin = text;
+        Char* const text_end = text + text_size;
+        for (Length i = 0; i < number_of_lines; ++i) {
+            Char* line_end = static_cast<Char*>(memchr(line_begin, '\n', static_cast<Length>(text_end - line_begin)));
+            if (!line_end) {
+                line_end = text_end;
+            }
+            lines[i].data = line_begin;
+            lines[i].length = static_cast<Length>(line_end - line_begin);
+            lines[i].next.store(i + 1 < number_of_lines ? &lines[i + 1] : nullptr, std::memory_order_relaxed);
+            lines[i].flags = line_flags::borrowed_data | line_flags::borrowed_line;
+            line_begin = line_end + 1;
         }
+
+        Storage* result = static_cast<Storage*>(malloc(sizeof(Storage)));
+        *result = Storage{0, lines, sizeof(Line) * number_of_lines, &release_allocation};
+        return result;
+    }
+
+    void insert_lines_from_storage(Buffer& buffer, std::atomic<Line*>& link, Storage& lines_storage) {
+        Line* const lines = static_cast<Line*>(lines_storage.memory);
+        const Length number_of_lines = lines_storage.size / sizeof(Line);
+        TTE_ASSERT(number_of_lines != 0);
+        add_storage(buffer, lines_storage, lines_storage.size);
+        Line* const last = &lines[number_of_lines - 1];
+        last->next.store(get_next(link), std::memory_order_relaxed);
+        link_lines(buffer, link, lines, last);
+        buffer.line_count.fetch_add(number_of_lines, std::memory_order_relaxed);
+        if (buffer.last_line == last && number_of_lines > 1) {
+            buffer.last_link = &lines[number_of_lines - 2].next;
+        }
+    }
+
+    void append_lines(Buffer& buffer, Storage& lines_storage) {
+        insert_lines_from_storage(buffer, buffer.last_line ? buffer.last_line->next : buffer.first_line, lines_storage);
+    }
+
+    bool append_to_last_line(Buffer& buffer, const Char* data, const Length data_length) {
+        if (!buffer.last_line) {
+            return false;
+        }
+        if (data_length != 0) {
+            std::atomic<Line*>& link = get_last_link(buffer);
+            [[maybe_unused]] const bool result =
+                insert_characters(buffer, link, buffer.last_line->length, data, data_length);
+            TTE_ASSERT(result);
+            advance_epoch(buffer);
+        }
+        return true;
     }
 
-    static void delete_line(Line** line) {
-        TTE_ASSERT(line);
-        TTE_ASSERT(*line);
-        Line& old_line = **line;
-        *line = (*line)->next;
-        destroy_line(old_line);
+    Buffer& create_buffer_from_text(Storage& storage, Char* text, const Length text_size) {
+        Buffer& buffer = create_buffer();
+        add_storage(buffer, storage, 0);
+        if (Storage* lines_storage = create_lines_from_text(text, text_size)) {
+            append_lines(buffer, *lines_storage);
+        }
+        return buffer;
     }
 
     // #endregion
 
     Buffer& create_buffer() {
         Buffer* buffer = static_cast<Buffer*>(malloc(sizeof(Buffer)));
-        memset(buffer, 0, sizeof(Buffer));
+        memset(static_cast<void*>(buffer), 0, sizeof(Buffer));
+        // 0 marks a free reader slot
+        buffer->epoch.store(1, std::memory_order_relaxed);
         return *buffer;
     }
 
     void destroy_buffer(Buffer& buffer) {
-        destroy_lines(buffer.first_line);
+        Line* line = get_next(buffer.first_line);
+        while (line) {
+            Line* const next = get_next(line->next);
+            free_line(*line);
+            line = next;
+        }
+        for (Length i = 0; i < retired_list_count; ++i) {
+            free_retired_list(buffer, buffer.retired[i]);
+            free(buffer.retired[i].memory);
+        }
+        destroy_intern_table(buffer);
+        for (Length i = 0; i < buffer.storages_length; ++i) {
+            release_storage(*buffer.storages[i].storage);
+        }
+        free(buffer.storages);
+        destroy_decompressed_cache(buffer);
+        free_blocks(buffer);
         free(&buffer);
     }
 
+    void reclaim_buffer_memory(Buffer& buffer) {
+        // memory retired in the current epoch is freed two epochs later
+        advance_epoch(buffer);
+        advance_epoch(buffer);
+        free_blocks(buffer);
+    }
+
     bool insert_empty_line(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index)) {
-            insert_empty_line_internal(line);
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index)) {
+            Line* const line = create_line(buffer, 0, get_next(*link));
+            link_lines(buffer, *link, line, line);
+            buffer.line_count.fetch_add(1, std::memory_order_relaxed);
             return true;
         }
         return false;
@@ -129,8 +552,10 @@ namespace tte { namespace engine {
     }
 
     bool insert_line(Buffer& buffer, const Length line_index, const Char* data, const Length data_length) {
-        if (Line** line = get_line_internal(buffer, line_index)) {
-            insert_line_internal(line, data, data_length);
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index)) {
+            Line* const line = create_line(buffer, data, data_length, get_next(*link));
+            link_lines(buffer, *link, line, line);
+            buffer.line_count.fetch_add(1, std::memory_order_relaxed);
             return true;
         }
 
@@ -138,11 +563,18 @@ namespace tte { namespace engine {
     }
 
     bool insert_empty_lines(Buffer& buffer, const Length number_of_lines, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index)) {
-            for (Length i = 0; i < number_of_lines; ++i) {
-                insert_empty_line_internal(line);
-                TTE_ASSERT(line);
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index)) {
+            if (number_of_lines == 0) {
+                return true;
             }
+            // the new lines are linked to each other before readers can see any of them
+            Line* const last = create_line(buffer, 0, get_next(*link));
+            Line* first = last;
+            for (Length i = 1; i < number_of_lines; ++i) {
+                first = create_line(buffer, 0, first);
+            }
+            link_lines(buffer, *link, first, last);
+            buffer.line_count.fetch_add(number_of_lines, std::memory_order_relaxed);
             return true;
         }
 
@@ -167,11 +599,21 @@ namespace tte { namespace engine {
         const Length line_index,
         Char const* const* const data_array,
         const Length* data_length_array) {
-        if (Line** line = get_line_internal(buffer, line_index)) {
-            for (Length i = 0; i < number_of_lines; ++i) {
-                insert_line_internal(line, data_array[i], data_length_array[i]);
-                line = &(*line)->next;
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index)) {
+            if (number_of_lines == 0) {
+                return true;
             }
+            // the new lines are linked to each other before readers can see any of them
+            Line* first = get_next(*link);
+            Line* last = nullptr;
+            for (Length i = number_of_lines; i-- > 0;) {
+                first = create_line(buffer, data_array[i], data_length_array[i], first);
+                if (!last) {
+                    last = first;
+                }
+            }
+            link_lines(buffer, *link, first, last);
+            buffer.line_count.fetch_add(number_of_lines, std::memory_order_relaxed);
             return true;
         }
 
@@ -179,17 +621,19 @@ namespace tte { namespace engine {
     }
 
     bool insert_character(Buffer& buffer, const Length line_index, const Length character_index, const Char character) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            if (character_index <= (*line)->length) {
-                Char* new_data = static_cast<Char*>(malloc(sizeof(Char) * ((*line)->length + 1)));
-                memcpy(new_data, (*line)->data, character_index);
-                new_data[character_index] = character;
-                memcpy(new_data + character_index + 1,
-                    (*line)->data + character_index,
-                    (*line)->length - character_index);
-                free((*line)->data);
-                (*line)->data = new_data;
-                (*line)->length = (*line)->length + 1;
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index); link && get_next(*link)) {
+            const Line& line = *get_next(*link);
+            if (character_index <= line.length) {
+                Line& new_line = *create_line(buffer, line.length + 1, nullptr);
+                copy_line_data(buffer, line, 0, character_index, new_line.data);
+                new_line.data[character_index] = character;
+                copy_line_data(buffer,
+                    line,
+                    character_index,
+                    line.length - character_index,
+                    new_line.data + character_index + 1);
+                replace_line(buffer, *link, new_line);
+                advance_epoch(buffer);
                 return true;
             }
         }
@@ -209,31 +653,39 @@ namespace tte { namespace engine {
             return true;
         }
 
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            return insert_characters(**line, character_index, data, data_length);
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index); link && get_next(*link)) {
+            const bool result = insert_characters(buffer, *link, character_index, data, data_length);
+            advance_epoch(buffer);
+            return result;
         }
         return false;
     }
 
     bool delete_line(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            delete_line(line);
-            return true;
-        }
-        return false;
+        return delete_lines(buffer, 1, line_index);
     }
 
     bool delete_lines(Buffer& buffer, const Length number_of_lines, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            for (Length i = 0; i < number_of_lines; ++i) {
-                if (*line) {
-                    Line& old_line = **line;
-                    *line = (*line)->next;
-                    destroy_line(old_line);
-                } else {
-                    break;
-                }
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index); link && get_next(*link)) {
+            // all lines are unlinked at once, readers see either all or none of them
+            Line* const first = get_next(*link);
+            Line* end = first;
+            Length deleted_lines = 0;
+            for (; deleted_lines < number_of_lines && end; ++deleted_lines) {
+                end = get_next(end->next);
             }
+            publish(*link, end);
+            buffer.line_count.fetch_sub(deleted_lines, std::memory_order_relaxed);
+            if (!end) {
+                buffer.last_line = get_link_owner(buffer, *link);
+                buffer.last_link = nullptr;
+            }
+            for (Line* line = first; line != end;) {
+                Line* const next = get_next(line->next);
+                retire_line(buffer, *line);
+                line = next;
+            }
+            advance_epoch(buffer);
         } else {
             return number_of_lines == 0;
         }
@@ -241,39 +693,27 @@ namespace tte { namespace engine {
     }
 
     bool delete_character(Buffer& buffer, const Length line_index, const Length character_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            if (character_index < (*line)->length) {
-                Char* oldData = (*line)->data;
-                (*line)->data = static_cast<Char*>(malloc(sizeof(Char) * ((*line)->length - 1)));
-                memcpy((*line)->data, oldData, character_index);
-                memcpy((*line)->data + character_index,
-                    oldData + character_index + 1,
-                    (*line)->length - character_index - 1);
-                free(oldData);
-                (*line)->length = (*line)->length - 1;
-                return true;
-            }
-        }
-        return false;
+        return delete_characters(buffer, 1, line_index, character_index);
     }
 
     bool delete_characters(Buffer& buffer,
         const Length number_of_characters,
         const Length line_index,
         const Length character_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            if (character_index < (*line)->length) {
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index); link && get_next(*link)) {
+            const Line& line = *get_next(*link);
+            if (character_index < line.length) {
                 const Length actual_number_of_characters =
-                    std::min((*line)->length - character_index, number_of_characters);
-                Char* oldData = (*line)->data;
-                (*line)->data =
-                    static_cast<Char*>(malloc(sizeof(Char) * ((*line)->length - actual_number_of_characters)));
-                memcpy((*line)->data, oldData, character_index);
-                memcpy((*line)->data + character_index,
-                    oldData + character_index + actual_number_of_characters,
-                    (*line)->length - character_index - actual_number_of_characters);
-                free(oldData);
-                (*line)->length = (*line)->length - actual_number_of_characters;
+                    std::min(line.length - character_index, number_of_characters);
+                Line& new_line = *create_line(buffer, line.length - actual_number_of_characters, nullptr);
+                copy_line_data(buffer, line, 0, character_index, new_line.data);
+                copy_line_data(buffer,
+                    line,
+                    character_index + actual_number_of_characters,
+                    line.length - character_index - actual_number_of_characters,
+                    new_line.data + character_index);
+                replace_line(buffer, *link, new_line);
+                advance_epoch(buffer);
                 return true;
             }
         }
@@ -281,62 +721,127 @@ namespace tte { namespace engine {
     }
 
     bool merge_lines(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line && (*line)->next) {
-            if (insert_characters(**line, (*line)->length, (*line)->next->data, (*line)->next->length)) {
-                delete_line(&(*line)->next);
+        if (std::atomic<Line*>* link = get_link_internal(buffer, line_index); link && get_next(*link)) {
+            Line& line = *get_next(*link);
+            if (Line* const next_line = get_next(line.next)) {
+                // one line replaces both, so readers never see the merged line next to the line merged into it
+                Line* const merged_line =
+                    create_line(buffer, line.length + next_line->length, get_next(next_line->next));
+                copy_line_data(buffer, line, 0, line.length, merged_line->data);
+                copy_line_data(buffer, *next_line, 0, next_line->length, merged_line->data + line.length);
+                link_lines(buffer, *link, merged_line, merged_line);
+                buffer.line_count.fetch_sub(1, std::memory_order_relaxed);
+                retire_line(buffer, line);
+                retire_line(buffer, *next_line);
+                advance_epoch(buffer);
                 return true;
             }
         }
         return false;
     }
 
-    Length get_buffer_length(Buffer& buffer) {
-        Length length = 0;
-        for (Line* line = buffer.first_line; line; line = line->next) {
-            ++length;
-        }
-        return length;
-    }
+    Length get_buffer_length(Buffer& buffer) { return buffer.line_count.load(std::memory_order_relaxed); }
 
     Length get_line_length(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            return (*line)->length;
-        }
-        return 0;
+        const Length slot = enter_read(buffer);
+        Line* const line = read_line_internal(buffer, line_index);
+        const Length result = line ? line->length : 0;
+        exit_read(buffer, slot);
+        return result;
     }
 
     char* line_to_c_string(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            char* result = static_cast<char*>(malloc(sizeof(char) * ((*line)->length + 1)));
-            memcpy(result, (*line)->data, (*line)->length);
-            result[(*line)->length] = '\0';
-            return result;
+        const Length slot = enter_read(buffer);
+        char* result = nullptr;
+        if (Line* const line = read_line_internal(buffer, line_index)) {
+            result = static_cast<char*>(malloc(sizeof(char) * (line->length + 1)));
+            copy_line_data(buffer, *line, 0, line->length, result);
+            result[line->length] = '\0';
         }
-
-        return nullptr;
+        exit_read(buffer, slot);
+        return result;
     }
 
-    char* buffer_to_c_string(Buffer& buffer) {
-        Length length = 0;
-        for (Line* line = buffer.first_line; line; line = line->next) {
-            length += line->length + 1;
+    Length copy_line(Buffer& buffer, const Length line_index, Char* data, const Length capacity) {
+        const Length slot = enter_read(buffer);
+        Length result = 0;
+        if (Line* const line = read_line_internal(buffer, line_index)) {
+            result = line->length;
+            const Length length = std::min(line->length, capacity);
+            if (length != 0) {
+                copy_line_data(buffer, *line, 0, length, data);
+            }
         }
+        exit_read(buffer, slot);
+        return result;
+    }
 
-        char* result = static_cast<char*>(malloc(sizeof(char) * (length + 1)));
-        result[length] = '\0';
-        Length index = 0;
-        for (Line* line = buffer.first_line; line; line = line->next) {
-            memcpy(result + index, line->data, line->length);
-            result[index + line->length] = '\n';
-            index += line->length + 1;
+    Length copy_lines(Buffer& buffer,
+        const Length number_of_lines,
+        const Length line_index,
+        Char* data,
+        const Length capacity,
+        Length* line_lengths) {
+        const Length slot = enter_read(buffer);
+        Length result = 0;
+        bool fits = true;
+        Line* line = read_line_internal(buffer, line_index);
+        for (Length i = 0; i < number_of_lines; ++i) {
+            const Length length = line ? line->length : 0;
+            line_lengths[i] = length;
+            // the lines after one that does not fit are not copied either, so the copied lines are the first ones
+            fits = fits && result + length + 1 <= capacity;
+            if (fits) {
+                if (length != 0) {
+                    copy_line_data(buffer, *line, 0, length, data + result);
+                }
+                data[result + length] = '\0';
+            }
+            result += length + 1;
+            if (line) {
+                line = read_next(line->next);
+            }
         }
+        exit_read(buffer, slot);
         return result;
     }
 
-    bool line_empty(Buffer& buffer, const Length line_index) {
-        if (Line** line = get_line_internal(buffer, line_index); line && *line) {
-            return (*line)->length == 0;
+    char* buffer_to_c_string(Buffer& buffer) {
+        const Length slot = enter_read(buffer);
+        for (;;) {
+            Length length = 0;
+            for (Line* line = read_next(buffer.first_line); line; line = read_next(line->next)) {
+                length += line->length + 1;
+            }
+
+            char* result = static_cast<char*>(malloc(sizeof(char) * (length + 1)));
+            result[length] = '\0';
+            Length index = 0;
+            Line* line = read_next(buffer.first_line);
+            for (; line && index + line->length + 1 <= length; line = read_next(line->next)) {
+                copy_line_data(buffer, *line, 0, line->length, result + index);
+                result[index + line->length] = '\n';
+                index += line->length + 1;
+            }
+
+            // the writer changed the buffer between the two passes, try again
+            if (line || index != length) {
+                free(result);
+                continue;
+            }
+
+            exit_read(buffer, slot);
+            return result;
         }
-        return true;
+    }
+
+    Length get_buffer_memory_usage(Buffer& buffer) { return buffer.memory_usage.load(std::memory_order_relaxed); }
+
+    bool line_empty(Buffer& buffer, const Length line_index) {
+        const Length slot = enter_read(buffer);
+        Line* const line = read_line_internal(buffer, line_index);
+        const bool result = !line || line->length == 0;
+        exit_read(buffer, slot);
+        return result;
     }
 }}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <tte/engine/engine.hpp>
+#include <tte/common/number_types.hpp>
+#include <tte/common/assert.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace tte { namespace engine {
+    namespace line_flags {
+        // data points into a Storage of the buffer (e.g. a mapped snapshot) and must not be freed
+        static const constexpr U8 borrowed_data = 1 << 0;
+        // the line itself lives in a Storage of the buffer and must not be freed
+        static const constexpr U8 borrowed_line = 1 << 1;
+        // data is allocated together with the line, right after it (see get_inline_data)
+        static const constexpr U8 inline_data = 1 << 2;
+        // data is shared with identical lines through the intern table of the buffer (see intern_data)
+        static const constexpr U8 interned_data = 1 << 3;
+        // data is the CompressedBlock the line lives in, the data of the line is at compressed_offset in the
+        // decompressed block (see copy_line_data)
+        static const constexpr U8 compressed_data = 1 << 4;
+    }
+
+    // lines up to this length are allocated together with their data, most lines of source code are shorter
+    static const constexpr Length max_inline_line_length = 64;
+
+    // a line is immutable once it is linked into the buffer, except for next. the writer edits a line by linking a
+    // new line in its place and retiring the old one, so readers never see a line change under them.
+    struct Line {
+        Char* data;
+        Length length;
+        // only changed by the writer, read concurrently by readers
+        std::atomic<Line*> next;
+        U8 flags;
+        // see line_flags::compressed_data
+        U32 compressed_offset;
+    };
+
+    [[nodiscard]] inline Char* get_inline_data(Line& line) { return reinterpret_cast<Char*>(&line + 1); }
+
+    // memory that lines borrow, shared by reference count and released when the last reference is dropped. the count
+    // is changed by writers only, so a storage shared by several buffers (see naive_workspace.cpp) needs them written
+    // from one thread.
+    struct Storage {
+        U64 reference_count;
+        void* memory;
+        Length size;
+        void (*release)(Storage&);
+    };
+
+    // memory unlinked by the writer that readers may still be reading
+    struct RetiredMemory {
+        void* memory;
+        Length size;
+        // released instead of freeing memory when not nullptr
+        Storage* storage;
+        // memory is a block of line memory, recycled instead of freed (see retire_block)
+        bool block;
+    };
+
+    // line memory is allocated in blocks of a size class, see allocate_block
+    static const constexpr Length block_size_class_count = 24;
+    // free blocks a buffer keeps for its next edits, larger blocks and blocks beyond this are freed
+    static const constexpr Length max_free_blocks_size = 1024 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct InternTable;
+    struct DecompressedCache;
+
+    // a storage the buffer holds a reference to
+    struct BufferStorage {
+        Storage* storage;
+        // the part of the memory usage of the buffer the storage accounts for
+        Length counted_size;
+    };
+
+    struct RetiredList {
+        RetiredMemory* memory;
+        Length length;
+        Length capacity;
+    };
+
+    // readers reading at the same time, a reader waits for a free slot when there are more
+    static const constexpr Length max_readers = 32;
+    // memory retired in epoch e is freed when the epoch advances to e + 2, so only three lists are in use at once
+    static const constexpr Length retired_list_count = 3;
+
+    struct Buffer {
+        std::atomic<Line*> first_line;
+        // writer only
+        Line* last_line;
+        // the link to last_line, nullptr when not known. writer only
+        std::atomic<Line*>* last_link;
+        // changed by the writer after linking or unlinking lines, so readers may see it lag behind the lines
+        std::atomic<Length> line_count;
+        // bytes allocated for lines and their data, including retired memory and free blocks that are not freed yet
+        // and excluding memory borrowed from storages that are shared with other buffers or mapped
+        std::atomic<Length> memory_usage;
+        BufferStorage* storages;
+        Length storages_length;
+        Length storages_capacity;
+        // epoch based reclamation, see enter_read and reclaim_buffer_memory
+        std::atomic<U64> epoch;
+        // the epoch each reader entered in, 0 when the slot is free
+        std::atomic<U64> reader_epochs[max_readers];
+        RetiredList retired[retired_list_count];
+        // retired blocks of line memory that no reader can see anymore, by size class. writer only
+        FreeBlock* free_blocks[block_size_class_count];
+        // bytes in free_blocks, counted towards memory_usage
+        Length free_blocks_size;
+        // nullptr when lines are not interned, see enable_line_interning
+        InternTable* intern_table;
+        // nullptr until lines are compressed, see compress_lines
+        DecompressedCache* decompressed_cache;
+    };
+
+    // the writer is the only thread that changes links, so it can read them without synchronisation
+    [[nodiscard]] inline Line* get_next(const std::atomic<Line*>& link) { return link.load(std::memory_order_relaxed); }
+
+    // readers read links with acquire, so the lines they point to are fully visible
+    [[nodiscard]] inline Line* read_next(const std::atomic<Line*>& link) { return link.load(std::memory_order_acquire); }
+
+    // links line, which must be fully initialised, where readers can see it
+    inline void publish(std::atomic<Line*>& link, Line* line) { link.store(line, std::memory_order_release); }
+
+    // enter_read
+    // every line a reader reads between enter_read and exit_read stays allocated until exit_read, even if the writer
+    // unlinks it. returns the slot to pass to exit_read.
+    [[nodiscard]] extern Length enter_read(Buffer& buffer);
+    extern void exit_read(Buffer& buffer, const Length slot);
+
+    // retire_memory
+    // memory is freed once no reader that could have seen it is reading. writer only.
+    extern void retire_memory(Buffer& buffer, void* memory, const Length size);
+
+    // advance_epoch
+    // frees the memory retired two epochs ago, call after the writer is done with an edit. writer only.
+    extern void advance_epoch(Buffer& buffer);
+
+    // replace_line
+    // links line, which must not be linked yet, in place of the line linked from link and retires that line. writer
+    // only.
+    extern void replace_line(Buffer& buffer, std::atomic<Line*>& link, Line& line);
+
+    inline void retain_storage(Storage& storage) { ++storage.reference_count; }
+
+    inline void release_storage(Storage& storage) {
+        TTE_ASSERT(storage.reference_count > 0);
+        if (--storage.reference_count == 0) {
+            storage.release(storage);
+        }
+    }
+
+    // add_storage
+    // the buffer takes a reference to the storage, which it keeps until it is destroyed or remove_storage.
+    // counted_size is the part of storage that counts towards the memory usage of the buffer, 0 for memory that is
+    // shared or mapped. writer only.
+    extern void add_storage(Buffer& buffer, Storage& storage, const Length counted_size);
+
+    // remove_storage
+    // drops the reference add_storage took once no reader can see lines in storage, which the buffer must no longer
+    // link to. writer only.
+    extern void remove_storage(Buffer& buffer, Storage& storage);
+
+    // remove_unused_storages
+    // remove_storage for every storage no linked line borrows from, takes time linear in the lines of the buffer.
+    // writer only.
+    extern void remove_unused_storages(Buffer& buffer);
+
+    // for storages whose memory and the storage itself were allocated with malloc
+    extern void release_allocation(Storage& storage);
+
+    // create_lines_from_text
+    // creates one line per '\n' separated line of text (see load_file), all allocated at once in the returned storage
+    // and linked to each other in order. the lines borrow their data from text.
+    // returns nullptr when text has no lines
+    [[nodiscard]] extern Storage* create_lines_from_text(Char* text, const Length text_size);
+
+    // get_link_internal
+    // the link to the line at line_index, which links to nullptr for the index after the last line
+    // returns nullptr when line_index is past that
+    [[nodiscard]] extern std::atomic<Line*>* get_link_internal(Buffer& buffer, const Length line_index);
+
+    // insert_lines_from_storage
+    // links the lines of lines_storage (see create_lines_from_text) at link and takes a reference to lines_storage.
+    // writer only.
+    extern void insert_lines_from_storage(Buffer& buffer, std::atomic<Line*>& link, Storage& lines_storage);
+    // append_lines
+    // insert_lines_from_storage after the last line of the buffer
+    extern void append_lines(Buffer& buffer, Storage& lines_storage);
+    // append_to_last_line
+    // returns false when the buffer has no lines. writer only.
+    [[nodiscard]] extern bool append_to_last_line(Buffer& buffer, const Char* data, const Length data_length);
+
+    // intern_data
+    // the data of the intern table identical to data, which lines can share until release_interned_data. the
+    // buffer must have an intern table. writer only.
+    [[nodiscard]] extern Char* intern_data(Buffer& buffer, const Char* data, const Length length);
+    // release_interned_data
+    // the data is retired when no line uses it anymore. writer only.
+    extern void release_interned_data(Buffer& buffer, Char* data);
+    // intern_lines
+    // makes the lines of lines_storage (see create_lines_from_text) use interned data instead of their text, which
+    // they no longer borrow from. writer only.
+    extern void intern_lines(Buffer& buffer, Storage& lines_storage);
+    // destroy_intern_table
+    // frees the data of the intern table, whether lines use it or not
+    extern void destroy_intern_table(Buffer& buffer);
+
+    // copy_compressed_data
+    // copy_line_data for a compressed line
+    extern void
+    copy_compressed_data(Buffer& buffer, const Line& line, const Length offset, const Length length, Char* out);
+    // is_compressed_data
+    // is_line_data for a compressed line
+    [[nodiscard]] extern bool is_compressed_data(Buffer& buffer, const Line& line, const Char* data);
+    // release_compressed_line
+    // called when a compressed line is retired, its block is removed once none of its lines are linked. writer only.
+    extern void release_compressed_line(Buffer& buffer, Line& line);
+    // destroy_decompressed_cache
+    // after the compressed blocks were released
+    extern void destroy_decompressed_cache(Buffer& buffer);
+
+    // copy_line_data
+    // copies length bytes of the data of line from offset to out. the line must not be freed while copying, i.e. the
+    // writer or a reader between enter_read and exit_read copies it.
+    inline void copy_line_data(Buffer& buffer, const Line& line, const Length offset, const Length length, Char* out) {
+        if (line.flags & line_flags::compressed_data) {
+            copy_compressed_data(buffer, line, offset, length, out);
+        } else if (length != 0) {
+            memcpy(out, line.data + offset, length);
+        }
+    }
+
+    // is_line_data
+    // whether the data of line is the line.length bytes at data
+    [[nodiscard]] inline bool is_line_data(Buffer& buffer, const Line& line, const Char* data) {
+        if (line.flags & line_flags::compressed_data) {
+            return is_compressed_data(buffer, line, data);
+        }
+        return line.length == 0 || memcmp(line.data, data, line.length) == 0;
+    }
+
+    // creates a buffer with the lines of text, which borrow their data from text, which must stay valid while storage
+    // is referenced. the buffer takes a reference to storage.
+    [[nodiscard]] extern Buffer& create_buffer_from_text(Storage& storage, Char* text, const Length text_size);
+}}
@@ -0,0 +1,212 @@
+#include <tte/engine/file.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    // the first chunk is small so the first screen is ready quickly, later chunks grow up to max_chunk_size
+    static const constexpr Length first_chunk_size = 64 * 1024;
+    static const constexpr Length max_chunk_size = 4 * 1024 * 1024;
+
+    // lines read by the loading thread that were not appended yet
+    struct LoadedChunk {
+        Storage* text;
+        Storage* lines;
+        LoadedChunk* next;
+    };
+
+    struct FileLoad {
+        char* path;
+        pthread_t thread;
+        bool thread_started;
+        // pushed by the loading thread, most recently read first
+        std::atomic<LoadedChunk*> chunks;
+        std::atomic<Length> loaded_size;
+        std::atomic<Length> file_size;
+        std::atomic<bool> failed;
+        // set by the loading thread after it pushed its last chunk
+        std::atomic<bool> done;
+        std::atomic<bool> stop;
+    };
+
+    static void push_chunk(FileLoad& load, Char* text, const Length text_size) {
+        Storage* lines = create_lines_from_text(text, text_size);
+        if (!lines) {
+            free(text);
+            return;
+        }
+
+        LoadedChunk* chunk = static_cast<LoadedChunk*>(malloc(sizeof(LoadedChunk)));
+        chunk->text = static_cast<Storage*>(malloc(sizeof(Storage)));
+        *chunk->text = Storage{0, text, text_size, &release_allocation};
+        chunk->lines = lines;
+        chunk->next = load.chunks.load(std::memory_order_relaxed);
+        while (!load.chunks.compare_exchange_weak(
+            chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void free_chunk(LoadedChunk& chunk) {
+        chunk.text->release(*chunk.text);
+        chunk.lines->release(*chunk.lines);
+        free(&chunk);
+    }
+
+    // reads until size bytes were read or the end of the file
+    [[nodiscard]] static bool read_fully(const int file, Char* data, const Length size, Length* read_size) {
+        *read_size = 0;
+        while (*read_size < size) {
+            const ssize_t amount = read(file, data + *read_size, size - *read_size);
+            if (amount < 0) {
+                return false;
+            } else if (amount == 0) {
+                break;
+            }
+            *read_size += static_cast<Length>(amount);
+        }
+        return true;
+    }
+
+    static void* load_file_thread(void* user_data) {
+        FileLoad& load = *static_cast<FileLoad*>(user_data);
+        const int file = open(load.path, O_RDONLY);
+        struct stat data;
+        if (file == -1 || fstat(file, &data) != 0) {
+            if (file != -1) {
+                close(file);
+            }
+            load.failed.store(true, std::memory_order_relaxed);
+            load.done.store(true, std::memory_order_release);
+            return nullptr;
+        }
+        load.file_size.store(static_cast<Length>(data.st_size), std::memory_order_relaxed);
+
+        // the start of a line whose '\n' was not read yet, carried into the next chunk
+        Char* carry = nullptr;
+        Length carry_size = 0;
+        Length chunk_size = first_chunk_size;
+        Length loaded_size = 0;
+        bool failed = false;
+        while (!load.stop.load(std::memory_order_relaxed)) {
+            Char* text = static_cast<Char*>(malloc(sizeof(Char) * (carry_size + chunk_size)));
+            if (carry_size != 0) {
+                memcpy(text, carry, carry_size);
+            }
+            free(carry);
+            carry = nullptr;
+
+            Length read_size;
+            if (!read_fully(file, text + carry_size, chunk_size, &read_size)) {
+                free(text);
+                failed = true;
+                break;
+            }
+
+            const Length text_size = carry_size + read_size;
+            const bool at_end = read_size < chunk_size;
+            Length complete_size = text_size;
+            if (!at_end) {
+                while (complete_size != 0 && text[complete_size - 1] != '\n') {
+                    --complete_size;
+                }
+            }
+            carry_size = text_size - complete_size;
+            if (carry_size != 0) {
+                carry = static_cast<Char*>(malloc(sizeof(Char) * carry_size));
+                memcpy(carry, text + complete_size, carry_size);
+            }
+            push_chunk(load, text, complete_size);
+
+            loaded_size += read_size;
+            load.loaded_size.store(loaded_size, std::memory_order_relaxed);
+            if (at_end) {
+                break;
+            }
+            chunk_size = std::min(chunk_size * 2, max_chunk_size);
+        }
+
+        free(carry);
+        close(file);
+        load.failed.store(failed, std::memory_order_relaxed);
+        load.done.store(true, std::memory_order_release);
+        return nullptr;
+    }
+
+    // #endregion
+
+    FileLoad& start_file_load(const char* path) {
+        TTE_ASSERT(path);
+        FileLoad* load = static_cast<FileLoad*>(malloc(sizeof(FileLoad)));
+        memset(static_cast<void*>(load), 0, sizeof(FileLoad));
+        const Length path_length = strlen(path);
+        load->path = static_cast<char*>(malloc(sizeof(char) * (path_length + 1)));
+        memcpy(load->path, path, path_length + 1);
+        load->thread_started = pthread_create(&load->thread, nullptr, &load_file_thread, load) == 0;
+        if (!load->thread_started) {
+            load->failed.store(true, std::memory_order_relaxed);
+            load->done.store(true, std::memory_order_release);
+        }
+        return *load;
+    }
+
+    bool poll_file_load(FileLoad& load, Buffer& buffer) {
+        // read before taking the chunks, so once done no chunk can be left behind
+        const bool done = load.done.load(std::memory_order_acquire);
+        LoadedChunk* chunks = load.chunks.exchange(nullptr, std::memory_order_acquire);
+
+        LoadedChunk* ordered_chunks = nullptr;
+        while (chunks) {
+            LoadedChunk* const next = chunks->next;
+            chunks->next = ordered_chunks;
+            ordered_chunks = chunks;
+            chunks = next;
+        }
+
+        while (ordered_chunks) {
+            LoadedChunk* const next = ordered_chunks->next;
+            if (buffer.intern_table) {
+                // the lines no longer need the text
+                intern_lines(buffer, *ordered_chunks->lines);
+                ordered_chunks->text->release(*ordered_chunks->text);
+            } else {
+                // the text is owned by this buffer alone, so it counts towards its memory usage
+                add_storage(buffer, *ordered_chunks->text, ordered_chunks->text->size);
+            }
+            append_lines(buffer, *ordered_chunks->lines);
+            free(ordered_chunks);
+            ordered_chunks = next;
+        }
+        return done;
+    }
+
+    void get_file_load_progress(FileLoad& load, Length* loaded_size, Length* file_size) {
+        *loaded_size = load.loaded_size.load(std::memory_order_relaxed);
+        *file_size = load.file_size.load(std::memory_order_relaxed);
+    }
+
+    bool file_load_succeeded(FileLoad& load) { return !load.failed.load(std::memory_order_relaxed); }
+
+    void finish_file_load(FileLoad& load) {
+        load.stop.store(true, std::memory_order_relaxed);
+        if (load.thread_started) {
+            pthread_join(load.thread, nullptr);
+        }
+        LoadedChunk* chunk = load.chunks.exchange(nullptr, std::memory_order_acquire);
+        while (chunk) {
+            LoadedChunk* const next = chunk->next;
+            free_chunk(*chunk);
+            chunk = next;
+        }
+        free(load.path);
+        free(&load);
+    }
+}}
@@ -0,0 +1,403 @@
+#include <tte/engine/watch.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+    #include <sys/inotify.h>
+#endif
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    // the last bytes of the file are kept to tell appends from other changes
+    static const constexpr Length watch_tail_capacity = 4096;
+    static const constexpr Length append_batch_size = 4 * 1024 * 1024;
+    // read per poll at most, so a poll fits in a frame while still reading hundreds of MB/s at 60 polls a second. the
+    // rest is read by the next polls.
+    static const constexpr Length max_poll_size = 2 * append_batch_size;
+
+    struct FileIdentity {
+        U64 inode;
+        Length size;
+        S64 modification_time_seconds;
+        S64 modification_time_nanoseconds;
+    };
+
+    struct FileWatch {
+        char* path;
+        // -1 when inotify is not available, then the file is checked every poll
+        int notify_file;
+        // -1 while the file is not watched (e.g. it was deleted)
+        int watch;
+        // of the file the buffer holds
+        FileIdentity identity;
+        Char tail[watch_tail_capacity];
+        Length tail_length;
+        // the file has more bytes than were read, poll again without waiting for a change
+        bool pending;
+        // see follow_file
+        bool follow;
+        // 0 for no limit
+        Length max_lines;
+        // lines a follow deleted since it last freed the memory they were read into
+        Length deleted_lines;
+    };
+
+    [[nodiscard]] static FileIdentity get_identity(const struct stat& data) {
+        FileIdentity result;
+        result.inode = static_cast<U64>(data.st_ino);
+        result.size = static_cast<Length>(data.st_size);
+#if defined(__APPLE__)
+        result.modification_time_seconds = static_cast<S64>(data.st_mtimespec.tv_sec);
+        result.modification_time_nanoseconds = static_cast<S64>(data.st_mtimespec.tv_nsec);
+#else
+        result.modification_time_seconds = static_cast<S64>(data.st_mtim.tv_sec);
+        result.modification_time_nanoseconds = static_cast<S64>(data.st_mtim.tv_nsec);
+#endif
+        return result;
+    }
+
+    [[nodiscard]] static bool is_same_identity(const FileIdentity& a, const FileIdentity& b) {
+        return a.inode == b.inode && a.size == b.size && a.modification_time_seconds == b.modification_time_seconds &&
+            a.modification_time_nanoseconds == b.modification_time_nanoseconds;
+    }
+
+    [[nodiscard]] static bool read_at(const int file, void* data, const Length size, const Length offset) {
+        Length read_size = 0;
+        while (read_size < size) {
+            const ssize_t amount =
+                pread(file, static_cast<U8*>(data) + read_size, size - read_size, static_cast<off_t>(offset + read_size));
+            if (amount <= 0) {
+                return false;
+            }
+            read_size += static_cast<Length>(amount);
+        }
+        return true;
+    }
+
+    // remembers the identity and last bytes of the file, which the buffer now holds
+    [[nodiscard]] static bool set_file(FileWatch& watch, const int file, const FileIdentity& identity) {
+        watch.identity = identity;
+        watch.tail_length = std::min(identity.size, watch_tail_capacity);
+        return read_at(file, watch.tail, watch.tail_length, identity.size - watch.tail_length);
+    }
+
+#if defined(__linux__)
+    static void add_watch(FileWatch& watch) {
+        watch.watch = inotify_add_watch(watch.notify_file, watch.path, IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF |
+            IN_DELETE_SELF);
+    }
+
+    // returns true if there were events, or the file can be watched again
+    [[nodiscard]] static bool read_events(FileWatch& watch) {
+        bool result = false;
+        bool lost_watch = false;
+        alignas(struct inotify_event) char events[4096];
+        for (;;) {
+            const ssize_t size = read(watch.notify_file, events, sizeof(events));
+            if (size <= 0) {
+                break;
+            }
+            for (ssize_t offset = 0; offset < size;) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(events + offset);
+                result = true;
+                // the file was deleted or renamed (e.g. a new version was renamed over it), watch the path again
+                if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                    lost_watch = true;
+                }
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            }
+        }
+
+        if (lost_watch && watch.watch != -1) {
+            inotify_rm_watch(watch.notify_file, watch.watch);
+            watch.watch = -1;
+        }
+        if (watch.watch == -1) {
+            add_watch(watch);
+            result = result || watch.watch != -1;
+        }
+        return result;
+    }
+#endif
+
+    // deletes the first lines of a followed buffer. the memory they were read into is freed once about as many lines
+    // were deleted as are left, so freeing it takes constant time per deleted line.
+    static void delete_first_lines(FileWatch& watch, Buffer& buffer, const Length number_of_lines) {
+        [[maybe_unused]] const bool deleted = delete_lines(buffer, number_of_lines, 0);
+        TTE_ASSERT(deleted);
+        watch.deleted_lines += number_of_lines;
+        if (watch.deleted_lines >= get_buffer_length(buffer)) {
+            remove_unused_storages(buffer);
+            watch.deleted_lines = 0;
+        }
+    }
+
+    // deletes the oldest lines over max_lines
+    static void limit_lines(FileWatch& watch, Buffer& buffer) {
+        const Length buffer_length = get_buffer_length(buffer);
+        if (watch.max_lines != 0 && buffer_length > watch.max_lines) {
+            delete_first_lines(watch, buffer, buffer_length - watch.max_lines);
+        }
+    }
+
+    // appends text, which continues the last line of the buffer when continues_last_line. takes ownership of text.
+    static void append_text(Buffer& buffer, Char* text, const Length text_size, const bool continues_last_line) {
+        Length start = 0;
+        if (continues_last_line) {
+            const Char* end = static_cast<const Char*>(memchr(text, '\n', text_size));
+            const Length length = end ? static_cast<Length>(end - text) : text_size;
+            // without lines there is nothing to continue
+            if (append_to_last_line(buffer, text, length)) {
+                start = end ? length + 1 : text_size;
+            }
+        }
+
+        Storage* lines = create_lines_from_text(text + start, text_size - start);
+        if (!lines) {
+            free(text);
+            return;
+        }
+        if (buffer.intern_table) {
+            // the lines no longer need the text
+            intern_lines(buffer, *lines);
+            free(text);
+        } else {
+            Storage* text_storage = static_cast<Storage*>(malloc(sizeof(Storage)));
+            *text_storage = Storage{0, text, text_size, &release_allocation};
+            add_storage(buffer, *text_storage, text_size);
+        }
+        append_lines(buffer, *lines);
+    }
+
+    // appends the bytes of the file from where it was read up to end
+    [[nodiscard]] static bool apply_append(FileWatch& watch, Buffer& buffer, const int file, const Length end) {
+        bool continues_last_line = watch.tail_length != 0 && watch.tail[watch.tail_length - 1] != '\n';
+        for (Length offset = watch.identity.size; offset < end;) {
+            const Length batch_size = std::min(end - offset, append_batch_size);
+            Char* text = static_cast<Char*>(malloc(sizeof(Char) * batch_size));
+            if (!read_at(file, text, batch_size, offset)) {
+                free(text);
+                return false;
+            }
+            const bool ends_with_newline = text[batch_size - 1] == '\n';
+            append_text(buffer, text, batch_size, continues_last_line);
+            continues_last_line = !ends_with_newline;
+            offset += batch_size;
+            limit_lines(watch, buffer);
+        }
+        return true;
+    }
+
+    // whether the line of text starting at offset is line
+    [[nodiscard]] static bool
+    is_same_line(Buffer& buffer, const Char* text, const Length text_size, const Length offset, const Line& line) {
+        if (offset >= text_size || text_size - offset < line.length) {
+            return false;
+        }
+        const Length end = offset + line.length;
+        return (end == text_size || text[end] == '\n') && is_line_data(buffer, line, text + offset);
+    }
+
+    // replaces the lines between the lines at the start and end of the buffer that are unchanged in text
+    static void apply_change(FileWatch& watch, Buffer& buffer, const Char* text, const Length text_size) {
+        Length prefix_lines = 0;
+        // the old file has a '\n' after the last unchanged line where the new file may end
+        Length old_offset = 0;
+        Line* line = get_next(buffer.first_line);
+        for (; line && is_same_line(buffer, text, text_size, old_offset, *line); line = get_next(line->next)) {
+            old_offset += line->length + 1;
+            ++prefix_lines;
+        }
+        const Length prefix_size = std::min(old_offset, text_size);
+
+        // the unchanged end is the longest run of lines up to the last line that are at the same offset from the end
+        // of the file as before
+        const S64 offset_change = static_cast<S64>(text_size) - static_cast<S64>(watch.identity.size);
+        Length middle_lines = 0;
+        Length suffix_lines = 0;
+        Length suffix_offset = text_size;
+        for (; line; line = get_next(line->next)) {
+            const S64 offset = static_cast<S64>(old_offset) + offset_change;
+            if (offset >= static_cast<S64>(prefix_size) && (offset == 0 || text[offset - 1] == '\n') &&
+                is_same_line(buffer, text, text_size, static_cast<Length>(offset), *line)) {
+                if (suffix_lines == 0) {
+                    suffix_offset = static_cast<Length>(offset);
+                }
+                ++suffix_lines;
+            } else {
+                middle_lines += suffix_lines + 1;
+                suffix_lines = 0;
+                suffix_offset = text_size;
+            }
+            old_offset += line->length + 1;
+        }
+
+        if (middle_lines != 0) {
+            [[maybe_unused]] const bool deleted = delete_lines(buffer, middle_lines, prefix_lines);
+            TTE_ASSERT(deleted);
+        }
+        const Length middle_size = suffix_offset - prefix_size;
+        if (middle_size == 0) {
+            return;
+        }
+        Char* middle = static_cast<Char*>(malloc(sizeof(Char) * middle_size));
+        memcpy(middle, text + prefix_size, middle_size);
+        Storage* lines = create_lines_from_text(middle, middle_size);
+        TTE_ASSERT(lines);
+        if (buffer.intern_table) {
+            intern_lines(buffer, *lines);
+            free(middle);
+        } else {
+            Storage* text_storage = static_cast<Storage*>(malloc(sizeof(Storage)));
+            *text_storage = Storage{0, middle, middle_size, &release_allocation};
+            add_storage(buffer, *text_storage, middle_size);
+        }
+        std::atomic<Line*>* link = get_link_internal(buffer, prefix_lines);
+        TTE_ASSERT(link);
+        insert_lines_from_storage(buffer, *link, *lines);
+    }
+
+    [[nodiscard]] static FileWatch* create_watch(const char* path, const bool follow, const Length max_lines) {
+        TTE_ASSERT(path);
+        const int file = open(path, O_RDONLY);
+        if (file == -1) {
+            return nullptr;
+        }
+
+        FileWatch* watch = static_cast<FileWatch*>(malloc(sizeof(FileWatch)));
+        memset(static_cast<void*>(watch), 0, sizeof(FileWatch));
+        const Length path_length = strlen(path);
+        watch->path = static_cast<char*>(malloc(sizeof(char) * (path_length + 1)));
+        memcpy(watch->path, path, path_length + 1);
+        watch->notify_file = -1;
+        watch->watch = -1;
+        watch->follow = follow;
+        watch->max_lines = max_lines;
+
+        struct stat data;
+        bool success = fstat(file, &data) == 0;
+        if (success) {
+            FileIdentity identity = get_identity(data);
+            // a follow reads the whole file with the following polls
+            if (follow) {
+                watch->pending = identity.size != 0;
+                identity.size = 0;
+            }
+            success = set_file(*watch, file, identity);
+        }
+        close(file);
+        if (!success) {
+            unwatch_file(*watch);
+            return nullptr;
+        }
+
+#if defined(__linux__)
+        watch->notify_file = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch->notify_file != -1) {
+            add_watch(*watch);
+        }
+#endif
+        return watch;
+    }
+
+    // deletes all lines of a followed buffer, so the file is read again from its start
+    static void restart_follow(FileWatch& watch, Buffer& buffer) {
+        delete_first_lines(watch, buffer, get_buffer_length(buffer));
+        watch.identity.size = 0;
+        watch.tail_length = 0;
+    }
+
+    // #endregion
+
+    FileWatch* watch_file(const char* path) { return create_watch(path, false, 0); }
+
+    FileWatch* follow_file(const char* path, const Length max_lines) { return create_watch(path, true, max_lines); }
+
+    void unwatch_file(FileWatch& watch) {
+        if (watch.notify_file != -1) {
+            close(watch.notify_file);
+        }
+        free(watch.path);
+        free(&watch);
+    }
+
+    bool is_file_watch_pending(FileWatch& watch) { return watch.pending; }
+
+    FileChange poll_file_watch(FileWatch& watch, Buffer& buffer) {
+#if defined(__linux__)
+        // the events are read even when pending, so they are not seen again after the pending bytes were read
+        if (watch.notify_file != -1 && !read_events(watch) && !watch.pending) {
+            return FileChange::None;
+        }
+#endif
+
+        // a deleted file leaves the buffer as it is
+        const int file = open(watch.path, O_RDONLY);
+        if (file == -1) {
+            watch.pending = false;
+            return FileChange::None;
+        }
+        struct stat data;
+        if (fstat(file, &data) != 0) {
+            close(file);
+            return FileChange::Failed;
+        }
+        const FileIdentity identity = get_identity(data);
+        Char tail[watch_tail_capacity];
+        const bool same_tail = identity.size >= watch.identity.size &&
+            read_at(file, tail, watch.tail_length, watch.identity.size - watch.tail_length) &&
+            memcmp(tail, watch.tail, watch.tail_length) == 0;
+        // the modification time may not change between two writes of the same size, the tail often does
+        if (same_tail && is_same_identity(identity, watch.identity)) {
+            close(file);
+            watch.pending = false;
+            return FileChange::None;
+        }
+
+        FileChange result = FileChange::Failed;
+        bool append = same_tail && identity.inode == watch.identity.inode && identity.size > watch.identity.size;
+        // a followed file that changed other than by appending (e.g. it was truncated or rotated) is read again
+        if (watch.follow && !append) {
+            restart_follow(watch, buffer);
+            append = identity.size != 0;
+            result = FileChange::Changed;
+        }
+
+        // the bytes read by this poll, the file identity once read fully
+        FileIdentity read_identity = identity;
+        if (append) {
+            read_identity.size = std::min(identity.size, watch.identity.size + max_poll_size);
+            if (apply_append(watch, buffer, file, read_identity.size)) {
+                result = result == FileChange::Changed ? result : FileChange::Appended;
+            } else {
+                result = FileChange::Failed;
+            }
+        } else if (watch.follow) {
+            // an empty file, after restart_follow
+        } else if (identity.size == 0) {
+            apply_change(watch, buffer, nullptr, 0);
+            result = FileChange::Changed;
+        } else {
+            void* memory = mmap(nullptr, identity.size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (memory != MAP_FAILED) {
+                apply_change(watch, buffer, static_cast<const Char*>(memory), identity.size);
+                munmap(memory, identity.size);
+                result = FileChange::Changed;
+            }
+        }
+
+        if (result != FileChange::Failed && !set_file(watch, file, read_identity)) {
+            result = FileChange::Failed;
+        }
+        watch.pending = result != FileChange::Failed && read_identity.size < identity.size;
+        close(file);
+        return result;
+    }
+}}
@@ -0,0 +1,165 @@
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <cstdlib>
+#include <cstring>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    static const constexpr Length min_intern_table_capacity = 64;
+
+    // data shared by the identical lines of a buffer, followed by the data itself
+    struct InternedData {
+        U64 hash;
+        // the lines that use the data
+        U64 reference_count;
+        Length length;
+    };
+
+    // open addressing with linear probing, writer only
+    struct InternTable {
+        // nullptr for an empty slot
+        InternedData** entries;
+        // a power of two
+        Length capacity;
+        Length length;
+    };
+
+    [[nodiscard]] static inline Char* get_data(InternedData& interned) {
+        return reinterpret_cast<Char*>(&interned + 1);
+    }
+
+    [[nodiscard]] static inline InternedData& get_interned(Char* data) {
+        return *(reinterpret_cast<InternedData*>(data) - 1);
+    }
+
+    [[nodiscard]] static U64 hash_data(const Char* data, const Length length) {
+        static const constexpr U64 multiplier = 0x9E3779B97F4A7C15ull;
+        U64 result = length * multiplier;
+        Length i = 0;
+        for (; i + sizeof(U64) <= length; i += sizeof(U64)) {
+            U64 word;
+            memcpy(&word, data + i, sizeof(U64));
+            result = (result ^ word) * multiplier;
+            result ^= result >> 29;
+        }
+        U64 word = 0;
+        memcpy(&word, data + i, length - i);
+        result = (result ^ word) * multiplier;
+        return result ^ (result >> 32);
+    }
+
+    static void set_capacity(Buffer& buffer, InternTable& table, const Length capacity) {
+        InternedData** const entries = static_cast<InternedData**>(malloc(sizeof(InternedData*) * capacity));
+        memset(static_cast<void*>(entries), 0, sizeof(InternedData*) * capacity);
+        for (Length i = 0; i < table.capacity; ++i) {
+            if (InternedData* const interned = table.entries[i]) {
+                Length slot = interned->hash & (capacity - 1);
+                while (entries[slot]) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                entries[slot] = interned;
+            }
+        }
+        free(table.entries);
+        buffer.memory_usage.fetch_add(sizeof(InternedData*) * capacity, std::memory_order_relaxed);
+        buffer.memory_usage.fetch_sub(sizeof(InternedData*) * table.capacity, std::memory_order_relaxed);
+        table.entries = entries;
+        table.capacity = capacity;
+    }
+
+    // #endregion
+
+    void enable_line_interning(Buffer& buffer) {
+        if (buffer.intern_table) {
+            return;
+        }
+        InternTable* table = static_cast<InternTable*>(malloc(sizeof(InternTable)));
+        memset(static_cast<void*>(table), 0, sizeof(InternTable));
+        set_capacity(buffer, *table, min_intern_table_capacity);
+        buffer.intern_table = table;
+    }
+
+    Char* intern_data(Buffer& buffer, const Char* data, const Length length) {
+        InternTable& table = *buffer.intern_table;
+        const U64 hash = hash_data(data, length);
+        Length slot = hash & (table.capacity - 1);
+        while (InternedData* const interned = table.entries[slot]) {
+            if (interned->hash == hash && interned->length == length &&
+                memcmp(get_data(*interned), data, length) == 0) {
+                ++interned->reference_count;
+                return get_data(*interned);
+            }
+            slot = (slot + 1) & (table.capacity - 1);
+        }
+
+        InternedData* interned = static_cast<InternedData*>(malloc(sizeof(InternedData) + sizeof(Char) * length));
+        interned->hash = hash;
+        interned->reference_count = 1;
+        interned->length = length;
+        memcpy(get_data(*interned), data, length);
+        buffer.memory_usage.fetch_add(sizeof(InternedData) + length, std::memory_order_relaxed);
+        table.entries[slot] = interned;
+        ++table.length;
+        // kept at most 3/4 full, so probe sequences stay short
+        if (table.length * 4 > table.capacity * 3) {
+            set_capacity(buffer, table, table.capacity * 2);
+        }
+        return get_data(*interned);
+    }
+
+    void release_interned_data(Buffer& buffer, Char* data) {
+        InternedData& interned = get_interned(data);
+        TTE_ASSERT(interned.reference_count > 0);
+        if (--interned.reference_count != 0) {
+            return;
+        }
+
+        // removed by shifting back the entries after it that would otherwise not be found, so no tombstones are needed
+        InternTable& table = *buffer.intern_table;
+        Length slot = interned.hash & (table.capacity - 1);
+        while (table.entries[slot] != &interned) {
+            slot = (slot + 1) & (table.capacity - 1);
+        }
+        Length next = slot;
+        for (;;) {
+            next = (next + 1) & (table.capacity - 1);
+            InternedData* const entry = table.entries[next];
+            if (!entry) {
+                break;
+            }
+            const Length home = entry->hash & (table.capacity - 1);
+            // whether home is cyclically outside (slot, next], then entry can move to slot
+            const bool can_move = slot <= next ? (home <= slot || home > next) : (home <= slot && home > next);
+            if (can_move) {
+                table.entries[slot] = entry;
+                slot = next;
+            }
+        }
+        table.entries[slot] = nullptr;
+        --table.length;
+        // readers may still be reading the lines that used the data
+        retire_memory(buffer, &interned, sizeof(InternedData) + interned.length);
+    }
+
+    void intern_lines(Buffer& buffer, Storage& lines_storage) {
+        Line* const lines = static_cast<Line*>(lines_storage.memory);
+        const Length number_of_lines = lines_storage.size / sizeof(Line);
+        for (Length i = 0; i < number_of_lines; ++i) {
+            TTE_ASSERT(lines[i].flags & line_flags::borrowed_line);
+            lines[i].data = intern_data(buffer, lines[i].data, lines[i].length);
+            lines[i].flags = line_flags::borrowed_line | line_flags::interned_data;
+        }
+    }
+
+    void destroy_intern_table(Buffer& buffer) {
+        if (InternTable* const table = buffer.intern_table) {
+            for (Length i = 0; i < table->capacity; ++i) {
+                free(table->entries[i]);
+            }
+            free(table->entries);
+            free(table);
+            buffer.intern_table = nullptr;
+        }
+    }
+}}
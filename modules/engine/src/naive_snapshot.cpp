@@ -0,0 +1,282 @@
+#include <tte/engine/snapshot.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    // file layout (native endianness, every section 8 byte aligned):
+    //  SnapshotHeader
+    //  line table: number_of_lines Lines, linked in order, whose data and next point into the file as if it were
+    //              mapped at base_address, so a buffer links them as they are (see create_buffer_from_snapshot)
+    //  text
+    //  user data
+    static const constexpr U32 snapshot_magic = 0x53455454;
+    static const constexpr U32 snapshot_version = 2;
+    // where snapshots are mapped if the address is free, most often it is and the line table is used without
+    // relocating it. far from where heaps and other mappings are placed.
+    static const constexpr U64 snapshot_base_address = 0x200000000000ull;
+
+    struct SnapshotHeader {
+        U32 magic;
+        U32 version;
+        U64 file_size;
+        U64 base_address;
+        U64 number_of_lines;
+        U64 line_table_offset;
+        U64 text_offset;
+        U64 text_size;
+        U64 user_data_offset;
+        U64 user_data_size;
+    };
+
+    struct Snapshot {
+        Storage* mapping;
+        SnapshotHeader header;
+        // the line table is linked into at most one buffer
+        bool lines_taken;
+    };
+
+    // the line table of a snapshot, as a storage the buffer borrows its lines from, holding a reference to the mapping
+    struct LineTable {
+        // must be the first member, release_line_table gets the storage
+        Storage storage;
+        Storage* mapping;
+    };
+
+    [[nodiscard]] static Length align_8(const Length value) { return (value + 7) & ~static_cast<Length>(7); }
+
+    static void release_mapping(Storage& storage) {
+        munmap(storage.memory, storage.size);
+        free(&storage);
+    }
+
+    static void release_line_table(Storage& storage) {
+        LineTable* const line_table = reinterpret_cast<LineTable*>(&storage);
+        release_storage(*line_table->mapping);
+        free(line_table);
+    }
+
+    // the pointer to offset in a snapshot mapped at base_address
+    template <typename T> [[nodiscard]] static T* get_pointer(const U64 base_address, const U64 offset) {
+        return reinterpret_cast<T*>(static_cast<uintptr_t>(base_address + offset));
+    }
+
+    [[nodiscard]] static bool is_valid_header(const SnapshotHeader& header, const Length file_size) {
+        if (header.magic != snapshot_magic || header.version != snapshot_version || header.file_size != file_size ||
+            header.base_address != snapshot_base_address) {
+            return false;
+        }
+
+        // sizes are checked against the file size before they are added, so the sums below can not overflow
+        return header.line_table_offset == align_8(sizeof(SnapshotHeader)) &&
+            header.number_of_lines <= file_size / sizeof(Line) &&
+            header.text_offset == header.line_table_offset + header.number_of_lines * sizeof(Line) &&
+            header.text_size <= file_size && header.text_offset + header.text_size <= file_size &&
+            header.user_data_offset == align_8(header.text_offset + header.text_size) &&
+            header.user_data_size <= file_size && header.user_data_offset + header.user_data_size == file_size;
+    }
+
+    // the ends of the line table are where the header puts them. the lines between are not read, the snapshot is
+    // renamed into place whole once written, so a valid header comes with the line table written with it.
+    [[nodiscard]] static bool is_valid_line_table(const SnapshotHeader& header, const Line* lines) {
+        if (header.number_of_lines == 0) {
+            return header.text_size == 0;
+        }
+        const Line& first = lines[0];
+        const Line& last = lines[header.number_of_lines - 1];
+        return first.data == get_pointer<Char>(header.base_address, header.text_offset) &&
+            !get_next(last.next) && last.length <= header.text_size &&
+            last.data == get_pointer<Char>(header.base_address, header.text_offset + header.text_size - last.length);
+    }
+
+    // moves the pointers of the line table, written for a mapping at base_address, to the mapping at memory
+    static void relocate_line_table(const SnapshotHeader& header, U8* memory) {
+        const uintptr_t delta = reinterpret_cast<uintptr_t>(memory) - static_cast<uintptr_t>(header.base_address);
+        Line* const lines = reinterpret_cast<Line*>(memory + header.line_table_offset);
+        for (Length i = 0; i < header.number_of_lines; ++i) {
+            lines[i].data = reinterpret_cast<Char*>(reinterpret_cast<uintptr_t>(lines[i].data) + delta);
+            if (Line* next = get_next(lines[i].next)) {
+                lines[i].next.store(
+                    reinterpret_cast<Line*>(reinterpret_cast<uintptr_t>(next) + delta), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] static bool write_padding(FILE* file, const Length size) {
+        static const U8 zeros[8] = {};
+        return size == 0 || fwrite(zeros, size, 1, file) == 1;
+    }
+
+    // #endregion
+
+    bool write_snapshot(Buffer& buffer, const char* path, const void* user_data, const Length user_data_size) {
+        TTE_ASSERT(path);
+        TTE_ASSERT(user_data || user_data_size == 0);
+        SnapshotHeader header{};
+        header.magic = snapshot_magic;
+        header.version = snapshot_version;
+        header.base_address = snapshot_base_address;
+        for (Line* line = get_next(buffer.first_line); line; line = get_next(line->next)) {
+            ++header.number_of_lines;
+            header.text_size += line->length;
+        }
+        header.line_table_offset = align_8(sizeof(SnapshotHeader));
+        header.text_offset = header.line_table_offset + header.number_of_lines * sizeof(Line);
+        header.user_data_offset = align_8(header.text_offset + header.text_size);
+        header.user_data_size = user_data_size;
+        header.file_size = header.user_data_offset + header.user_data_size;
+
+        const Length path_length = strlen(path);
+        char* temporary_path = static_cast<char*>(malloc(sizeof(char) * (path_length + 5)));
+        memcpy(temporary_path, path, path_length);
+        memcpy(temporary_path + path_length, ".tmp", 5);
+
+        FILE* file = fopen(temporary_path, "wb");
+        if (!file) {
+            free(temporary_path);
+            return false;
+        }
+
+        bool result = fwrite(&header, sizeof(SnapshotHeader), 1, file) == 1 &&
+            write_padding(file, header.line_table_offset - sizeof(SnapshotHeader));
+        U64 offset = 0;
+        Length index = 0;
+        for (Line* line = get_next(buffer.first_line); line && result; line = get_next(line->next), ++index) {
+            Line record;
+            memset(static_cast<void*>(&record), 0, sizeof(Line));
+            record.data = get_pointer<Char>(header.base_address, header.text_offset + offset);
+            record.length = line->length;
+            record.next.store(index + 1 < header.number_of_lines ?
+                    get_pointer<Line>(header.base_address, header.line_table_offset + (index + 1) * sizeof(Line)) :
+                    nullptr,
+                std::memory_order_relaxed);
+            // the lines live in the mapping and borrow their data from it
+            record.flags = line_flags::borrowed_data | line_flags::borrowed_line;
+            result = fwrite(static_cast<const void*>(&record), sizeof(Line), 1, file) == 1;
+            offset += line->length;
+        }
+        // compressed lines are decompressed into data first
+        Char* data = nullptr;
+        Length data_capacity = 0;
+        for (Line* line = get_next(buffer.first_line); line && result; line = get_next(line->next)) {
+            const Char* line_data = line->data;
+            if (line->flags & line_flags::compressed_data) {
+                if (line->length > data_capacity) {
+                    free(data);
+                    data_capacity = std::max(line->length, data_capacity * 2);
+                    data = static_cast<Char*>(malloc(sizeof(Char) * data_capacity));
+                }
+                copy_line_data(buffer, *line, 0, line->length, data);
+                line_data = data;
+            }
+            result = line->length == 0 || fwrite(line_data, line->length, 1, file) == 1;
+        }
+        free(data);
+        result = result && write_padding(file, header.user_data_offset - header.text_offset - header.text_size) &&
+            (user_data_size == 0 || fwrite(user_data, user_data_size, 1, file) == 1);
+        result = fclose(file) == 0 && result;
+        result = result && rename(temporary_path, path) == 0;
+        if (!result) {
+            remove(temporary_path);
+        }
+
+        free(temporary_path);
+        return result;
+    }
+
+    Snapshot* open_snapshot(const char* path) {
+        TTE_ASSERT(path);
+        const int file = open(path, O_RDONLY);
+        if (file == -1) {
+            return nullptr;
+        }
+
+        struct stat data;
+        SnapshotHeader header;
+        if (fstat(file, &data) != 0 || static_cast<Length>(data.st_size) < sizeof(SnapshotHeader) ||
+            pread(file, &header, sizeof(SnapshotHeader), 0) != static_cast<ssize_t>(sizeof(SnapshotHeader)) ||
+            !is_valid_header(header, static_cast<Length>(data.st_size))) {
+            close(file);
+            return nullptr;
+        }
+
+        // private and writable, so the lines can be linked to others and only the pages that are changed are copied
+        const Length size = static_cast<Length>(data.st_size);
+        void* memory =
+            mmap(get_pointer<void>(header.base_address, 0), size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        close(file);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+
+        U8* const bytes = static_cast<U8*>(memory);
+        if (!is_valid_line_table(header, reinterpret_cast<const Line*>(bytes + header.line_table_offset))) {
+            munmap(memory, size);
+            return nullptr;
+        }
+        // the address is only a hint, elsewhere the line table is relocated, which takes time linear in its lines
+        if (memory != get_pointer<void>(header.base_address, 0)) {
+            relocate_line_table(header, bytes);
+        }
+
+        Storage* mapping = static_cast<Storage*>(malloc(sizeof(Storage)));
+        *mapping = Storage{1, memory, size, &release_mapping};
+        Snapshot* result = static_cast<Snapshot*>(malloc(sizeof(Snapshot)));
+        result->mapping = mapping;
+        result->header = header;
+        result->lines_taken = false;
+        return result;
+    }
+
+    void close_snapshot(Snapshot& snapshot) {
+        release_storage(*snapshot.mapping);
+        free(&snapshot);
+    }
+
+    const void* get_snapshot_user_data(Snapshot& snapshot, Length* user_data_size) {
+        *user_data_size = snapshot.header.user_data_size;
+        return static_cast<const U8*>(snapshot.mapping->memory) + snapshot.header.user_data_offset;
+    }
+
+    Buffer* create_buffer_from_snapshot(Snapshot& snapshot) {
+        if (snapshot.lines_taken) {
+            return nullptr;
+        }
+        snapshot.lines_taken = true;
+
+        const SnapshotHeader& header = snapshot.header;
+        Buffer* buffer = &create_buffer();
+        if (header.number_of_lines == 0) {
+            return buffer;
+        }
+
+        // the lines are linked as they are in the mapping, a line that is edited gets its own data, a line that is
+        // deleted is only released with the buffer. neither the lines nor the text are counted in the memory usage
+        // of the buffer, they are mapped.
+        U8* const memory = static_cast<U8*>(snapshot.mapping->memory);
+        Line* const lines = reinterpret_cast<Line*>(memory + header.line_table_offset);
+        LineTable* line_table = static_cast<LineTable*>(malloc(sizeof(LineTable)));
+        line_table->storage = Storage{0, lines, sizeof(Line) * header.number_of_lines, &release_line_table};
+        line_table->mapping = snapshot.mapping;
+        retain_storage(*snapshot.mapping);
+        add_storage(*buffer, line_table->storage, 0);
+        add_storage(*buffer, *snapshot.mapping, 0);
+
+        const Length last = header.number_of_lines - 1;
+        publish(buffer->first_line, &lines[0]);
+        buffer->last_line = &lines[last];
+        buffer->last_link = last == 0 ? &buffer->first_line : &lines[last - 1].next;
+        buffer->line_count.store(header.number_of_lines, std::memory_order_relaxed);
+        return buffer;
+    }
+}}
@@ -0,0 +1,451 @@
+#include <tte/engine/trace.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    static const constexpr char* trace_header = "tte_trace 1\n";
+
+    // indexed by common::Event::Type
+    static const constexpr char* event_type_names[] = {
+        "null",
+        "unknown",
+        "quit",
+        "key_down",
+        "key_up",
+        "window_close",
+        "window_resized",
+        "mouse_wheel",
+    };
+
+    // indexed by common::KeyCode
+    static const constexpr char* keycode_names[] = {
+        "unknown", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n", "o", "p", "q", "r", "s",
+        "t", "u", "v", "w", "x", "y", "z", "backspace", "space", "return",
+    };
+
+    // indexed by TraceRecordType
+    static const constexpr char* record_type_names[] = {
+        "cursor",
+        "event",
+        "insert_empty_lines",
+        "insert_line",
+        "insert_characters",
+        "delete_lines",
+        "delete_characters",
+        "merge_lines",
+    };
+
+    static const constexpr Length number_of_event_types = sizeof(event_type_names) / sizeof(event_type_names[0]);
+    static const constexpr Length number_of_keycodes = sizeof(keycode_names) / sizeof(keycode_names[0]);
+    static const constexpr Length number_of_record_types = sizeof(record_type_names) / sizeof(record_type_names[0]);
+
+    struct TraceWriter {
+        FILE* file;
+        bool failed;
+    };
+
+    struct Trace {
+        // the text of the trace file, the data of the records points into it
+        Char* text;
+        TraceRecord* records;
+        Length number_of_records;
+    };
+
+    [[nodiscard]] static bool has_keycode(const common::Event::Type type) {
+        return type == common::Event::Type::KeyDown || type == common::Event::Type::KeyUp;
+    }
+
+    static void write_record(TraceWriter& writer, const TraceRecordType type, const Length* numbers,
+        const Length number_of_numbers, const Char* data, const Length data_length) {
+        bool result = fputs(record_type_names[static_cast<U8>(type)], writer.file) >= 0;
+        for (Length i = 0; i < number_of_numbers && result; ++i) {
+            result = fprintf(writer.file, " %llu", static_cast<unsigned long long>(numbers[i])) > 0;
+        }
+        if (data) {
+            result = result && fprintf(writer.file, " %llu ", static_cast<unsigned long long>(data_length)) > 0 &&
+                (data_length == 0 || fwrite(data, data_length, 1, writer.file) == 1);
+        }
+        result = result && fputc('\n', writer.file) != EOF;
+        writer.failed = writer.failed || !result;
+    }
+
+    // caller owns returned memory
+    // may return nullptr
+    [[nodiscard]] static Char* read_whole_file(const char* path, Length* size) {
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            return nullptr;
+        }
+
+        Length capacity = 64 * 1024;
+        Char* result = static_cast<Char*>(malloc(sizeof(Char) * capacity));
+        *size = 0;
+        for (;;) {
+            *size += fread(result + *size, 1, capacity - *size, file);
+            if (*size != capacity) {
+                break;
+            }
+            capacity *= 2;
+            result = static_cast<Char*>(realloc(result, sizeof(Char) * capacity));
+        }
+
+        const bool failed = ferror(file) != 0;
+        fclose(file);
+        if (failed) {
+            free(result);
+            return nullptr;
+        }
+        return result;
+    }
+
+    struct Parser {
+        const Char* at;
+        const Char* end;
+    };
+
+    // reads up to the next space or end of line
+    [[nodiscard]] static bool parse_word(Parser& parser, const char* const* names, const Length number_of_names,
+        Length* result) {
+        const Char* const begin = parser.at;
+        while (parser.at != parser.end && *parser.at != ' ' && *parser.at != '\n') {
+            ++parser.at;
+        }
+
+        const Length length = static_cast<Length>(parser.at - begin);
+        for (Length i = 0; i < number_of_names; ++i) {
+            if (strlen(names[i]) == length && memcmp(names[i], begin, length) == 0) {
+                *result = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // reads a space and a decimal number
+    [[nodiscard]] static bool parse_number(Parser& parser, Length* result) {
+        if (parser.at == parser.end || *parser.at != ' ') {
+            return false;
+        }
+        ++parser.at;
+
+        const Char* const begin = parser.at;
+        *result = 0;
+        while (parser.at != parser.end && *parser.at >= '0' && *parser.at <= '9') {
+            *result = *result * 10 + static_cast<Length>(*parser.at - '0');
+            ++parser.at;
+        }
+        return parser.at != begin;
+    }
+
+    // reads a space and a decimal number, which may be negative
+    [[nodiscard]] static bool parse_signed_number(Parser& parser, S64* result) {
+        if (parser.at == parser.end || *parser.at != ' ') {
+            return false;
+        }
+        ++parser.at;
+
+        const bool negative = parser.at != parser.end && *parser.at == '-';
+        if (negative) {
+            ++parser.at;
+        }
+        const Char* const begin = parser.at;
+        *result = 0;
+        while (parser.at != parser.end && *parser.at >= '0' && *parser.at <= '9' && *result <= INT32_MAX) {
+            *result = *result * 10 + (*parser.at - '0');
+            ++parser.at;
+        }
+        *result = negative ? -*result : *result;
+        return parser.at != begin;
+    }
+
+    [[nodiscard]] static bool parse_numbers(Parser& parser, Length* first, Length* second) {
+        return parse_number(parser, first) && (!second || parse_number(parser, second));
+    }
+
+    // reads a space, the data length, a space and the data
+    [[nodiscard]] static bool parse_data(Parser& parser, TraceRecord* record) {
+        if (!parse_number(parser, &record->data_length) || parser.at == parser.end || *parser.at != ' ' ||
+            static_cast<Length>(parser.end - parser.at - 1) < record->data_length) {
+            return false;
+        }
+
+        record->data = record->data_length == 0 ? nullptr : parser.at + 1;
+        parser.at += record->data_length + 1;
+        return true;
+    }
+
+    [[nodiscard]] static bool parse_event(Parser& parser, common::Event* event) {
+        Length type;
+        if (parser.at == parser.end || *parser.at != ' ') {
+            return false;
+        }
+        ++parser.at;
+        if (!parse_word(parser, event_type_names, number_of_event_types, &type)) {
+            return false;
+        }
+
+        memset(static_cast<void*>(event), 0, sizeof(common::Event));
+        event->type = static_cast<common::Event::Type>(type);
+        if (event->type == common::Event::Type::MouseWheel) {
+            S64 y;
+            if (!parse_signed_number(parser, &y) || y < INT32_MIN || y > INT32_MAX) {
+                return false;
+            }
+            event->wheel.y = static_cast<S32>(y);
+            return true;
+        }
+        if (!has_keycode(event->type)) {
+            return true;
+        }
+
+        Length keycode;
+        Length repeat;
+        if (parser.at == parser.end || *parser.at != ' ') {
+            return false;
+        }
+        ++parser.at;
+        if (!parse_word(parser, keycode_names, number_of_keycodes, &keycode) || !parse_number(parser, &repeat) ||
+            repeat > 0xFF) {
+            return false;
+        }
+        event->key.keycode = static_cast<common::KeyCode>(keycode);
+        event->key.repeat = static_cast<U8>(repeat);
+        return true;
+    }
+
+    [[nodiscard]] static bool parse_record(Parser& parser, TraceRecord* record) {
+        Length type;
+        if (!parse_word(parser, record_type_names, number_of_record_types, &type)) {
+            return false;
+        }
+
+        memset(static_cast<void*>(record), 0, sizeof(TraceRecord));
+        record->type = static_cast<TraceRecordType>(type);
+        bool result = false;
+        switch (record->type) {
+            case TraceRecordType::Cursor: {
+                result = parse_numbers(parser, &record->line_index, &record->character_index);
+                break;
+            }
+            case TraceRecordType::Event: {
+                result = parse_event(parser, &record->event);
+                break;
+            }
+            case TraceRecordType::InsertEmptyLines:
+            case TraceRecordType::DeleteLines: {
+                result = parse_numbers(parser, &record->number, &record->line_index);
+                break;
+            }
+            case TraceRecordType::InsertLine: {
+                result = parse_numbers(parser, &record->line_index, nullptr) && parse_data(parser, record);
+                break;
+            }
+            case TraceRecordType::InsertCharacters: {
+                result = parse_numbers(parser, &record->line_index, &record->character_index) &&
+                    parse_data(parser, record);
+                break;
+            }
+            case TraceRecordType::DeleteCharacters: {
+                result = parse_number(parser, &record->number) &&
+                    parse_numbers(parser, &record->line_index, &record->character_index);
+                break;
+            }
+            case TraceRecordType::MergeLines: {
+                result = parse_numbers(parser, &record->line_index, nullptr);
+                break;
+            }
+        }
+
+        if (!result || parser.at == parser.end || *parser.at != '\n') {
+            return false;
+        }
+        ++parser.at;
+        return true;
+    }
+
+    // #endregion
+
+    TraceWriter* open_trace_writer(const char* path) {
+        TTE_ASSERT(path);
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            return nullptr;
+        }
+        if (fputs(trace_header, file) < 0) {
+            fclose(file);
+            return nullptr;
+        }
+
+        TraceWriter* result = static_cast<TraceWriter*>(malloc(sizeof(TraceWriter)));
+        result->file = file;
+        result->failed = false;
+        return result;
+    }
+
+    bool close_trace_writer(TraceWriter& writer) {
+        const bool result = fclose(writer.file) == 0 && !writer.failed;
+        free(&writer);
+        return result;
+    }
+
+    void trace_buffer(TraceWriter& writer, Buffer& buffer) {
+        // compressed lines are decompressed into data first
+        Char* data = nullptr;
+        Length data_capacity = 0;
+        Length line_index = 0;
+        for (Line* line = get_next(buffer.first_line); line; line = get_next(line->next)) {
+            if (line->length > data_capacity) {
+                free(data);
+                data_capacity = std::max(line->length, data_capacity * 2);
+                data = static_cast<Char*>(malloc(sizeof(Char) * data_capacity));
+            }
+            copy_line_data(buffer, *line, 0, line->length, data);
+            trace_insert_line(writer, line_index, data, line->length);
+            ++line_index;
+        }
+        free(data);
+    }
+
+    void trace_cursor(TraceWriter& writer, const Length line_index, const Length character_index) {
+        const Length numbers[] = {line_index, character_index};
+        write_record(writer, TraceRecordType::Cursor, numbers, 2, nullptr, 0);
+    }
+
+    void trace_event(TraceWriter& writer, const common::Event& event) {
+        const Length type = static_cast<Length>(event.type);
+        TTE_ASSERT(type < number_of_event_types);
+        bool result = fprintf(writer.file, "%s %s", record_type_names[static_cast<U8>(TraceRecordType::Event)],
+                          event_type_names[type]) > 0;
+        if (has_keycode(event.type)) {
+            const Length keycode = static_cast<Length>(event.key.keycode);
+            TTE_ASSERT(keycode < number_of_keycodes);
+            result = result && fprintf(writer.file, " %s %u", keycode_names[keycode], event.key.repeat) > 0;
+        } else if (event.type == common::Event::Type::MouseWheel) {
+            result = result && fprintf(writer.file, " %d", static_cast<int>(event.wheel.y)) > 0;
+        }
+        result = result && fputc('\n', writer.file) != EOF;
+        writer.failed = writer.failed || !result;
+    }
+
+    void trace_insert_empty_lines(TraceWriter& writer, const Length number_of_lines, const Length line_index) {
+        const Length numbers[] = {number_of_lines, line_index};
+        write_record(writer, TraceRecordType::InsertEmptyLines, numbers, 2, nullptr, 0);
+    }
+
+    void trace_insert_line(TraceWriter& writer, const Length line_index, const Char* data, const Length data_length) {
+        TTE_ASSERT(data || data_length == 0);
+        write_record(writer, TraceRecordType::InsertLine, &line_index, 1, data ? data : "", data_length);
+    }
+
+    void trace_insert_characters(TraceWriter& writer,
+        const Length line_index,
+        const Length character_index,
+        const Char* data,
+        const Length data_length) {
+        TTE_ASSERT(data || data_length == 0);
+        const Length numbers[] = {line_index, character_index};
+        write_record(writer, TraceRecordType::InsertCharacters, numbers, 2, data ? data : "", data_length);
+    }
+
+    void trace_delete_lines(TraceWriter& writer, const Length number_of_lines, const Length line_index) {
+        const Length numbers[] = {number_of_lines, line_index};
+        write_record(writer, TraceRecordType::DeleteLines, numbers, 2, nullptr, 0);
+    }
+
+    void trace_delete_characters(TraceWriter& writer,
+        const Length number_of_characters,
+        const Length line_index,
+        const Length character_index) {
+        const Length numbers[] = {number_of_characters, line_index, character_index};
+        write_record(writer, TraceRecordType::DeleteCharacters, numbers, 3, nullptr, 0);
+    }
+
+    void trace_merge_lines(TraceWriter& writer, const Length line_index) {
+        write_record(writer, TraceRecordType::MergeLines, &line_index, 1, nullptr, 0);
+    }
+
+    Trace* load_trace(const char* path) {
+        TTE_ASSERT(path);
+        Length size;
+        Char* text = read_whole_file(path, &size);
+        if (!text) {
+            return nullptr;
+        }
+
+        const Length header_length = strlen(trace_header);
+        if (size < header_length || memcmp(text, trace_header, header_length) != 0) {
+            free(text);
+            return nullptr;
+        }
+
+        Trace* result = static_cast<Trace*>(malloc(sizeof(Trace)));
+        result->text = text;
+        result->records = nullptr;
+        result->number_of_records = 0;
+        Length capacity = 0;
+        Parser parser{text + header_length, text + size};
+        while (parser.at != parser.end) {
+            if (result->number_of_records == capacity) {
+                capacity = std::max(capacity * 2, static_cast<Length>(1024));
+                result->records =
+                    static_cast<TraceRecord*>(realloc(result->records, sizeof(TraceRecord) * capacity));
+            }
+            if (!parse_record(parser, &result->records[result->number_of_records])) {
+                destroy_trace(*result);
+                return nullptr;
+            }
+            ++result->number_of_records;
+        }
+        return result;
+    }
+
+    void destroy_trace(Trace& trace) {
+        free(trace.records);
+        free(trace.text);
+        free(&trace);
+    }
+
+    const TraceRecord* get_trace_records(Trace& trace, Length* number_of_records) {
+        *number_of_records = trace.number_of_records;
+        return trace.records;
+    }
+
+    bool apply_trace_record(Buffer& buffer, const TraceRecord& record) {
+        switch (record.type) {
+            case TraceRecordType::Cursor:
+            case TraceRecordType::Event: {
+                return true;
+            }
+            case TraceRecordType::InsertEmptyLines: {
+                return insert_empty_lines(buffer, record.number, record.line_index);
+            }
+            case TraceRecordType::InsertLine: {
+                return insert_line(buffer, record.line_index, record.data ? record.data : "", record.data_length);
+            }
+            case TraceRecordType::InsertCharacters: {
+                return insert_characters(buffer,
+                    record.line_index,
+                    record.character_index,
+                    record.data ? record.data : "",
+                    record.data_length);
+            }
+            case TraceRecordType::DeleteLines: {
+                return delete_lines(buffer, record.number, record.line_index);
+            }
+            case TraceRecordType::DeleteCharacters: {
+                return delete_characters(buffer, record.number, record.line_index, record.character_index);
+            }
+            case TraceRecordType::MergeLines: {
+                return merge_lines(buffer, record.line_index);
+            }
+        }
+        return false;
+    }
+}}
@@ -0,0 +1,321 @@
+#include <tte/engine/workspace.hpp>
+#include <tte/engine/engine.hpp>
+#include <tte/engine/journal.hpp>
+#include <tte/common/assert.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "naive_engine_internal.hpp"
+
+namespace tte { namespace engine {
+    // #region internal
+    static const constexpr U64 journal_fsync_interval_milliseconds = 1000;
+
+    // contents of a file, shared by every buffer made from it. not owned by the workspace: released when the last
+    // buffer referencing it is destroyed.
+    struct SharedFile {
+        // must be the first member, release_shared_file gets the storage
+        Storage storage;
+        Workspace* workspace;
+        U64 device;
+        U64 inode;
+        S64 modification_time_seconds;
+        S64 modification_time_nanoseconds;
+        U64 content_hash;
+        SharedFile* next;
+    };
+
+    struct Document {
+        // most recently used first
+        Document* previous;
+        Document* next;
+        char* path;
+        char* journal_path;
+        bool read_only;
+        // journal was opened, which happens the first time the buffer is loaded
+        bool journal_opened;
+        Journal* journal;
+        // nullptr while evicted
+        Buffer* buffer;
+    };
+
+    struct Workspace {
+        Length memory_budget;
+        Document* first_document;
+        Document* last_document;
+        SharedFile* shared_files;
+    };
+
+    [[nodiscard]] static char* copy_string(const char* string, const char* suffix) {
+        const Length length = strlen(string);
+        const Length suffix_length = strlen(suffix);
+        char* result = static_cast<char*>(malloc(sizeof(char) * (length + suffix_length + 1)));
+        memcpy(result, string, length);
+        memcpy(result + length, suffix, suffix_length + 1);
+        return result;
+    }
+
+    // fnv-1a
+    [[nodiscard]] static U64 hash_content(const U8* data, const Length size) {
+        U64 result = 14695981039346656037ull;
+        for (Length i = 0; i < size; ++i) {
+            result = (result ^ data[i]) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    static void release_shared_file(Storage& storage) {
+        SharedFile* file = reinterpret_cast<SharedFile*>(&storage);
+        for (SharedFile** at = &file->workspace->shared_files; *at; at = &(*at)->next) {
+            if (*at == file) {
+                *at = file->next;
+                break;
+            }
+        }
+        free(storage.memory);
+        free(file);
+    }
+
+    // returns nullptr if the file does not exist or can not be read
+    [[nodiscard]] static SharedFile* get_shared_file(Workspace& workspace, const char* path) {
+        const int file = open(path, O_RDONLY);
+        if (file == -1) {
+            return nullptr;
+        }
+
+        struct stat data;
+        if (fstat(file, &data) != 0) {
+            close(file);
+            return nullptr;
+        }
+
+        const U64 device = static_cast<U64>(data.st_dev);
+        const U64 inode = static_cast<U64>(data.st_ino);
+        const Length size = static_cast<Length>(data.st_size);
+#if defined(__APPLE__)
+        const S64 modification_time_seconds = static_cast<S64>(data.st_mtimespec.tv_sec);
+        const S64 modification_time_nanoseconds = static_cast<S64>(data.st_mtimespec.tv_nsec);
+#else
+        const S64 modification_time_seconds = static_cast<S64>(data.st_mtim.tv_sec);
+        const S64 modification_time_nanoseconds = static_cast<S64>(data.st_mtim.tv_nsec);
+#endif
+        for (SharedFile* shared_file = workspace.shared_files; shared_file; shared_file = shared_file->next) {
+            if (shared_file->device == device && shared_file->inode == inode && shared_file->storage.size == size &&
+                shared_file->modification_time_seconds == modification_time_seconds &&
+                shared_file->modification_time_nanoseconds == modification_time_nanoseconds) {
+                close(file);
+                return shared_file;
+            }
+        }
+
+        // + 1 so an empty file still has valid memory
+        U8* memory = static_cast<U8*>(malloc(size + 1));
+        Length read_size = 0;
+        while (read_size < size) {
+            const ssize_t amount = read(file, memory + read_size, size - read_size);
+            if (amount <= 0) {
+                break;
+            }
+            read_size += static_cast<Length>(amount);
+        }
+        close(file);
+        if (read_size != size) {
+            free(memory);
+            return nullptr;
+        }
+
+        // the same content under another path (a copy) is shared too
+        const U64 content_hash = hash_content(memory, size);
+        for (SharedFile* shared_file = workspace.shared_files; shared_file; shared_file = shared_file->next) {
+            if (shared_file->content_hash == content_hash && shared_file->storage.size == size &&
+                memcmp(shared_file->storage.memory, memory, size) == 0) {
+                free(memory);
+                return shared_file;
+            }
+        }
+
+        SharedFile* result = static_cast<SharedFile*>(malloc(sizeof(SharedFile)));
+        result->storage = Storage{0, memory, size, &release_shared_file};
+        result->workspace = &workspace;
+        result->device = device;
+        result->inode = inode;
+        result->modification_time_seconds = modification_time_seconds;
+        result->modification_time_nanoseconds = modification_time_nanoseconds;
+        result->content_hash = content_hash;
+        result->next = workspace.shared_files;
+        workspace.shared_files = result;
+        return result;
+    }
+
+    static void unlink_document(Workspace& workspace, Document& document) {
+        if (document.previous) {
+            document.previous->next = document.next;
+        } else {
+            workspace.first_document = document.next;
+        }
+        if (document.next) {
+            document.next->previous = document.previous;
+        } else {
+            workspace.last_document = document.previous;
+        }
+        document.previous = document.next = nullptr;
+    }
+
+    static void link_document_first(Workspace& workspace, Document& document) {
+        document.previous = nullptr;
+        document.next = workspace.first_document;
+        if (workspace.first_document) {
+            workspace.first_document->previous = &document;
+        } else {
+            workspace.last_document = &document;
+        }
+        workspace.first_document = &document;
+    }
+
+    [[nodiscard]] static Document& create_document(Workspace& workspace, const char* path, const bool read_only) {
+        Document* document = static_cast<Document*>(malloc(sizeof(Document)));
+        memset(document, 0, sizeof(Document));
+        document->path = copy_string(path, "");
+        document->journal_path = copy_string(path, ".journal");
+        document->read_only = read_only;
+        link_document_first(workspace, *document);
+        return *document;
+    }
+
+    static void load_document(Workspace& workspace, Document& document) {
+        TTE_ASSERT(!document.buffer);
+        // a missing file is a new file
+        if (SharedFile* file = get_shared_file(workspace, document.path)) {
+            document.buffer = &create_buffer_from_text(
+                file->storage, static_cast<Char*>(file->storage.memory), file->storage.size);
+        } else {
+            document.buffer = &create_buffer();
+        }
+
+        if (document.read_only || (document.journal_opened && !document.journal)) {
+            return;
+        }
+
+        if (!replay_journal(*document.buffer, document.journal_path, document.path)) {
+            // leave the journal alone so it can be recovered by hand, and do not journal this document
+            TTE_DBG("Failed to replay journal: %s", document.journal_path);
+            destroy_buffer(*document.buffer);
+            document.buffer = nullptr;
+            document.journal_opened = true;
+            document.journal = nullptr;
+            load_document(workspace, document);
+            return;
+        }
+
+        if (!document.journal_opened) {
+            document.journal_opened = true;
+            document.journal = open_journal(document.journal_path, document.path, journal_fsync_interval_milliseconds);
+        }
+    }
+
+    [[nodiscard]] static bool evict_document(Document& document) {
+        if (!document.buffer) {
+            return true;
+        }
+
+        if (!document.read_only) {
+            // edits can only be restored from the journal
+            if (!document.journal || !sync_journal(*document.journal)) {
+                return false;
+            }
+        }
+
+        destroy_buffer(*document.buffer);
+        document.buffer = nullptr;
+        return true;
+    }
+
+    static void enforce_budget(Workspace& workspace, Document* keep) {
+        Document* document = workspace.last_document;
+        while (document && get_workspace_memory_usage(workspace) > workspace.memory_budget) {
+            if (document != keep && document->buffer) {
+                [[maybe_unused]] const bool evicted = evict_document(*document);
+            }
+            document = document->previous;
+        }
+    }
+
+    // #endregion
+
+    Workspace& create_workspace(const Length memory_budget) {
+        Workspace* workspace = static_cast<Workspace*>(malloc(sizeof(Workspace)));
+        memset(workspace, 0, sizeof(Workspace));
+        workspace->memory_budget = memory_budget;
+        return *workspace;
+    }
+
+    void destroy_workspace(Workspace& workspace) {
+        while (workspace.first_document) {
+            close_document(workspace, *workspace.first_document);
+        }
+        TTE_ASSERT(!workspace.shared_files);
+        free(&workspace);
+    }
+
+    Document& open_document(Workspace& workspace, const char* path, const bool read_only) {
+        TTE_ASSERT(path);
+        return create_document(workspace, path, read_only);
+    }
+
+    Document& adopt_document(Workspace& workspace, const char* path, Buffer& buffer, Journal* journal) {
+        TTE_ASSERT(path);
+        Document& document = create_document(workspace, path, false);
+        document.buffer = &buffer;
+        document.journal_opened = true;
+        document.journal = journal;
+        return document;
+    }
+
+    void close_document(Workspace& workspace, Document& document) {
+        unlink_document(workspace, document);
+        if (document.buffer) {
+            destroy_buffer(*document.buffer);
+        }
+        if (document.journal) {
+            close_journal(*document.journal);
+        }
+        free(document.journal_path);
+        free(document.path);
+        free(&document);
+    }
+
+    Buffer& get_document_buffer(Workspace& workspace, Document& document) {
+        if (workspace.first_document != &document) {
+            unlink_document(workspace, document);
+            link_document_first(workspace, document);
+        }
+        if (!document.buffer) {
+            load_document(workspace, document);
+        }
+        enforce_budget(workspace, &document);
+        return *document.buffer;
+    }
+
+    Journal* get_document_journal(Document& document) { return document.journal; }
+
+    const char* get_document_path(Document& document) { return document.path; }
+
+    bool is_document_loaded(Document& document) { return document.buffer != nullptr; }
+
+    void enforce_workspace_budget(Workspace& workspace) { enforce_budget(workspace, workspace.first_document); }
+
+    Length get_workspace_memory_usage(Workspace& workspace) {
+        Length result = 0;
+        for (Document* document = workspace.first_document; document; document = document->next) {
+            if (document->buffer) {
+                result += get_buffer_memory_usage(*document->buffer);
+            }
+        }
+        for (SharedFile* shared_file = workspace.shared_files; shared_file; shared_file = shared_file->next) {
+            result += shared_file->storage.size;
+        }
+        return result;
+    }
+}}
@@ -0,0 +1,101 @@
+#include <tte/engine/engine.hpp>
+#include <tte/common/allocation_tracker.hpp>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+// the edits are counted after a few warm up edits, which grow the retired lists of the buffer and fill its free blocks
+
+static void type_and_delete(tte::engine::Buffer& buffer,
+    const tte::Length line_index,
+    const tte::Length character_index,
+    const char* word) {
+    const tte::Length length = strlen(word);
+    for (tte::Length i = 0; i < length; ++i) {
+        ASSERT_TRUE(tte::engine::insert_character(buffer, line_index, character_index + i, word[i]));
+    }
+    for (tte::Length i = length; i-- > 0;) {
+        ASSERT_TRUE(tte::engine::delete_character(buffer, line_index, character_index + i));
+    }
+}
+
+TEST(allocation, typingInShortLineAllocatesNothingOnceWarm) {
+    if (!tte::common::is_counting_allocations()) {
+        GTEST_SKIP() << "allocations are not counted in this build";
+    }
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "the quick brown fox"));
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 1, "over the lazy dog"));
+    for (tte::Length i = 0; i < 4; ++i) {
+        type_and_delete(buffer, 0, 10, "jumps ");
+    }
+
+    const tte::common::AllocationScope scope = tte::common::start_allocation_scope();
+    for (tte::Length i = 0; i < 100; ++i) {
+        type_and_delete(buffer, 0, 10, "jumps ");
+    }
+    const tte::common::AllocationCounts counts = tte::common::get_allocation_counts(scope);
+    ASSERT_EQ(counts.allocations, 0);
+    ASSERT_EQ(counts.frees, 0);
+
+    char* line = tte::engine::line_to_c_string(buffer, 0);
+    ASSERT_STREQ(line, "the quick brown fox");
+    free(static_cast<void*>(line));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(allocation, typingInLongLineAllocatesNothingOnceWarm) {
+    if (!tte::common::is_counting_allocations()) {
+        GTEST_SKIP() << "allocations are not counted in this build";
+    }
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    std::string expected(600, 'x');
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, expected.c_str()));
+    for (tte::Length i = 0; i < 4; ++i) {
+        ASSERT_TRUE(tte::engine::insert_character(buffer, 0, 300 + i, 'a'));
+    }
+
+    const tte::common::AllocationScope scope = tte::common::start_allocation_scope();
+    for (tte::Length i = 4; i < 300; ++i) {
+        ASSERT_TRUE(tte::engine::insert_character(buffer, 0, 300 + i, 'a'));
+    }
+    const tte::common::AllocationCounts counts = tte::common::get_allocation_counts(scope);
+    ASSERT_EQ(counts.allocations, 0);
+    ASSERT_EQ(counts.frees, 0);
+
+    expected.insert(300, 300, 'a');
+    char* line = tte::engine::line_to_c_string(buffer, 0);
+    ASSERT_EQ(line, expected);
+    free(static_cast<void*>(line));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(allocation, copyLineAllocatesNothing) {
+    if (!tte::common::is_counting_allocations()) {
+        GTEST_SKIP() << "allocations are not counted in this build";
+    }
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "the quick brown fox"));
+    char data[8];
+
+    const tte::common::AllocationScope scope = tte::common::start_allocation_scope();
+    const tte::Length length = tte::engine::copy_line(buffer, 0, data, sizeof(data));
+    const tte::Length missing_length = tte::engine::copy_line(buffer, 1, data, sizeof(data));
+    ASSERT_EQ(tte::common::get_allocation_counts(scope).allocations, 0);
+
+    ASSERT_EQ(length, 19);
+    ASSERT_EQ(std::string(data, sizeof(data)), "the quic");
+    ASSERT_EQ(missing_length, 0);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(allocation, reclaimFreesFreeBlocks) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < 100; ++i) {
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, "the quick brown fox"));
+    }
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, 100, 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_EQ(tte::engine::get_buffer_memory_usage(buffer), 0);
+    tte::engine::destroy_buffer(buffer);
+}
@@ -0,0 +1,124 @@
+#include <tte/engine/engine.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+[[nodiscard]] static bool is_all(const char* data, char character) {
+    for (; *data; ++data) {
+        if (*data != character && *data != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void read_until_stopped(tte::engine::Buffer& buffer, const std::atomic<bool>& stop, std::atomic<bool>& failed) {
+    tte::Length i = 0;
+    while (!stop.load()) {
+        char* line = tte::engine::line_to_c_string(buffer, i % 64);
+        if (line) {
+            if (!is_all(line, 'x')) {
+                failed.store(true);
+            }
+            free(static_cast<void*>(line));
+        }
+        char* data = tte::engine::buffer_to_c_string(buffer);
+        if (!is_all(data, 'x')) {
+            failed.store(true);
+        }
+        free(static_cast<void*>(data));
+        [[maybe_unused]] const tte::Length length = tte::engine::get_buffer_length(buffer);
+        [[maybe_unused]] const tte::Length line_length = tte::engine::get_line_length(buffer, i % 64);
+        ++i;
+    }
+}
+
+TEST(concurrency, readersSeeWholeLinesWhileWriterEdits) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < 64; ++i) {
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, "xxxxxxxx"));
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back(read_until_stopped, std::ref(buffer), std::cref(stop), std::ref(failed));
+    }
+
+    for (tte::Length i = 0; i < 5000; ++i) {
+        const tte::Length line_index = i % 32;
+        ASSERT_TRUE(tte::engine::insert_character(buffer, line_index, 0, 'x'));
+        ASSERT_TRUE(tte::engine::insert_characters(buffer, line_index, 1, "xxx"));
+        ASSERT_TRUE(tte::engine::delete_characters(buffer, 4, line_index, 0));
+        ASSERT_TRUE(tte::engine::insert_line(buffer, line_index, "xx"));
+        ASSERT_TRUE(tte::engine::merge_lines(buffer, line_index));
+        ASSERT_TRUE(tte::engine::delete_characters(buffer, 2, line_index, 0));
+        ASSERT_TRUE(tte::engine::insert_empty_lines(buffer, 2, line_index));
+        ASSERT_TRUE(tte::engine::delete_lines(buffer, 2, line_index));
+    }
+
+    stop.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT_FALSE(failed.load());
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 64);
+    for (tte::Length i = 0; i < 64; ++i) {
+        ASSERT_EQ(tte::engine::get_line_length(buffer, i), 8);
+    }
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(concurrency, readersSeeWholeLinesWhileWriterCompresses) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < 64; ++i) {
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"));
+    }
+    tte::engine::set_decompressed_cache_budget(buffer, 0);
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back(read_until_stopped, std::ref(buffer), std::cref(stop), std::ref(failed));
+    }
+
+    for (tte::Length i = 0; i < 2000; ++i) {
+        const tte::Length line_index = i % 32;
+        ASSERT_TRUE(tte::engine::compress_lines(buffer, 32, line_index));
+        ASSERT_TRUE(tte::engine::insert_characters(buffer, line_index, 1, "xxx"));
+        ASSERT_TRUE(tte::engine::delete_characters(buffer, 3, line_index + 1, 0));
+        ASSERT_TRUE(tte::engine::merge_lines(buffer, line_index + 2));
+        ASSERT_TRUE(tte::engine::insert_line(buffer, line_index + 2, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxx"));
+    }
+
+    stop.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT_FALSE(failed.load());
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 64);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(concurrency, reclaimFreesEditedLinesWithoutReaders) {
+    tte::engine::Buffer& expected = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(expected, 0, "abc"));
+    ASSERT_TRUE(tte::engine::insert_line(expected, 1, "def"));
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "ab"));
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 1, "removed"));
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 2, "def"));
+    ASSERT_TRUE(tte::engine::insert_character(buffer, 0, 2, 'c'));
+    ASSERT_TRUE(tte::engine::delete_line(buffer, 1));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_EQ(tte::engine::get_buffer_memory_usage(buffer), tte::engine::get_buffer_memory_usage(expected));
+
+    tte::engine::destroy_buffer(buffer);
+    tte::engine::destroy_buffer(expected);
+}
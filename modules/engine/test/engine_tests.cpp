@@ -1,6 +1,7 @@
 
 #include <tte/engine/engine.hpp>
 #include <gtest/gtest.h>
+#include <cstring>
 #include <string>
 
 static const char* empty_string = "";
@@ -750,6 +751,14 @@ TEST(engine, insertCharactersManyAtEndOfNonEmptyBufferAtEndOfNonEmptyLine) {
     test_insert_characters({string_1, string_2, "abc"}, 2, 3, "123", {string_1, string_2, "abc123"}, true);
 }
 
+// short lines are stored with the line, long lines separately
+TEST(engine, insertCharactersGrowsShortLineToLongLine) {
+    const std::string short_line(60, 'a');
+    const std::string long_line = short_line + std::string(100, 'b');
+    test_insert_characters({string_1, short_line, string_2}, 1, 60, std::string(100, 'b'),
+        {string_1, long_line, string_2}, true);
+}
+
 // #endregion
 
 // #region void delete_line(Buffer&, const Length line_index);
@@ -1061,6 +1070,16 @@ TEST(engine, deleteCharactersManyAtEndOfLineWithManyCharactersWhereDeletionDoesN
     test_delete_characters({string_1, "abc", string_3}, 3, 1, 2, {string_1, "ab", string_3}, true);
 }
 
+// long lines are stored separately, short lines with the line
+TEST(engine, deleteCharactersShrinksLongLineToShortLine) {
+    tte::engine::Buffer& buffer = create_buffer({string_1, std::string(200, 'a') + "b", string_2});
+    ASSERT_TRUE(tte::engine::delete_characters(buffer, 190, 1, 0));
+    assert_buffer_state(buffer, {string_1, std::string(10, 'a') + "b", string_2});
+    ASSERT_TRUE(tte::engine::insert_characters(buffer, 1, 0, "c"));
+    assert_buffer_state(buffer, {string_1, "c" + std::string(10, 'a') + "b", string_2});
+    tte::engine::destroy_buffer(buffer);
+}
+
 // #endregion
 
 // #region const char* line_to_c_string(Buffer&, const Length line_index);
@@ -1157,3 +1176,236 @@ TEST(engine, bufferToCStringWithNonEmptyBuffer) {
 }
 
 // #endregion
+
+// #region void enable_line_interning(Buffer&);
+TEST(engine, internedLinesShareDataAndKeepContentThroughEdits) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::enable_line_interning(buffer);
+    const std::string line(200, 'x');
+    std::vector<std::string> expected_lines;
+    for (tte::Length i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, line.c_str()));
+        expected_lines.push_back(line);
+    }
+    // a copy costs about the line itself, not its data
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), 1000 * line.size() / 2);
+
+    ASSERT_TRUE(tte::engine::insert_characters(buffer, 10, 0, "edited"));
+    expected_lines[10] = "edited" + line;
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, 100, 500));
+    expected_lines.erase(expected_lines.begin() + 500, expected_lines.begin() + 600);
+    ASSERT_TRUE(tte::engine::merge_lines(buffer, 0));
+    expected_lines[0] += expected_lines[1];
+    expected_lines.erase(expected_lines.begin() + 1);
+    assert_buffer_state(buffer, expected_lines);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, internedDataIsReleasedWithItsLastLine) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::enable_line_interning(buffer);
+    std::vector<std::string> expected_lines;
+    for (tte::Length i = 0; i < 4000; ++i) {
+        expected_lines.push_back("line " + std::to_string(i % 2000));
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, expected_lines.back().c_str()));
+    }
+    // releases some data entirely and some of it only once
+    for (tte::Length i = 3000; i-- > 0;) {
+        if (i % 3 == 0) {
+            ASSERT_TRUE(tte::engine::delete_line(buffer, i));
+            expected_lines.erase(expected_lines.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+    assert_buffer_state(buffer, expected_lines);
+
+    // the released data is interned again
+    for (tte::Length i = 0; i < 2000; ++i) {
+        expected_lines.push_back("line " + std::to_string(i));
+        ASSERT_TRUE(tte::engine::insert_line(buffer, expected_lines.size() - 1, expected_lines.back().c_str()));
+    }
+    assert_buffer_state(buffer, expected_lines);
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, expected_lines.size(), 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), 64 * 1024);
+    tte::engine::destroy_buffer(buffer);
+}
+
+// #endregion
+
+// #region bool compress_lines(Buffer&, const Length number_of_lines, const Length line_index);
+// log like lines, which compress well
+[[nodiscard]] static std::vector<std::string> create_log_lines(const tte::Length number_of_lines) {
+    std::vector<std::string> result;
+    for (tte::Length i = 0; i < number_of_lines; ++i) {
+        result.push_back("2024-01-01 12:00:" + std::to_string(i % 60) + " INFO request " + std::to_string(i) +
+            " handled by worker " + std::to_string(i % 8) + (i % 10 == 0 ? "" : " in 3 ms"));
+    }
+    return result;
+}
+
+// inserts all lines at once, which takes linear time
+[[nodiscard]] static tte::engine::Buffer& create_large_buffer(const std::vector<std::string>& lines) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    std::vector<const char*> data;
+    for (const std::string& line : lines) {
+        data.push_back(line.c_str());
+    }
+    [[maybe_unused]] const bool result = tte::engine::insert_lines(buffer, data.size(), 0, data.data());
+    return buffer;
+}
+
+TEST(engine, compressedLinesKeepContentThroughEdits) {
+    std::vector<std::string> expected_lines = create_log_lines(8000);
+    expected_lines[5] = "";
+    tte::engine::Buffer& buffer = create_large_buffer(expected_lines);
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, 6000, 10));
+    assert_buffer_state(buffer, expected_lines);
+
+    // compressing again leaves compressed lines as they are
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, 8000, 0));
+    ASSERT_TRUE(tte::engine::insert_characters(buffer, 100, 4, "edited"));
+    expected_lines[100].insert(4, "edited");
+    ASSERT_TRUE(tte::engine::insert_character(buffer, 200, 0, 'x'));
+    expected_lines[200].insert(0, "x");
+    ASSERT_TRUE(tte::engine::delete_characters(buffer, 3, 300, 2));
+    expected_lines[300].erase(2, 3);
+    ASSERT_TRUE(tte::engine::merge_lines(buffer, 400));
+    expected_lines[400] += expected_lines[401];
+    expected_lines.erase(expected_lines.begin() + 401);
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, 3000, 1000));
+    expected_lines.erase(expected_lines.begin() + 1000, expected_lines.begin() + 4000);
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 3000, "inserted"));
+    expected_lines.insert(expected_lines.begin() + 3000, "inserted");
+    assert_buffer_state(buffer, expected_lines);
+
+    char* data = tte::engine::buffer_to_c_string(buffer);
+    std::string expected_data;
+    for (const std::string& line : expected_lines) {
+        expected_data += line + "\n";
+    }
+    ASSERT_TRUE(data == expected_data);
+    free(static_cast<void*>(data));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, compressedLinesUseLessMemory) {
+    const std::vector<std::string> lines = create_log_lines(100000);
+    tte::engine::Buffer& buffer = create_large_buffer(lines);
+    const tte::Length uncompressed_usage = tte::engine::get_buffer_memory_usage(buffer);
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, lines.size(), 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), uncompressed_usage / 2);
+
+    // reading decompresses one block into the cache
+    char* line = tte::engine::line_to_c_string(buffer, 50000);
+    ASSERT_EQ(line, lines[50000]);
+    free(static_cast<void*>(line));
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), uncompressed_usage / 2);
+
+    // the buffer is freed once edits leave no line in it
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, lines.size(), 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_EQ(tte::engine::get_buffer_memory_usage(buffer), 0);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, decompressedCacheKeepsToItsBudget) {
+    const std::vector<std::string> lines = create_log_lines(100000);
+    tte::engine::Buffer& buffer = create_large_buffer(lines);
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, lines.size(), 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    const tte::Length compressed_usage = tte::engine::get_buffer_memory_usage(buffer);
+
+    std::string expected_data;
+    for (const std::string& line : lines) {
+        expected_data += line + "\n";
+    }
+    // reads every block, more than twice the budget
+    tte::engine::set_decompressed_cache_budget(buffer, 256 * 1024);
+    char* data = tte::engine::buffer_to_c_string(buffer);
+    ASSERT_TRUE(data == expected_data);
+    free(static_cast<void*>(data));
+    ASSERT_LE(tte::engine::get_buffer_memory_usage(buffer), compressed_usage + 256 * 1024);
+    ASSERT_GT(tte::engine::get_buffer_memory_usage(buffer), compressed_usage);
+
+    // a budget smaller than a block still reads every line
+    tte::engine::set_decompressed_cache_budget(buffer, 0);
+    ASSERT_EQ(tte::engine::get_buffer_memory_usage(buffer), compressed_usage);
+    data = tte::engine::buffer_to_c_string(buffer);
+    ASSERT_TRUE(data == expected_data);
+    free(static_cast<void*>(data));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, compressLinesPastEndOfBuffer) {
+    tte::engine::Buffer& buffer = create_buffer({string_1, string_2});
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, 10, 1));
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, 0, 2));
+    ASSERT_FALSE(tte::engine::compress_lines(buffer, 1, 2));
+    assert_buffer_state(buffer, {string_1, string_2});
+    tte::engine::destroy_buffer(buffer);
+}
+
+// #endregion
+
+// #region Length copy_lines(Buffer&, const Length number_of_lines, const Length line_index, Char* data, const Length
+// capacity, Length* line_lengths);
+
+TEST(engine, copyLinesInMiddleOfBuffer) {
+    tte::engine::Buffer& buffer = create_buffer({string_1, string_2, empty_string, string_3, string_4});
+    char data[128];
+    tte::Length line_lengths[3];
+    const tte::Length size = tte::engine::copy_lines(buffer, 3, 1, data, sizeof(data), line_lengths);
+    const std::string expected = std::string(string_2) + '\0' + '\0' + string_3 + '\0';
+    ASSERT_EQ(size, expected.size());
+    ASSERT_EQ(std::string(data, size), expected);
+    ASSERT_EQ(line_lengths[0], strlen(string_2));
+    ASSERT_EQ(line_lengths[1], 0);
+    ASSERT_EQ(line_lengths[2], strlen(string_3));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, copyLinesPastEndOfBuffer) {
+    tte::engine::Buffer& buffer = create_buffer({string_1, string_2});
+    char data[128];
+    tte::Length line_lengths[3];
+    const tte::Length size = tte::engine::copy_lines(buffer, 3, 1, data, sizeof(data), line_lengths);
+    ASSERT_EQ(size, strlen(string_2) + 3);
+    ASSERT_EQ(std::string(data, size), std::string(string_2) + '\0' + '\0' + '\0');
+    ASSERT_EQ(line_lengths[0], strlen(string_2));
+    ASSERT_EQ(line_lengths[1], 0);
+    ASSERT_EQ(line_lengths[2], 0);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, copyLinesCopiesTheLinesThatFit) {
+    tte::engine::Buffer& buffer = create_buffer({string_1, string_2});
+    char data[16];
+    memset(data, 'x', sizeof(data));
+    tte::Length line_lengths[2];
+    const tte::Length size = tte::engine::copy_lines(buffer, 2, 0, data, sizeof(data), line_lengths);
+    ASSERT_EQ(size, strlen(string_1) + strlen(string_2) + 2);
+    ASSERT_EQ(std::string(data, strlen(string_1) + 2), std::string(string_1) + '\0' + 'x');
+    ASSERT_EQ(line_lengths[0], strlen(string_1));
+    ASSERT_EQ(line_lengths[1], strlen(string_2));
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(engine, copyLinesOfCompressedLines) {
+    const std::vector<std::string> lines = create_log_lines(8000);
+    tte::engine::Buffer& buffer = create_large_buffer(lines);
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, lines.size(), 0));
+    std::vector<tte::Length> line_lengths(40);
+    const tte::Length size = tte::engine::copy_lines(buffer, 40, 5000, nullptr, 0, line_lengths.data());
+    std::vector<char> data(size);
+    ASSERT_EQ(tte::engine::copy_lines(buffer, 40, 5000, data.data(), size, line_lengths.data()), size);
+    const char* line = data.data();
+    for (tte::Length i = 0; i < 40; ++i) {
+        ASSERT_EQ(line_lengths[i], lines[5000 + i].size());
+        ASSERT_EQ(line, lines[5000 + i]);
+        line += line_lengths[i] + 1;
+    }
+    tte::engine::destroy_buffer(buffer);
+}
+
+// #endregion
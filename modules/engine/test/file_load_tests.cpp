@@ -0,0 +1,138 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/file.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "test_helpers.hpp"
+
+// spans several chunks, with lines of many lengths and no '\n' at the end
+[[nodiscard]] static std::string create_content() {
+    std::string result;
+    for (tte::Length i = 0; i < 100000; ++i) {
+        result += std::string(i % 97, static_cast<char>('a' + i % 26)) + "\n";
+    }
+    result += "last";
+    return result;
+}
+
+static void poll_until_done(tte::engine::FileLoad& load, tte::engine::Buffer& buffer) {
+    while (!tte::engine::poll_file_load(load, buffer)) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(file_load, givesSameLinesAsLoadFile) {
+    const std::string path = get_temporary_path("tte_file_load_same");
+    write_file(path, create_content());
+
+    tte::engine::Buffer& expected = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(expected, path.c_str()));
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    poll_until_done(load, buffer);
+    ASSERT_TRUE(tte::engine::file_load_succeeded(load));
+    tte::Length loaded_size;
+    tte::Length file_size;
+    tte::engine::get_file_load_progress(load, &loaded_size, &file_size);
+    ASSERT_EQ(loaded_size, file_size);
+    tte::engine::finish_file_load(load);
+
+    ASSERT_TRUE(to_string(buffer) == to_string(expected));
+    tte::engine::destroy_buffer(buffer);
+    tte::engine::destroy_buffer(expected);
+    remove(path.c_str());
+}
+
+TEST(file_load, editsToLoadedLinesAreKept) {
+    const std::string path = get_temporary_path("tte_file_load_edit");
+    const std::string content = create_content();
+    write_file(path, content);
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    bool done = false;
+    while (!done && tte::engine::get_buffer_length(buffer) < 3) {
+        done = tte::engine::poll_file_load(load, buffer);
+    }
+    ASSERT_TRUE(tte::engine::insert_characters(buffer, 1, 0, "edited"));
+    ASSERT_TRUE(tte::engine::delete_line(buffer, 2));
+    poll_until_done(load, buffer);
+    tte::engine::finish_file_load(load);
+
+    // the first line is empty
+    std::string expected = content + "\n";
+    expected.insert(1, "edited");
+    const tte::Length line_2 = expected.find('\n', 1) + 1;
+    expected.erase(line_2, expected.find('\n', line_2) - line_2 + 1);
+    ASSERT_TRUE(to_string(buffer) == expected);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(file_load, internedLinesShareData) {
+    const std::string path = get_temporary_path("tte_file_load_interned");
+    std::string content;
+    for (tte::Length i = 0; i < 100000; ++i) {
+        content += i % 2 == 0 ? "timestamp,level,message,source,id\n" : "----------------------------------\n";
+    }
+    write_file(path, content);
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::enable_line_interning(buffer);
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    poll_until_done(load, buffer);
+    ASSERT_TRUE(tte::engine::file_load_succeeded(load));
+    tte::engine::finish_file_load(load);
+
+    ASSERT_TRUE(to_string(buffer) == content);
+    // the lines themselves, but not their text
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), content.size());
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(file_load, compressedLinesFreeLoadedText) {
+    const std::string path = get_temporary_path("tte_file_load_compressed");
+    const std::string content = create_content();
+    write_file(path, content);
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    poll_until_done(load, buffer);
+    tte::engine::finish_file_load(load);
+    const tte::Length loaded_usage = tte::engine::get_buffer_memory_usage(buffer);
+    ASSERT_GT(loaded_usage, content.size());
+
+    ASSERT_TRUE(tte::engine::compress_lines(buffer, tte::engine::get_buffer_length(buffer), 0));
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), loaded_usage / 2);
+    ASSERT_TRUE(to_string(buffer) == content + "\n");
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(file_load, missingFileFails) {
+    const std::string path = get_temporary_path("tte_file_load_missing");
+    remove(path.c_str());
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    poll_until_done(load, buffer);
+    ASSERT_FALSE(tte::engine::file_load_succeeded(load));
+    tte::engine::finish_file_load(load);
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 0);
+    tte::engine::destroy_buffer(buffer);
+}
+
+TEST(file_load, finishBeforeDoneStopsLoading) {
+    const std::string path = get_temporary_path("tte_file_load_finish");
+    write_file(path, create_content());
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileLoad& load = tte::engine::start_file_load(path.c_str());
+    [[maybe_unused]] const bool done = tte::engine::poll_file_load(load, buffer);
+    tte::engine::finish_file_load(load);
+    ASSERT_TRUE(tte::engine::insert_line(buffer, tte::engine::get_buffer_length(buffer), "after"));
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
@@ -0,0 +1,245 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/file.hpp>
+#include <tte/engine/journal.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "test_helpers.hpp"
+
+static void write_base_file(const std::string& path, std::vector<std::string> lines) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < lines.size(); ++i) {
+        ASSERT_TRUE(tte::engine::insert_line(buffer, i, lines[i].c_str()));
+    }
+    ASSERT_TRUE(tte::engine::save_file(buffer, path.c_str()));
+    tte::engine::destroy_buffer(buffer);
+}
+
+static void set_modification_time(const std::string& path, time_t seconds, long nanoseconds) {
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = seconds;
+    times[0].tv_nsec = times[1].tv_nsec = nanoseconds;
+    ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+}
+
+[[nodiscard]] static std::string replay(const std::string& journal_path, const std::string& base_path) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    EXPECT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    EXPECT_TRUE(tte::engine::replay_journal(buffer, journal_path.c_str(), base_path.c_str()));
+    std::string result = to_string(buffer);
+    tte::engine::destroy_buffer(buffer);
+    return result;
+}
+
+static void type(tte::engine::Buffer& buffer,
+    tte::engine::Journal& journal,
+    tte::Length line_index,
+    tte::Length character_index,
+    const char* text) {
+    for (tte::Length i = 0; text[i] != '\0'; ++i) {
+        ASSERT_TRUE(tte::engine::insert_character(buffer, line_index, character_index + i, text[i]));
+        tte::engine::record_insert_characters(journal, line_index, character_index + i, &text[i], 1);
+        ASSERT_TRUE(tte::engine::commit_journal(journal));
+    }
+}
+
+static void backspace(tte::engine::Buffer& buffer,
+    tte::engine::Journal& journal,
+    tte::Length line_index,
+    tte::Length character_index,
+    tte::Length count) {
+    for (tte::Length i = 0; i < count; ++i) {
+        ASSERT_TRUE(tte::engine::delete_character(buffer, line_index, character_index - i - 1));
+        tte::engine::record_delete_characters(journal, 1, line_index, character_index - i - 1);
+        ASSERT_TRUE(tte::engine::commit_journal(journal));
+    }
+}
+
+TEST(journal, loadFileOfSavedBufferGivesSameLines) {
+    const std::string base_path = get_temporary_path("tte_journal_load_save");
+    write_base_file(base_path, {"abc", "", "def"});
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    ASSERT_EQ(to_string(buffer), "abc\n\ndef\n");
+    tte::engine::destroy_buffer(buffer);
+    remove(base_path.c_str());
+}
+
+TEST(journal, replayWithoutJournalSucceeds) {
+    const std::string base_path = get_temporary_path("tte_journal_no_journal");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+    remove(journal_path.c_str());
+    ASSERT_EQ(replay(journal_path, base_path), "abc\n");
+    remove(base_path.c_str());
+}
+
+TEST(journal, replayGivesEditedBuffer) {
+    const std::string base_path = get_temporary_path("tte_journal_replay");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"first", "second", "third"});
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+
+    type(buffer, *journal, 0, 5, " line");
+    backspace(buffer, *journal, 0, 10, 2);
+    ASSERT_TRUE(tte::engine::insert_empty_lines(buffer, 2, 1));
+    tte::engine::record_insert_empty_lines(*journal, 2, 1);
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "new"));
+    tte::engine::record_insert_line(*journal, 0, "new", 3);
+    ASSERT_TRUE(tte::engine::merge_lines(buffer, 4));
+    tte::engine::record_merge_lines(*journal, 4);
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, 1, 2));
+    tte::engine::record_delete_lines(*journal, 1, 2);
+    ASSERT_TRUE(tte::engine::delete_characters(buffer, 2, 3, 1));
+    tte::engine::record_delete_characters(*journal, 2, 3, 1);
+    const std::string expected = to_string(buffer);
+    tte::engine::close_journal(*journal);
+    tte::engine::destroy_buffer(buffer);
+
+    ASSERT_EQ(replay(journal_path, base_path), expected);
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, replayOfJournalForDifferentBaseFails) {
+    const std::string base_path = get_temporary_path("tte_journal_different_base");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+    tte::engine::record_insert_line(*journal, 0, "x", 1);
+    tte::engine::close_journal(*journal);
+
+    write_base_file(base_path, {"abcdef"});
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    ASSERT_FALSE(tte::engine::replay_journal(buffer, journal_path.c_str(), base_path.c_str()));
+    tte::engine::destroy_buffer(buffer);
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, replayOfJournalForBaseRewrittenInTheSameSecondFails) {
+    const std::string base_path = get_temporary_path("tte_journal_same_second_base");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+    set_modification_time(base_path, 1000000000, 100);
+
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+    tte::engine::record_insert_line(*journal, 0, "x", 1);
+    tte::engine::close_journal(*journal);
+
+    // same size and same second, only the nanoseconds tell the files apart
+    write_base_file(base_path, {"def"});
+    set_modification_time(base_path, 1000000000, 200);
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    ASSERT_FALSE(tte::engine::replay_journal(buffer, journal_path.c_str(), base_path.c_str()));
+    tte::engine::destroy_buffer(buffer);
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, replayIgnoresTornRecordAtEnd) {
+    const std::string base_path = get_temporary_path("tte_journal_torn");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+    tte::engine::record_insert_characters(*journal, 0, 3, "def", 3);
+    tte::engine::close_journal(*journal);
+
+    FILE* file = fopen(journal_path.c_str(), "ab");
+    ASSERT_TRUE(file);
+    fputs("torn", file);
+    fclose(file);
+
+    ASSERT_EQ(replay(journal_path, base_path), "abcdef\n");
+
+    // reopening drops the torn record and continues the journal
+    journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+    tte::engine::record_insert_characters(*journal, 0, 6, "g", 1);
+    tte::engine::close_journal(*journal);
+    ASSERT_EQ(replay(journal_path, base_path), "abcdefg\n");
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, compactionCoalescesTyping) {
+    const std::string base_path = get_temporary_path("tte_journal_compact_typing");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {""});
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 1000);
+    ASSERT_TRUE(journal);
+    type(buffer, *journal, 0, 0, "the quick brown fox jumps over the lazy dog");
+    backspace(buffer, *journal, 0, 43, 3);
+    const tte::Length size_before = tte::engine::get_journal_size(*journal);
+    ASSERT_TRUE(tte::engine::compact_journal(*journal));
+    ASSERT_LT(tte::engine::get_journal_size(*journal) * 10, size_before);
+    const std::string expected = to_string(buffer);
+    tte::engine::close_journal(*journal);
+    tte::engine::destroy_buffer(buffer);
+
+    ASSERT_EQ(replay(journal_path, base_path), expected);
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, compactionDropsTypingThatWasDeleted) {
+    const std::string base_path = get_temporary_path("tte_journal_compact_deleted");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 1000);
+    ASSERT_TRUE(journal);
+    const tte::Length empty_size = tte::engine::get_journal_size(*journal);
+    type(buffer, *journal, 0, 3, "def");
+    backspace(buffer, *journal, 0, 6, 3);
+    ASSERT_TRUE(tte::engine::compact_journal(*journal));
+    ASSERT_EQ(tte::engine::get_journal_size(*journal), empty_size);
+    tte::engine::close_journal(*journal);
+    tte::engine::destroy_buffer(buffer);
+
+    ASSERT_EQ(replay(journal_path, base_path), "abc\n");
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
+
+TEST(journal, resetAfterSaveDropsRecords) {
+    const std::string base_path = get_temporary_path("tte_journal_reset");
+    const std::string journal_path = base_path + ".journal";
+    write_base_file(base_path, {"abc"});
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, base_path.c_str()));
+    tte::engine::Journal* journal = tte::engine::open_journal(journal_path.c_str(), base_path.c_str(), 0);
+    ASSERT_TRUE(journal);
+    const tte::Length empty_size = tte::engine::get_journal_size(*journal);
+    type(buffer, *journal, 0, 3, "def");
+    ASSERT_TRUE(tte::engine::save_file(buffer, base_path.c_str()));
+    ASSERT_TRUE(tte::engine::reset_journal(*journal));
+    ASSERT_EQ(tte::engine::get_journal_size(*journal), empty_size);
+    type(buffer, *journal, 0, 6, "g");
+    tte::engine::close_journal(*journal);
+    tte::engine::destroy_buffer(buffer);
+
+    ASSERT_EQ(replay(journal_path, base_path), "abcdefg\n");
+    remove(journal_path.c_str());
+    remove(base_path.c_str());
+}
@@ -0,0 +1,169 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/snapshot.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+#include "test_helpers.hpp"
+
+[[nodiscard]] static tte::engine::Buffer& create_buffer(std::vector<std::string> lines) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < lines.size(); ++i) {
+        [[maybe_unused]] const bool result = tte::engine::insert_line(buffer, i, lines[i].c_str());
+    }
+    return buffer;
+}
+
+static void assert_buffer_state(tte::engine::Buffer& buffer, std::vector<std::string> lines) {
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), lines.size());
+    for (tte::Length i = 0; i < lines.size(); ++i) {
+        char* line_string = tte::engine::line_to_c_string(buffer, i);
+        ASSERT_EQ(line_string, lines[i]);
+        free(static_cast<void*>(line_string));
+    }
+}
+
+struct UserData {
+    tte::Length line;
+    tte::Length character;
+};
+
+TEST(snapshot, createBufferFromSnapshotGivesSameLines) {
+    const std::string path = get_temporary_path("tte_snapshot_same_lines");
+    const std::vector<std::string> lines{"first", "", "third line", ""};
+    tte::engine::Buffer& buffer = create_buffer(lines);
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+
+    tte::engine::Snapshot* snapshot = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot);
+    tte::engine::Buffer* restored = tte::engine::create_buffer_from_snapshot(*snapshot);
+    ASSERT_TRUE(restored);
+    assert_buffer_state(*restored, lines);
+    tte::engine::destroy_buffer(*restored);
+    tte::engine::close_snapshot(*snapshot);
+    remove(path.c_str());
+}
+
+TEST(snapshot, createBufferFromSnapshotOfEmptyBuffer) {
+    const std::string path = get_temporary_path("tte_snapshot_empty");
+    tte::engine::Buffer& buffer = create_buffer({});
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+
+    tte::engine::Snapshot* snapshot = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot);
+    tte::engine::Buffer* restored = tte::engine::create_buffer_from_snapshot(*snapshot);
+    ASSERT_TRUE(restored);
+    assert_buffer_state(*restored, {});
+    tte::engine::destroy_buffer(*restored);
+    tte::engine::close_snapshot(*snapshot);
+    remove(path.c_str());
+}
+
+TEST(snapshot, userDataRoundTrips) {
+    const std::string path = get_temporary_path("tte_snapshot_user_data");
+    tte::engine::Buffer& buffer = create_buffer({"abc"});
+    const UserData user_data{3, 7};
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), &user_data, sizeof(UserData)));
+    tte::engine::destroy_buffer(buffer);
+
+    tte::engine::Snapshot* snapshot = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot);
+    tte::Length size;
+    const void* restored = tte::engine::get_snapshot_user_data(*snapshot, &size);
+    ASSERT_EQ(size, sizeof(UserData));
+    ASSERT_EQ(memcmp(restored, &user_data, sizeof(UserData)), 0);
+    tte::engine::close_snapshot(*snapshot);
+    remove(path.c_str());
+}
+
+TEST(snapshot, bufferFromSnapshotCanBeEditedAndOutlivesSnapshot) {
+    const std::string path = get_temporary_path("tte_snapshot_edit");
+    tte::engine::Buffer& buffer = create_buffer({"abc", "def", "ghi", "jkl"});
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+
+    tte::engine::Snapshot* snapshot = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot);
+    tte::engine::Buffer* restored = tte::engine::create_buffer_from_snapshot(*snapshot);
+    ASSERT_TRUE(restored);
+    tte::engine::close_snapshot(*snapshot);
+
+    ASSERT_TRUE(tte::engine::insert_character(*restored, 0, 1, 'x'));
+    ASSERT_TRUE(tte::engine::delete_character(*restored, 1, 0));
+    ASSERT_TRUE(tte::engine::merge_lines(*restored, 1));
+    ASSERT_TRUE(tte::engine::delete_line(*restored, 2));
+    ASSERT_TRUE(tte::engine::insert_line(*restored, 0, "new"));
+    assert_buffer_state(*restored, {"new", "axbc", "efghi"});
+    tte::engine::destroy_buffer(*restored);
+    remove(path.c_str());
+}
+
+TEST(snapshot, snapshotOpenedTwiceGivesSameLines) {
+    const std::string path = get_temporary_path("tte_snapshot_twice");
+    const std::vector<std::string> lines{"abc", "", "def", "ghi"};
+    tte::engine::Buffer& buffer = create_buffer(lines);
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+
+    // the second mapping can not be where the first is, so its line table is relocated
+    tte::engine::Snapshot* snapshot_1 = tte::engine::open_snapshot(path.c_str());
+    tte::engine::Snapshot* snapshot_2 = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot_1);
+    ASSERT_TRUE(snapshot_2);
+    tte::engine::Buffer* restored_1 = tte::engine::create_buffer_from_snapshot(*snapshot_1);
+    tte::engine::Buffer* restored_2 = tte::engine::create_buffer_from_snapshot(*snapshot_2);
+    ASSERT_TRUE(restored_1);
+    ASSERT_TRUE(restored_2);
+    tte::engine::close_snapshot(*snapshot_1);
+    tte::engine::close_snapshot(*snapshot_2);
+    ASSERT_TRUE(tte::engine::insert_character(*restored_2, 3, 0, 'x'));
+    assert_buffer_state(*restored_1, lines);
+    assert_buffer_state(*restored_2, {"abc", "", "def", "xghi"});
+    tte::engine::destroy_buffer(*restored_1);
+    tte::engine::destroy_buffer(*restored_2);
+    remove(path.c_str());
+}
+
+TEST(snapshot, secondBufferFromSnapshotFails) {
+    const std::string path = get_temporary_path("tte_snapshot_second_buffer");
+    tte::engine::Buffer& buffer = create_buffer({"abc"});
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+
+    tte::engine::Snapshot* snapshot = tte::engine::open_snapshot(path.c_str());
+    ASSERT_TRUE(snapshot);
+    tte::engine::Buffer* restored = tte::engine::create_buffer_from_snapshot(*snapshot);
+    ASSERT_TRUE(restored);
+    ASSERT_FALSE(tte::engine::create_buffer_from_snapshot(*snapshot));
+    tte::engine::close_snapshot(*snapshot);
+    tte::engine::destroy_buffer(*restored);
+    remove(path.c_str());
+}
+
+TEST(snapshot, openSnapshotOfMissingFileFails) {
+    ASSERT_FALSE(tte::engine::open_snapshot(get_temporary_path("tte_snapshot_missing").c_str()));
+}
+
+TEST(snapshot, openSnapshotOfTruncatedFileFails) {
+    const std::string path = get_temporary_path("tte_snapshot_truncated");
+    tte::engine::Buffer& buffer = create_buffer({"abc", "def"});
+    ASSERT_TRUE(tte::engine::write_snapshot(buffer, path.c_str(), nullptr, 0));
+    tte::engine::destroy_buffer(buffer);
+    ASSERT_EQ(truncate(path.c_str(), 80), 0);
+    ASSERT_FALSE(tte::engine::open_snapshot(path.c_str()));
+    remove(path.c_str());
+}
+
+TEST(snapshot, openSnapshotOfOtherFileFails) {
+    const std::string path = get_temporary_path("tte_snapshot_other");
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(file);
+    for (int i = 0; i < 64; ++i) {
+        fputs("not a snapshot", file);
+    }
+    fclose(file);
+    ASSERT_FALSE(tte::engine::open_snapshot(path.c_str()));
+    remove(path.c_str());
+}
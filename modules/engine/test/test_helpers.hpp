@@ -0,0 +1,28 @@
+#pragma once
+
+#include <tte/engine/engine.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// helpers shared by the engine tests that work with files
+
+// a path in the test's temporary directory
+[[nodiscard]] inline std::string get_temporary_path(const char* name) { return testing::TempDir() + name; }
+
+// the lines of the buffer joined with '\n'
+[[nodiscard]] inline std::string to_string(tte::engine::Buffer& buffer) {
+    char* data = tte::engine::buffer_to_c_string(buffer);
+    std::string result(data);
+    free(static_cast<void*>(data));
+    return result;
+}
+
+// writes content to path, opened with mode, e.g. "ab" to append
+inline void write_file(const std::string& path, const std::string& content, const char* mode = "wb") {
+    FILE* file = fopen(path.c_str(), mode);
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+    ASSERT_EQ(fclose(file), 0);
+}
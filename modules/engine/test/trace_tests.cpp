@@ -0,0 +1,133 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/trace.hpp>
+#include <tte/common/event.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+#include "test_helpers.hpp"
+
+[[nodiscard]] static tte::common::Event key_down(const tte::common::KeyCode keycode) {
+    tte::common::Event result;
+    result.type = tte::common::Event::Type::KeyDown;
+    result.key.keycode = keycode;
+    result.key.repeat = 0;
+    return result;
+}
+
+TEST(trace, replayingTraceGivesSameBuffer) {
+    const std::string path = get_temporary_path("tte_trace_replay");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "hello"));
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 1, "world"));
+
+    tte::engine::TraceWriter* writer = tte::engine::open_trace_writer(path.c_str());
+    ASSERT_TRUE(writer);
+    tte::engine::trace_buffer(*writer, buffer);
+    tte::engine::trace_cursor(*writer, 0, 5);
+
+    tte::engine::trace_event(*writer, key_down(tte::common::KeyCode::Space));
+    ASSERT_TRUE(tte::engine::insert_characters(buffer, 0, 5, " \n there", 8));
+    tte::engine::trace_insert_characters(*writer, 0, 5, " \n there", 8);
+
+    tte::engine::trace_event(*writer, key_down(tte::common::KeyCode::Return));
+    ASSERT_TRUE(tte::engine::insert_empty_lines(buffer, 2, 1));
+    tte::engine::trace_insert_empty_lines(*writer, 2, 1);
+    ASSERT_TRUE(tte::engine::delete_characters(buffer, 2, 3, 1));
+    tte::engine::trace_delete_characters(*writer, 2, 3, 1);
+
+    tte::common::Event event;
+    event.type = tte::common::Event::Type::Unknown;
+    tte::engine::trace_event(*writer, event);
+    ASSERT_TRUE(tte::engine::merge_lines(buffer, 0));
+    tte::engine::trace_merge_lines(*writer, 0);
+    ASSERT_TRUE(tte::engine::delete_lines(buffer, 1, 0));
+    tte::engine::trace_delete_lines(*writer, 1, 0);
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "", 0));
+    tte::engine::trace_insert_line(*writer, 0, "", 0);
+    ASSERT_TRUE(tte::engine::close_trace_writer(*writer));
+
+    tte::engine::Trace* trace = tte::engine::load_trace(path.c_str());
+    ASSERT_TRUE(trace);
+    tte::Length number_of_records;
+    const tte::engine::TraceRecord* records = tte::engine::get_trace_records(*trace, &number_of_records);
+    ASSERT_EQ(number_of_records, 12);
+    ASSERT_EQ(records[2].type, tte::engine::TraceRecordType::Cursor);
+    ASSERT_EQ(records[2].line_index, 0);
+    ASSERT_EQ(records[2].character_index, 5);
+    ASSERT_EQ(records[3].type, tte::engine::TraceRecordType::Event);
+    ASSERT_EQ(records[3].event.type, tte::common::Event::Type::KeyDown);
+    ASSERT_EQ(records[3].event.key.keycode, tte::common::KeyCode::Space);
+    ASSERT_EQ(records[8].type, tte::engine::TraceRecordType::Event);
+    ASSERT_EQ(records[8].event.type, tte::common::Event::Type::Unknown);
+
+    tte::engine::Buffer& replayed = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < number_of_records; ++i) {
+        ASSERT_TRUE(tte::engine::apply_trace_record(replayed, records[i]));
+    }
+    ASSERT_EQ(to_string(replayed), to_string(buffer));
+
+    tte::engine::destroy_trace(*trace);
+    tte::engine::destroy_buffer(replayed);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(trace, loadHandWrittenTrace) {
+    const std::string path = get_temporary_path("tte_trace_hand_written");
+    write_file(path,
+        "tte_trace 1\n"
+        "insert_line 0 3 abc\n"
+        "cursor 0 3\n"
+        "event key_down d 1\n"
+        "insert_characters 0 3 1 d\n"
+        "event key_up d 0\n"
+        "event window_resized\n"
+        "event mouse_wheel -48\n");
+
+    tte::engine::Trace* trace = tte::engine::load_trace(path.c_str());
+    ASSERT_TRUE(trace);
+    tte::Length number_of_records;
+    const tte::engine::TraceRecord* records = tte::engine::get_trace_records(*trace, &number_of_records);
+    ASSERT_EQ(number_of_records, 7);
+    ASSERT_EQ(records[2].event.key.keycode, tte::common::KeyCode::D);
+    ASSERT_EQ(records[2].event.key.repeat, 1);
+    ASSERT_EQ(records[4].event.type, tte::common::Event::Type::KeyUp);
+    ASSERT_EQ(records[5].event.type, tte::common::Event::Type::WindowResized);
+    ASSERT_EQ(records[6].event.type, tte::common::Event::Type::MouseWheel);
+    ASSERT_EQ(records[6].event.wheel.y, -48);
+
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    for (tte::Length i = 0; i < number_of_records; ++i) {
+        ASSERT_TRUE(tte::engine::apply_trace_record(buffer, records[i]));
+    }
+    ASSERT_EQ(to_string(buffer), "abcd\n");
+
+    tte::engine::destroy_trace(*trace);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(trace, loadMalformedTraceFails) {
+    const std::string path = get_temporary_path("tte_trace_malformed");
+    const char* traces[] = {
+        "",
+        "tte_trace 2\n",
+        "tte_trace 1\nsplit_line 0\n",
+        "tte_trace 1\ninsert_line 0 10 abc\n",
+        "tte_trace 1\ninsert_line 0 3 abcd\n",
+        "tte_trace 1\ndelete_lines 1\n",
+        "tte_trace 1\nevent key_down f1 0\n",
+        "tte_trace 1\nevent key_down a 256\n",
+        "tte_trace 1\nevent mouse_wheel\n",
+        "tte_trace 1\nevent mouse_wheel -\n",
+        "tte_trace 1\nmerge_lines 0",
+    };
+    for (const char* text : traces) {
+        write_file(path, text);
+        ASSERT_FALSE(tte::engine::load_trace(path.c_str())) << text;
+    }
+
+    ASSERT_FALSE(tte::engine::load_trace(get_temporary_path("tte_trace_missing").c_str()));
+    remove(path.c_str());
+}
@@ -0,0 +1,262 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/file.hpp>
+#include <tte/engine/watch.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+#include "test_helpers.hpp"
+
+// the buffer load_file gives for path
+[[nodiscard]] static std::string load_to_string(const std::string& path) {
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    EXPECT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    std::string result = to_string(buffer);
+    tte::engine::destroy_buffer(buffer);
+    return result;
+}
+
+TEST(watch, appendedLinesAreAppended) {
+    const std::string path = get_temporary_path("tte_watch_append");
+    write_file(path, "first\nsecond");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    tte::engine::FileWatch* watch = tte::engine::watch_file(path.c_str());
+    ASSERT_TRUE(watch);
+
+    // continues the last line, which had no '\n'
+    write_file(path, " line\nthird\n", "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(to_string(buffer), "first\nsecond line\nthird\n");
+
+    write_file(path, "fourth", "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(to_string(buffer), load_to_string(path));
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 4);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, appendToEmptyFile) {
+    const std::string path = get_temporary_path("tte_watch_append_empty");
+    write_file(path, "");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    tte::engine::FileWatch* watch = tte::engine::watch_file(path.c_str());
+    ASSERT_TRUE(watch);
+
+    write_file(path, "a\nb\n", "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(to_string(buffer), load_to_string(path));
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 2);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, changedLinesAreReplaced) {
+    const std::string path = get_temporary_path("tte_watch_change");
+    write_file(path, "a\nb\nc\nd\ne\n");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    tte::engine::FileWatch* watch = tte::engine::watch_file(path.c_str());
+    ASSERT_TRUE(watch);
+
+    const char* versions[] = {
+        "a\nchanged\nd\ne\n",
+        "a\nchanged\nd\ne\nf",
+        "new\na\nchanged\nd\ne\nf",
+        "new\na\nd\ne",
+        "d\n\n\nd\ne\n",
+        "",
+        "x\ny",
+    };
+    for (const char* version : versions) {
+        write_file(path, version);
+        ASSERT_NE(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::None);
+        ASSERT_EQ(to_string(buffer), load_to_string(path));
+        ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::None);
+    }
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, fileReplacedByRename) {
+    const std::string path = get_temporary_path("tte_watch_rename");
+    const std::string new_path = get_temporary_path("tte_watch_rename_new");
+    write_file(path, "one\ntwo\nthree\n");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    tte::engine::FileWatch* watch = tte::engine::watch_file(path.c_str());
+    ASSERT_TRUE(watch);
+
+    // same size, different file
+    write_file(new_path, "one\nTWO\nthree\n");
+    ASSERT_EQ(rename(new_path.c_str(), path.c_str()), 0);
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Changed);
+    ASSERT_EQ(to_string(buffer), "one\nTWO\nthree\n");
+
+    // the new file is watched too
+    write_file(path, "four\n", "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(to_string(buffer), "one\nTWO\nthree\nfour\n");
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, unchangedFileGivesNone) {
+    const std::string path = get_temporary_path("tte_watch_unchanged");
+    write_file(path, "a\nb\n");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::load_file(buffer, path.c_str()));
+    tte::engine::FileWatch* watch = tte::engine::watch_file(path.c_str());
+    ASSERT_TRUE(watch);
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::None);
+    ASSERT_EQ(to_string(buffer), "a\nb\n");
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, missingFileGivesNullptr) {
+    const std::string path = get_temporary_path("tte_watch_missing");
+    remove(path.c_str());
+    ASSERT_FALSE(tte::engine::watch_file(path.c_str()));
+}
+
+// numbered lines of about 100 bytes
+[[nodiscard]] static std::string create_log(const tte::Length first_line, const tte::Length number_of_lines) {
+    std::string result;
+    for (tte::Length i = first_line; i < first_line + number_of_lines; ++i) {
+        result += std::to_string(i) + std::string(96, static_cast<char>('a' + i % 26)) + "\n";
+    }
+    return result;
+}
+
+TEST(watch, followReadsFileOverSeveralPolls) {
+    const std::string path = get_temporary_path("tte_watch_follow");
+    // more than one poll reads
+    const std::string content = create_log(0, 200000);
+    write_file(path, content);
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileWatch* watch = tte::engine::follow_file(path.c_str(), 0);
+    ASSERT_TRUE(watch);
+
+    tte::Length polls = 0;
+    do {
+        ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+        ++polls;
+    } while (tte::engine::is_file_watch_pending(*watch));
+    ASSERT_GT(polls, 1);
+    ASSERT_TRUE(to_string(buffer) == content);
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::None);
+
+    write_file(path, "tail", "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 200001);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, followKeepsAtMostMaxLines) {
+    const std::string path = get_temporary_path("tte_watch_follow_max_lines");
+    write_file(path, create_log(0, 400000));
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileWatch* watch = tte::engine::follow_file(path.c_str(), 1000);
+    ASSERT_TRUE(watch);
+    do {
+        ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+        ASSERT_LE(tte::engine::get_buffer_length(buffer), 1000);
+    } while (tte::engine::is_file_watch_pending(*watch));
+    ASSERT_TRUE(to_string(buffer) == create_log(399000, 1000));
+
+    write_file(path, create_log(400000, 10), "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_TRUE(to_string(buffer) == create_log(399010, 1000));
+
+    // the 40 MB read are freed except for the chunks that still have lines
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), 16 * 1024 * 1024);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, followReadsTruncatedFileAgain) {
+    const std::string path = get_temporary_path("tte_watch_follow_truncate");
+    write_file(path, "old 1\nold 2\nold 3\n");
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileWatch* watch = tte::engine::follow_file(path.c_str(), 2);
+    ASSERT_TRUE(watch);
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_EQ(to_string(buffer), "old 2\nold 3\n");
+
+    write_file(path, "new\n");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Changed);
+    ASSERT_EQ(to_string(buffer), "new\n");
+
+    write_file(path, "");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Changed);
+    ASSERT_EQ(tte::engine::get_buffer_length(buffer), 0);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, followInternedLines) {
+    const std::string path = get_temporary_path("tte_watch_follow_interned");
+    std::string content;
+    for (tte::Length i = 0; i < 100000; ++i) {
+        content += std::to_string(i % 10) + " repeated\n";
+    }
+    write_file(path, content);
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::enable_line_interning(buffer);
+    tte::engine::FileWatch* watch = tte::engine::follow_file(path.c_str(), 50000);
+    ASSERT_TRUE(watch);
+    do {
+        ASSERT_NE(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Failed);
+    } while (tte::engine::is_file_watch_pending(*watch));
+    ASSERT_TRUE(to_string(buffer) == content.substr(content.size() / 2));
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
+
+TEST(watch, followCompressedLines) {
+    const std::string path = get_temporary_path("tte_watch_follow_compressed");
+    write_file(path, create_log(0, 100000));
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    tte::engine::FileWatch* watch = tte::engine::follow_file(path.c_str(), 60000);
+    ASSERT_TRUE(watch);
+    do {
+        ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+        // the lines read are compressed as they come in, as for a log nobody looks at
+        ASSERT_TRUE(tte::engine::compress_lines(buffer, tte::engine::get_buffer_length(buffer), 0));
+    } while (tte::engine::is_file_watch_pending(*watch));
+    ASSERT_TRUE(to_string(buffer) == create_log(40000, 60000));
+
+    write_file(path, create_log(100000, 20000), "ab");
+    ASSERT_EQ(tte::engine::poll_file_watch(*watch, buffer), tte::engine::FileChange::Appended);
+    ASSERT_TRUE(to_string(buffer) == create_log(60000, 60000));
+    // 8 MB before compressing, of which the 20000 lines appended last are not compressed yet
+    tte::engine::set_decompressed_cache_budget(buffer, 0);
+    tte::engine::reclaim_buffer_memory(buffer);
+    ASSERT_LT(tte::engine::get_buffer_memory_usage(buffer), 6 * 1024 * 1024);
+
+    tte::engine::unwatch_file(*watch);
+    tte::engine::destroy_buffer(buffer);
+    remove(path.c_str());
+}
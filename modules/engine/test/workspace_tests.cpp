@@ -0,0 +1,178 @@
+#include <tte/engine/engine.hpp>
+#include <tte/engine/journal.hpp>
+#include <tte/engine/workspace.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "test_helpers.hpp"
+
+[[nodiscard]] static std::string create_lines(char character, tte::Length number_of_lines) {
+    std::string result;
+    for (tte::Length i = 0; i < number_of_lines; ++i) {
+        result += std::string(100, character) + "\n";
+    }
+    return result;
+}
+
+static void remove_document_files(const std::string& path) {
+    remove(path.c_str());
+    remove((path + ".journal").c_str());
+}
+
+TEST(workspace, getDocumentBufferLoadsFile) {
+    const std::string path = get_temporary_path("tte_workspace_load");
+    write_file(path, "abc\ndef\n");
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(1024 * 1024);
+    tte::engine::Document& document = tte::engine::open_document(workspace, path.c_str(), true);
+    ASSERT_FALSE(tte::engine::is_document_loaded(document));
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document)), "abc\ndef\n");
+    ASSERT_TRUE(tte::engine::is_document_loaded(document));
+    ASSERT_FALSE(tte::engine::get_document_journal(document));
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path);
+}
+
+TEST(workspace, getDocumentBufferOfMissingFileGivesEmptyBuffer) {
+    const std::string path = get_temporary_path("tte_workspace_missing");
+    remove_document_files(path);
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(1024 * 1024);
+    tte::engine::Document& document = tte::engine::open_document(workspace, path.c_str(), false);
+    ASSERT_EQ(tte::engine::get_buffer_length(tte::engine::get_document_buffer(workspace, document)), 0);
+    ASSERT_TRUE(tte::engine::get_document_journal(document));
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path);
+}
+
+TEST(workspace, sameFileOpenedTwiceSharesContent) {
+    const std::string path = get_temporary_path("tte_workspace_same_file");
+    const std::string content = create_lines('a', 1000);
+    write_file(path, content);
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(16 * 1024 * 1024);
+    tte::engine::Document& document_1 = tte::engine::open_document(workspace, path.c_str(), true);
+    tte::engine::Document& document_2 = tte::engine::open_document(workspace, path.c_str(), true);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_1)), content);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_2)), content);
+    ASSERT_TRUE(tte::engine::is_document_loaded(document_1));
+    ASSERT_LT(tte::engine::get_workspace_memory_usage(workspace), content.size() * 2);
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path);
+}
+
+TEST(workspace, copiesOfFileShareContent) {
+    const std::string path_1 = get_temporary_path("tte_workspace_copy_1");
+    const std::string path_2 = get_temporary_path("tte_workspace_copy_2");
+    const std::string content = create_lines('b', 1000);
+    write_file(path_1, content);
+    write_file(path_2, content);
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(16 * 1024 * 1024);
+    tte::engine::Document& document_1 = tte::engine::open_document(workspace, path_1.c_str(), true);
+    tte::engine::Document& document_2 = tte::engine::open_document(workspace, path_2.c_str(), true);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_1)), content);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_2)), content);
+    ASSERT_LT(tte::engine::get_workspace_memory_usage(workspace), content.size() * 2);
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path_1);
+    remove_document_files(path_2);
+}
+
+TEST(workspace, fileRewrittenInTheSameSecondIsReadAgain) {
+    const std::string path = get_temporary_path("tte_workspace_same_second");
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = 1000000000;
+    times[0].tv_nsec = times[1].tv_nsec = 100;
+    write_file(path, create_lines('c', 10));
+    ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(16 * 1024 * 1024);
+    tte::engine::Document& document_1 = tte::engine::open_document(workspace, path.c_str(), true);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_1)), create_lines('c', 10));
+
+    // same file, size and second, only the nanoseconds tell the contents apart
+    write_file(path, create_lines('d', 10));
+    times[0].tv_nsec = times[1].tv_nsec = 200;
+    ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+    tte::engine::Document& document_2 = tte::engine::open_document(workspace, path.c_str(), true);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_2)), create_lines('d', 10));
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path);
+}
+
+TEST(workspace, leastRecentlyUsedDocumentIsEvictedOverBudget) {
+    const std::string path_1 = get_temporary_path("tte_workspace_lru_1");
+    const std::string path_2 = get_temporary_path("tte_workspace_lru_2");
+    const std::string path_3 = get_temporary_path("tte_workspace_lru_3");
+    write_file(path_1, create_lines('a', 100));
+    write_file(path_2, create_lines('b', 100));
+    write_file(path_3, create_lines('c', 100));
+    // room for two of the documents
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(2 * (101 * 100 + 100 * 64));
+    tte::engine::Document& document_1 = tte::engine::open_document(workspace, path_1.c_str(), true);
+    tte::engine::Document& document_2 = tte::engine::open_document(workspace, path_2.c_str(), true);
+    tte::engine::Document& document_3 = tte::engine::open_document(workspace, path_3.c_str(), true);
+    [[maybe_unused]] tte::engine::Buffer& buffer_1 = tte::engine::get_document_buffer(workspace, document_1);
+    [[maybe_unused]] tte::engine::Buffer& buffer_2 = tte::engine::get_document_buffer(workspace, document_2);
+    [[maybe_unused]] tte::engine::Buffer& buffer_1_again = tte::engine::get_document_buffer(workspace, document_1);
+    [[maybe_unused]] tte::engine::Buffer& buffer_3 = tte::engine::get_document_buffer(workspace, document_3);
+    ASSERT_TRUE(tte::engine::is_document_loaded(document_1));
+    ASSERT_FALSE(tte::engine::is_document_loaded(document_2));
+    ASSERT_TRUE(tte::engine::is_document_loaded(document_3));
+    ASSERT_LE(tte::engine::get_workspace_memory_usage(workspace), 2 * (101 * 100 + 100 * 64));
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_2)), create_lines('b', 100));
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path_1);
+    remove_document_files(path_2);
+    remove_document_files(path_3);
+}
+
+TEST(workspace, evictedDocumentIsRestoredWithEditsFromJournal) {
+    const std::string path_1 = get_temporary_path("tte_workspace_evict_edit_1");
+    const std::string path_2 = get_temporary_path("tte_workspace_evict_edit_2");
+    remove_document_files(path_1);
+    remove_document_files(path_2);
+    write_file(path_1, "abc\n");
+    write_file(path_2, "def\n");
+    // room for one of the documents
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(64);
+    tte::engine::Document& document_1 = tte::engine::open_document(workspace, path_1.c_str(), false);
+    tte::engine::Document& document_2 = tte::engine::open_document(workspace, path_2.c_str(), false);
+
+    tte::engine::Buffer& buffer_1 = tte::engine::get_document_buffer(workspace, document_1);
+    ASSERT_TRUE(tte::engine::insert_characters(buffer_1, 0, 3, "xyz"));
+    tte::engine::record_insert_characters(*tte::engine::get_document_journal(document_1), 0, 3, "xyz", 3);
+
+    [[maybe_unused]] tte::engine::Buffer& buffer_2 = tte::engine::get_document_buffer(workspace, document_2);
+    ASSERT_FALSE(tte::engine::is_document_loaded(document_1));
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, document_1)), "abcxyz\n");
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path_1);
+    remove_document_files(path_2);
+}
+
+TEST(workspace, closedDocumentKeepsEditsInJournal) {
+    const std::string path = get_temporary_path("tte_workspace_close");
+    remove_document_files(path);
+    write_file(path, "abc\n");
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(1024 * 1024);
+    tte::engine::Document& document = tte::engine::open_document(workspace, path.c_str(), false);
+    tte::engine::Buffer& buffer = tte::engine::get_document_buffer(workspace, document);
+    ASSERT_TRUE(tte::engine::delete_character(buffer, 0, 0));
+    tte::engine::record_delete_characters(*tte::engine::get_document_journal(document), 1, 0, 0);
+    tte::engine::close_document(workspace, document);
+
+    tte::engine::Document& reopened = tte::engine::open_document(workspace, path.c_str(), false);
+    ASSERT_EQ(to_string(tte::engine::get_document_buffer(workspace, reopened)), "bc\n");
+    tte::engine::destroy_workspace(workspace);
+    remove_document_files(path);
+}
+
+TEST(workspace, adoptedDocumentUsesGivenBuffer) {
+    const std::string path = get_temporary_path("tte_workspace_adopt");
+    tte::engine::Workspace& workspace = tte::engine::create_workspace(1024 * 1024);
+    tte::engine::Buffer& buffer = tte::engine::create_buffer();
+    ASSERT_TRUE(tte::engine::insert_line(buffer, 0, "adopted"));
+    tte::engine::Document& document = tte::engine::adopt_document(workspace, path.c_str(), buffer, nullptr);
+    ASSERT_EQ(&tte::engine::get_document_buffer(workspace, document), &buffer);
+    tte::engine::destroy_workspace(workspace);
+}
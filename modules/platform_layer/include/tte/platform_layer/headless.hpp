@@ -0,0 +1,33 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <tte/common/event.hpp>
+#include <tte/platform_layer/platform_layer.hpp>
+
+// headless platform layer (TTE_PLATFORM=Headless, or tte_platform_layer_headless)
+// implements platform_layer.hpp without a display, so the app can be run, tested and benchmarked anywhere. windows draw
+// into an in-memory RGBA framebuffer, fonts are monospaced with glyphs drawn as filled boxes, and events come from a
+// queue the caller fills: each call to run delivers every queued event to PlatformLayer::handle_event, or a quit event
+// once the queue is empty, so an app loop ends with its script. wait_for_events does not wait.
+namespace tte { namespace platform_layer {
+    // push_event
+    // queues an event for run, events are delivered in the order they were pushed. there is one queue for the process,
+    // emptied by deinit.
+    extern void push_event(PlatformLayer*, const common::Event& event);
+    // get_queued_events
+    // the number of events run has not delivered yet
+    [[nodiscard]] extern Length get_queued_events(PlatformLayer*);
+    // get_framebuffer
+    // width * height pixels of 4 bytes (r, g, b, a), rows top to bottom
+    // valid until the window is destroyed
+    [[nodiscard]] extern const U8* get_framebuffer(Window& window, U32* width, U32* height);
+    // get_frame_count
+    // the number of show_buffer calls for the window
+    [[nodiscard]] extern Length get_frame_count(Window& window);
+    // get_drawn_rect
+    // the smallest rectangle around the pixels the last frame shown changed, all 0 if it changed none
+    extern void get_drawn_rect(Window& window, U32* x, U32* y, U32* width, U32* height);
+    // get_glyph_width
+    // the advance of every character of the font
+    [[nodiscard]] extern U32 get_glyph_width(Font& font);
+}}
@@ -6,7 +6,7 @@
 
 #define TTE_READ_BIG_ENDIAN_16(memory) (((memory)[0] << 8) | ((memory)[1] << 0))
 #define TTE_READ_BIG_ENDIAN_32(memory) (((memory)[0] << 24) | ((memory)[1] << 16) | ((memory)[2] << 8) | ((memory)[3] << 0))
-#define TTE_READ_BIG_ENDIAN_64(memory) (((memory)[0] << 56) | ((memory)[0] << 48) | ((memory)[0] << 40) | ((memory)[0] << 32) | ((memory)[0] << 24) | ((memory)[1] << 16) | ((memory)[2] << 8) | ((memory)[3] << 0))
+#define TTE_READ_BIG_ENDIAN_64(memory) ((static_cast<U64>((memory)[0]) << 56) | (static_cast<U64>((memory)[1]) << 48) | (static_cast<U64>((memory)[2]) << 40) | (static_cast<U64>((memory)[3]) << 32) | (static_cast<U64>((memory)[4]) << 24) | (static_cast<U64>((memory)[5]) << 16) | (static_cast<U64>((memory)[6]) << 8) | (static_cast<U64>((memory)[7]) << 0))
 
 namespace tte { namespace platform_layer {
     struct Window;
@@ -23,6 +23,12 @@ namespace tte { namespace platform_layer {
     };
 
     [[nodiscard]] extern U8* read_file(const char* file_name, Length* file_size);
+    // map_file
+    // the file mapped read only into file_iter, instead of read into memory as with read_file, so only the pages that
+    // are read are loaded from the file. the file must not be truncated while mapped. false if it cannot be mapped or
+    // is empty. released with unmap_file.
+    [[nodiscard]] extern bool map_file(const char* file_name, FileIter* file_iter);
+    extern void unmap_file(FileIter* file_iter);
     [[nodiscard]] extern bool has_enough_space_from_at(platform_layer::FileIter* file_iter, Length required_size);
     [[nodiscard]] extern bool has_enough_space_from_at(platform_layer::FileIter* file_iter, Length offset, Length required_size);
     [[nodiscard]] extern bool has_enough_space_from_begin(platform_layer::FileIter* file_iter, Length required_size);
@@ -70,11 +76,34 @@ namespace tte { namespace platform_layer {
     extern void render_text(PlatformLayer*, Window& window, Font& font, const char* text, S32 x, S32 y, U8 r, U8 g, U8 b);
     extern void clear_buffer(PlatformLayer*, Window& window, U8 r, U8 g, U8 b, U8 a);
     extern void show_buffer(PlatformLayer*, Window& window);
+    // show_buffer_rect
+    // show_buffer for a frame that drew only in the rectangle, the rest of the buffer is what was shown before
+    extern void show_buffer_rect(PlatformLayer*, Window& window, U32 x, U32 y, U32 width, U32 height);
+    // buffer_kept
+    // whether the buffer still has what was drawn before, so a frame can draw only what changed. false e.g. after a
+    // resize or when the renderer lost its textures, then the next frame has to be drawn whole.
+    [[nodiscard]] extern bool buffer_kept(PlatformLayer*, Window& window);
+    // scroll_buffer
+    // moves what was drawn dy pixels down, up if negative, so scrolling redraws only the rows it uncovers, which are
+    // undefined until drawn. returns false if the buffer was not kept (see buffer_kept), then it has to be drawn whole.
+    [[nodiscard]] extern bool scroll_buffer(PlatformLayer*, Window& window, S32 dy);
+    // open_font
+    // the font of the file at path, or the platform's built-in font if path is nullptr. nullptr if the file cannot be
+    // opened or there is no built-in font.
     [[nodiscard]] extern Font* open_font(PlatformLayer*, const char* path, U32 size);
     extern void close_font(PlatformLayer*, Font& font);
     [[nodiscard]] extern char get_key_code_character(common::KeyCode code);
-    [[nodiscard]] extern U32 get_cursor_x(PlatformLayer*, Font& font, const char* line, U64 cursorIndex);
-    [[nodiscard]] extern Length get_fonts(PlatformLayer*, platform_layer::Font** fonts, const U32 size);
+    // get_advances
+    // xs[i] is the x, from the start of the line, of the character at byte i of the first length bytes of line, and
+    // xs[length] the x of their end, so xs has length + 1 values. the bytes after the first of a character get the x
+    // after it, as nothing is placed inside a character.
+    extern void get_advances(PlatformLayer*, Font& font, const char* line, Length length, U32* xs);
+    // run
+    // delivers the events that came since the last call to PlatformLayer::handle_event, without waiting for more
     extern void run(PlatformLayer*);
+    // wait_for_events
+    // blocks until there are events for run or timeout_milliseconds passed, so a loop of waiting, running and drawing
+    // sleeps while idle and draws the events that came together in one frame
+    extern void wait_for_events(PlatformLayer*, U64 timeout_milliseconds);
     extern void sleep(U64 milliseconds);
 }}
@@ -431,5 +431,70 @@ namespace tte { namespace ttf {
         LastResort_UnicodeFullRepertoire,
     };
 
-    extern void parse_file(const char* file_path);
+    // FontFile
+    // a TrueType font read into memory, with what is needed to map characters to glyphs and rasterise their outlines
+    struct FontFile;
+
+    struct GlyphBitmap {
+        // width * height coverages, 0 outside the glyph to 255 inside, rows top to bottom
+        U8* coverage;
+        U32 width;
+        U32 height;
+        // from the pen position on the baseline to the top left of the bitmap, y down
+        S32 left;
+        S32 top;
+    };
+
+    [[nodiscard]] extern FontFile* open_font_file(const char* file_path);
+    extern void close_font_file(FontFile& font_file);
+    // get_glyph_id
+    // 0, the missing glyph, for characters the font has no glyph for
+    [[nodiscard]] extern U16 get_glyph_id(FontFile& font_file, U32 codepoint);
+    // rasterise_glyph
+    // the anti-aliased coverage of the glyph at pixels_per_em, from its simple or compound outline. the coverage is
+    // owned by the font file and valid until the next call, nullptr for a glyph with no outline (e.g. space). returns
+    // false if the glyph is malformed.
+    [[nodiscard]] extern bool rasterise_glyph(FontFile& font_file,
+        U16 glyph_id,
+        float pixels_per_em,
+        GlyphBitmap* result);
+    // FontInfo
+    // what a font index keeps of a font, so a font can be chosen without opening it
+    struct FontInfo {
+        // from the name table, as utf-8, cut to fit and null terminated
+        char family[64];
+        char subfamily[64];
+        U16 units_per_em;
+        U16 num_glyphs;
+        // in font units, from the baseline, y up
+        S16 ascender;
+        S16 descender;
+        S16 line_gap;
+        // around every glyph
+        S16 x_min;
+        S16 y_min;
+        S16 x_max;
+        S16 y_max;
+        bool monospaced;
+        // a bit for each character of the basic multilingual plane, set if the font has a glyph for it
+        U8 coverage[0x10000 / 8];
+    };
+
+    // FontIndex
+    // the fonts of a directory, kept in an index file by the path, size and modification time of each, so only the
+    // fonts that were added or changed since the index was written are read
+    struct FontIndex;
+
+    // load_font_index
+    // the .ttf fonts in directory_path, sorted by path, from the index file at index_path and from the fonts it does
+    // not have or has out of date, which are read. the index file is written again if the fonts changed. no fonts if
+    // the directory cannot be read.
+    [[nodiscard]] extern FontIndex& load_font_index(const char* directory_path, const char* index_path);
+    extern void destroy_font_index(FontIndex& font_index);
+    [[nodiscard]] extern Length get_font_count(FontIndex& font_index);
+    // get_font_path
+    // directory_path joined with the file name, valid until the index is destroyed
+    [[nodiscard]] extern const char* get_font_path(FontIndex& font_index, Length index);
+    [[nodiscard]] extern const FontInfo& get_font_info(FontIndex& font_index, Length index);
+    [[nodiscard]] extern bool has_glyph(const FontInfo& font_info, U32 codepoint);
 }}
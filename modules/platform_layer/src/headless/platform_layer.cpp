@@ -0,0 +1,260 @@
+#include <tte/platform_layer/platform_layer.hpp>
+#include <tte/platform_layer/headless.hpp>
+#include <tte/common/assert.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "../platform_layer_common.cpp"
+#include "../ttf_common.cpp"
+
+namespace tte { namespace platform_layer {
+    // the rows from begin_y to end_y and columns from begin_x to end_x, empty if either end is not past its begin
+    struct Rect {
+        S64 begin_x;
+        S64 begin_y;
+        S64 end_x;
+        S64 end_y;
+    };
+
+    struct Window {
+        // r, g, b, a
+        U8* buffer;
+        U32 width;
+        U32 height;
+        Length frames;
+        // around what the frame being drawn and the last frame shown drew
+        Rect drawing;
+        Rect drawn;
+    };
+
+    struct Font {
+        U32 size;
+        U32 glyph_width;
+    };
+
+    // #region internal
+    static const constexpr Length bytes_per_pixel = 4;
+    static const constexpr Length initial_event_queue_capacity = 64;
+
+    // ring buffer of the events pushed and not delivered yet, one for the process
+    struct EventQueue {
+        common::Event* events;
+        Length capacity;
+        Length begin;
+        Length size;
+    };
+
+    static EventQueue event_queue;
+
+    static void free_event_queue() {
+        free(static_cast<void*>(event_queue.events));
+        memset(static_cast<void*>(&event_queue), 0, sizeof(EventQueue));
+    }
+
+    static void add_drawn_rect(Window& window, const S64 begin_x, const S64 begin_y, const S64 end_x, const S64 end_y) {
+        Rect& drawing = window.drawing;
+        if (drawing.begin_x >= drawing.end_x || drawing.begin_y >= drawing.end_y) {
+            drawing = Rect{begin_x, begin_y, end_x, end_y};
+        } else {
+            drawing = Rect{std::min(drawing.begin_x, begin_x),
+                std::min(drawing.begin_y, begin_y),
+                std::max(drawing.end_x, end_x),
+                std::max(drawing.end_y, end_y)};
+        }
+    }
+
+    static void end_frame(Window& window) {
+        ++window.frames;
+        window.drawn = window.drawing;
+        window.drawing = Rect{};
+    }
+
+    // fills the part of the rectangle in the window
+    static void fill_clipped_rect(Window& window, S64 x, S64 y, S64 width, S64 height, U8 r, U8 g, U8 b, U8 a) {
+        const S64 begin_x = std::max<S64>(x, 0);
+        const S64 begin_y = std::max<S64>(y, 0);
+        const S64 end_x = std::min<S64>(x + width, window.width);
+        const S64 end_y = std::min<S64>(y + height, window.height);
+        if (begin_x >= end_x || begin_y >= end_y) {
+            return;
+        }
+        add_drawn_rect(window, begin_x, begin_y, end_x, end_y);
+
+        // the first row is filled, the rest are copies of it
+        const Length row_size = static_cast<Length>(end_x - begin_x) * bytes_per_pixel;
+        const Length stride = static_cast<Length>(window.width) * bytes_per_pixel;
+        U8* const first_row = window.buffer + static_cast<Length>(begin_y) * stride +
+            static_cast<Length>(begin_x) * bytes_per_pixel;
+        U8* component = first_row;
+        for (S64 x_index = begin_x; x_index < end_x; ++x_index) {
+            *component++ = r;
+            *component++ = g;
+            *component++ = b;
+            *component++ = a;
+        }
+        for (S64 y_index = begin_y + 1; y_index < end_y; ++y_index) {
+            memcpy(first_row + static_cast<Length>(y_index - begin_y) * stride, first_row, row_size);
+        }
+    }
+
+    // #endregion
+
+    // events can be pushed before init
+    bool init(PlatformLayer*) { return true; }
+
+    // drops the events that were not delivered
+    void deinit(PlatformLayer*) { free_event_queue(); }
+
+    Window* create_window(PlatformLayer*, U32 width, U32 height) {
+        Window* result = static_cast<Window*>(malloc(sizeof(Window)));
+        result->buffer = static_cast<U8*>(calloc(static_cast<Length>(width) * height, bytes_per_pixel));
+        if (!result->buffer && width != 0 && height != 0) {
+            free(static_cast<void*>(result));
+            return nullptr;
+        }
+        result->width = width;
+        result->height = height;
+        result->frames = 0;
+        result->drawing = Rect{};
+        result->drawn = Rect{};
+        return result;
+    }
+
+    void destroy_window(PlatformLayer*, Window& window) {
+        free(static_cast<void*>(window.buffer));
+        free(static_cast<void*>(&window));
+    }
+
+    void fill_rect(PlatformLayer*, Window& window, U32 x, U32 y, U32 width, U32 height, U8 r, U8 g, U8 b) {
+        fill_clipped_rect(window, x, y, width, height, r, g, b, 0xFF);
+    }
+
+    void render_text(PlatformLayer*, Window& window, Font& font, const char* text, S32 x, S32 y, U8 r, U8 g, U8 b) {
+        TTE_ASSERT(text);
+        // a box for each character that is not a space, below the top quarter of the line and a column apart
+        const S64 glyph_height = font.size - font.size / 4;
+        for (Length i = 0; text[i] != '\0'; ++i) {
+            if (text[i] != ' ') {
+                fill_clipped_rect(window,
+                    x + static_cast<S64>(i * font.glyph_width),
+                    y + static_cast<S64>(font.size / 4),
+                    font.glyph_width - 1,
+                    glyph_height,
+                    r,
+                    g,
+                    b,
+                    0xFF);
+            }
+        }
+    }
+
+    void clear_buffer(PlatformLayer*, Window& window, U8 r, U8 g, U8 b, U8 a) {
+        fill_clipped_rect(window, 0, 0, window.width, window.height, r, g, b, a);
+    }
+
+    void show_buffer(PlatformLayer*, Window& window) { end_frame(window); }
+
+    void show_buffer_rect(PlatformLayer*, Window& window, U32, U32, U32, U32) { end_frame(window); }
+
+    // nothing is kept before the first frame
+    bool buffer_kept(PlatformLayer*, Window& window) { return window.frames != 0; }
+
+    // the rows moved count as drawn
+    bool scroll_buffer(PlatformLayer*, Window& window, S32 dy) {
+        // in S64, as -dy overflows S32 for the smallest dy
+        const S64 rows = std::min<S64>(dy < 0 ? -static_cast<S64>(dy) : dy, static_cast<S64>(window.height));
+        const Length distance = static_cast<Length>(rows);
+        const Length stride = static_cast<Length>(window.width) * bytes_per_pixel;
+        const Length kept_size = (window.height - distance) * stride;
+        if (dy > 0) {
+            memmove(window.buffer + distance * stride, window.buffer, kept_size);
+        } else {
+            memmove(window.buffer, window.buffer + distance * stride, kept_size);
+        }
+        if (distance != window.height) {
+            add_drawn_rect(window, 0, 0, window.width, window.height);
+        }
+        return true;
+    }
+
+    Font* open_font(PlatformLayer*, const char* path, U32 size) {
+        // there are no font files to read, every font is the same
+        Font* result = static_cast<Font*>(malloc(sizeof(Font)));
+        result->size = size;
+        result->glyph_width = std::max<U32>(size / 2, 1);
+        return result;
+    }
+
+    void close_font(PlatformLayer*, Font& font) { free(static_cast<void*>(&font)); }
+
+    void get_advances(PlatformLayer*, Font& font, const char* line, Length length, U32* xs) {
+        TTE_ASSERT(line);
+        TTE_ASSERT(xs);
+        // every byte is a character
+        for (Length i = 0; i <= length; ++i) {
+            xs[i] = static_cast<U32>(i * font.glyph_width);
+        }
+    }
+
+    void run(PlatformLayer* platform_layer) {
+        common::Event event;
+        if (event_queue.size == 0) {
+            // the script ended
+            create_quit_event(event);
+            platform_layer->handle_event(event);
+            return;
+        }
+        while (event_queue.size != 0) {
+            event = event_queue.events[event_queue.begin];
+            event_queue.begin = (event_queue.begin + 1) % event_queue.capacity;
+            --event_queue.size;
+            platform_layer->handle_event(event);
+        }
+    }
+
+    // the events were pushed before run, none come while waiting
+    void wait_for_events(PlatformLayer*, U64) {}
+
+    void sleep(U64 milliseconds) { std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds)); }
+
+    void push_event(PlatformLayer*, const common::Event& event) {
+        if (event_queue.size == event_queue.capacity) {
+            const Length capacity = std::max(initial_event_queue_capacity, event_queue.capacity * 2);
+            common::Event* events = static_cast<common::Event*>(malloc(sizeof(common::Event) * capacity));
+            for (Length i = 0; i < event_queue.size; ++i) {
+                events[i] = event_queue.events[(event_queue.begin + i) % event_queue.capacity];
+            }
+            free(static_cast<void*>(event_queue.events));
+            event_queue.events = events;
+            event_queue.capacity = capacity;
+            event_queue.begin = 0;
+        }
+
+        event_queue.events[(event_queue.begin + event_queue.size) % event_queue.capacity] = event;
+        ++event_queue.size;
+    }
+
+    Length get_queued_events(PlatformLayer*) { return event_queue.size; }
+
+    const U8* get_framebuffer(Window& window, U32* width, U32* height) {
+        *width = window.width;
+        *height = window.height;
+        return window.buffer;
+    }
+
+    Length get_frame_count(Window& window) { return window.frames; }
+
+    void get_drawn_rect(Window& window, U32* x, U32* y, U32* width, U32* height) {
+        const Rect& drawn = window.drawn;
+        const bool empty = drawn.begin_x >= drawn.end_x || drawn.begin_y >= drawn.end_y;
+        *x = empty ? 0 : static_cast<U32>(drawn.begin_x);
+        *y = empty ? 0 : static_cast<U32>(drawn.begin_y);
+        *width = empty ? 0 : static_cast<U32>(drawn.end_x - drawn.begin_x);
+        *height = empty ? 0 : static_cast<U32>(drawn.end_y - drawn.begin_y);
+    }
+
+    U32 get_glyph_width(Font& font) { return font.glyph_width; }
+}}
@@ -3,6 +3,7 @@
 #include <tte/common/assert.hpp>
 #include <AppKit/AppKit.h>
 #include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <unistd.h>
 
@@ -218,6 +219,32 @@ namespace tte { namespace platform_layer {
         [window.ns_window.contentView setNeedsDisplay: true];
     }
 
+    void show_buffer_rect(PlatformLayer*, Window& window, U32 x, U32 y, U32 width, U32 height) {
+        // the view is not flipped, its origin is the bottom left
+        const double bottom =
+            static_cast<double>(window.buffer_height) - static_cast<double>(y) - static_cast<double>(height);
+        [window.ns_window.contentView setNeedsDisplayInRect: NSMakeRect(static_cast<double>(x),
+            bottom,
+            static_cast<double>(width),
+            static_cast<double>(height))];
+    }
+
+    bool buffer_kept(PlatformLayer*, Window&) { return true; }
+
+    bool scroll_buffer(PlatformLayer*, Window& window, S32 dy) {
+        // in S64, as -dy overflows S32 for the smallest dy
+        const S64 rows = std::min<S64>(dy < 0 ? -static_cast<S64>(dy) : dy, static_cast<S64>(window.buffer_height));
+        const Length distance = static_cast<Length>(rows);
+        const Length stride = window.buffer_width * TTE_BITMAP_BYTES_PER_PIXEL;
+        const Length kept_size = (window.buffer_height - distance) * stride;
+        if (dy > 0) {
+            memmove(window.buffer + distance * stride, window.buffer, kept_size);
+        } else {
+            memmove(window.buffer, window.buffer + distance * stride, kept_size);
+        }
+        return true;
+    }
+
     Font* open_font(PlatformLayer*, const char* path, U32 size) {
         // TODO(TB): missing implementation
         return nullptr;
@@ -227,20 +254,14 @@ namespace tte { namespace platform_layer {
         // TODO(TB): missing implementation
     }
 
-    U32 get_cursor_x(PlatformLayer*, Font& font, const char* line, U64 cursorIndex) {
-        // TODO(TB): missing implementation
-        return 0;
-    }
-
-    Length get_fonts(PlatformLayer*, platform_layer::Font** fonts, const U32 size) {
+    void get_advances(PlatformLayer*, Font& font, const char* line, Length length, U32* xs) {
         // TODO(TB): missing implementation
-        *fonts = nullptr;
-        return 0;
+        memset(xs, 0, sizeof(U32) * (length + 1));
     }
 
     void run(PlatformLayer*) {
         @autoreleasepool {
-            if (NSEvent* ns_event = [NSApp nextEventMatchingMask: NSEventMaskAny
+            while (NSEvent* ns_event = [NSApp nextEventMatchingMask: NSEventMaskAny
                 untilDate: nil
                 inMode: NSDefaultRunLoopMode
                 dequeue: true]) {
@@ -254,6 +275,16 @@ namespace tte { namespace platform_layer {
         }
     }
 
+    // leaves the event in the queue for run
+    void wait_for_events(PlatformLayer*, U64 timeout_milliseconds) {
+        @autoreleasepool {
+            [NSApp nextEventMatchingMask: NSEventMaskAny
+                untilDate: [NSDate dateWithTimeIntervalSinceNow: static_cast<double>(timeout_milliseconds) / 1000.0]
+                inMode: NSDefaultRunLoopMode
+                dequeue: false];
+        }
+    }
+
     void sleep(U64 milliseconds) {
         usleep(milliseconds * 1000);
     }
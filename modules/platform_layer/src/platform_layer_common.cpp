@@ -2,13 +2,22 @@
 #include <tte/platform_layer/platform_layer.hpp>
 #include <tte/common/assert.hpp>
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace tte { namespace platform_layer {
     [[nodiscard]] U8* read_file(const char* file_name, Length* file_size) {
         if (FILE* file = fopen(file_name, "rb")) {
             fseek(file, 0, SEEK_END);
-            *file_size = ftell(file);
+            const long size = ftell(file);
             fseek(file, 0, SEEK_SET);
+            if (size < 0) {
+                fclose(file);
+                return nullptr;
+            }
+            *file_size = static_cast<Length>(size);
 
             U8* file_content = static_cast<U8*>(malloc(*file_size + 1));
             Length read_amount = fread(file_content, *file_size, 1, file);
@@ -24,10 +33,40 @@ namespace tte { namespace platform_layer {
         return nullptr;
     }
 
+    [[nodiscard]] bool map_file(const char* file_name, FileIter* file_iter) {
+        const int file = open(file_name, O_RDONLY);
+        if (file == -1) {
+            return false;
+        }
+
+        struct stat data;
+        if (fstat(file, &data) != 0 || !S_ISREG(data.st_mode) || data.st_size <= 0) {
+            close(file);
+            return false;
+        }
+
+        const Length size = static_cast<Length>(data.st_size);
+        void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+
+        file_iter->begin = file_iter->at = static_cast<U8*>(memory);
+        file_iter->size = size;
+        return true;
+    }
+
+    void unmap_file(FileIter* file_iter) {
+        TTE_ASSERT(file_iter->begin);
+        munmap(file_iter->begin, file_iter->size);
+        file_iter->begin = file_iter->at = nullptr;
+        file_iter->size = 0;
+    }
+
     [[nodiscard]] bool has_enough_space_from_at(platform_layer::FileIter* file_iter, Length required_size) {
-        const U8* const begin_bound = file_iter->begin;
         const U8* const end_bound = file_iter->begin + file_iter->size;
-        TTE_ASSERT(begin_bound <= end_bound);
+        TTE_ASSERT(file_iter->begin <= end_bound);
         TTE_ASSERT(file_iter->at >= file_iter->begin && file_iter->at <= file_iter->begin + file_iter->size);
         const U8* const begin = file_iter->at;
         const U8* const end = file_iter->at + required_size;
@@ -45,9 +84,8 @@ namespace tte { namespace platform_layer {
     }
 
     [[nodiscard]] bool has_enough_space_from_begin(platform_layer::FileIter* file_iter, Length required_size) {
-        const U8* const begin_bound = file_iter->begin;
         const U8* const end_bound = file_iter->begin + file_iter->size;
-        TTE_ASSERT(begin_bound <= end_bound);
+        TTE_ASSERT(file_iter->begin <= end_bound);
         TTE_ASSERT(file_iter->at >= file_iter->begin && file_iter->at <= file_iter->begin + file_iter->size);
         const U8* const begin = file_iter->begin;
         const U8* const end = begin + required_size;
@@ -96,7 +134,7 @@ namespace tte { namespace platform_layer {
 
     template <>
     inline void read_big_endian(U8* const memory, S8* result) {
-        *result = memory[0];
+        *result = static_cast<S8>(memory[0]);
     }
 
     template <>
@@ -259,4 +297,9 @@ namespace tte { namespace platform_layer {
     void create_window_close_event(common::Event& e) { e.type = common::Event::Type::WindowClose; }
 
     void create_window_resized_event(common::Event& e) { e.type = common::Event::Type::WindowResized; }
+
+    void create_mouse_wheel_event(common::Event& e, S32 y) {
+        e.type = common::Event::Type::MouseWheel;
+        e.wheel.y = y;
+    }
 }}
@@ -1,8 +1,10 @@
 
 #include <tte/platform_layer/platform_layer.hpp>
 #include <tte/common/assert.hpp>
-#include <filesystem>
+#include <algorithm>
+#include <limits>
 #include <cstdlib>
+#include <cstring>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
@@ -12,32 +14,628 @@
 
 namespace tte { namespace platform_layer {
     // #region internal
-    [[nodiscard]] static KeyCode sdl_key_to_tte_key(SDL_Keycode code) {
+    [[nodiscard]] static common::KeyCode sdl_key_to_tte_key(SDL_Keycode code) {
         if (code >= SDLK_a && code <= SDLK_z) {
-            return static_cast<KeyCode>(static_cast<S32>(KeyCode::A) + (code - SDLK_a));
+            return static_cast<common::KeyCode>(static_cast<S32>(common::KeyCode::A) + (code - SDLK_a));
         } else if (code == SDLK_BACKSPACE) {
-            return KeyCode::Backspace;
+            return common::KeyCode::Backspace;
         } else if (code == SDLK_SPACE) {
-            return KeyCode::Space;
+            return common::KeyCode::Space;
         } else if (code == SDLK_RETURN) {
-            return KeyCode::Return;
+            return common::KeyCode::Return;
         } else {
-            return KeyCode::Unknown;
+            return common::KeyCode::Unknown;
         }
     }
 
+    static const constexpr S32 glyph_atlas_size = 1024;
+    static const constexpr Length min_glyph_table_capacity = 256;
+    static const constexpr Length min_text_batch_capacity = 1024;
+    static const constexpr U32 replacement_codepoint = 0xFFFD;
+    static const constexpr Length min_line_cache_capacity = 256;
+    // the texture memory of the line cache of a window
+    static const constexpr Length line_cache_budget = 64 * 1024 * 1024;
+    // longer lines are cut, no window is that wide
+    static const constexpr S32 max_line_texture_width = 4096;
+    // lines of text scrolled by a wheel notch
+    static const constexpr float wheel_notch_lines = 3.0f;
+
+    // a glyph rasterised into the atlas of a window
+    struct Glyph {
+        // 0 for an empty slot
+        U32 font_id;
+        U32 codepoint;
+        // where the glyph is in the atlas, empty for glyphs with nothing to draw (e.g. space)
+        SDL_Rect rect;
+        S32 advance;
+    };
+
+    // the glyphs of every font drawn in a window, each rasterised once into one texture, packed left to right in
+    // shelves as high as their highest glyph. when the texture is full it is emptied and filled again.
+    struct GlyphAtlas {
+        // nullptr until the first glyph
+        SDL_Texture* texture;
+        // open addressing with linear probing
+        Glyph* glyphs;
+        // a power of two
+        Length capacity;
+        Length length;
+        S32 shelf_x;
+        S32 shelf_y;
+        S32 shelf_height;
+    };
+
+    // the glyphs drawn since the last other draw call, drawn together with one SDL_RenderGeometry call
+    struct TextBatch {
+        // 4 per quad
+        SDL_Vertex* vertices;
+        // 6 per quad, the same for every batch, so they are written once
+        int* indices;
+        Length quads;
+        Length capacity;
+    };
+
+    // a line of text rendered into its own texture
+    struct LineTexture {
+        U64 hash;
+        U32 font_id;
+        // r, g, b
+        U32 colour;
+        // the text, to tell lines with the same hash apart
+        char* text;
+        Length text_length;
+        SDL_Texture* texture;
+        S32 width;
+        S32 height;
+        // least recently used last
+        LineTexture* previous;
+        LineTexture* next;
+    };
+
+    // the textures of the lines drawn recently in a window, so a line that did not change is one copy, not a glyph per
+    // character. the least recently used lines are destroyed to keep the texture memory within line_cache_budget.
+    struct LineCache {
+        // open addressing with linear probing, nullptr for an empty slot
+        LineTexture** entries;
+        // a power of two
+        Length capacity;
+        Length length;
+        LineTexture* most_recent;
+        LineTexture* least_recent;
+        // bytes of texture memory
+        Length memory_usage;
+        // the renderer cannot draw line textures premultiplied (see render_line), so lines are drawn from the atlas
+        bool unsupported;
+    };
+
     // #endregion
 
     struct Window {
         SDL_Window* window;
         SDL_Renderer* renderer;
+        GlyphAtlas atlas;
+        TextBatch batch;
+        LineCache line_cache;
+        // what was drawn, kept for scroll_buffer as the back buffer is undefined after presenting. nullptr if the
+        // renderer has no target textures, then the frame is drawn to the back buffer.
+        SDL_Texture* frame;
+        // the frame is scrolled into it, then they are swapped
+        SDL_Texture* scratch;
+        S32 frame_width;
+        S32 frame_height;
+        // render_targets_resets when the window last drew everything, what its textures had is lost if they differ
+        U64 resets;
     };
 
     struct Font {
         TTF_Font* font;
+        // the glyphs of the font in the atlases, never reused, so the glyphs of a closed font are never drawn
+        U32 id;
     };
 
-    bool init() {
+    // #region internal
+    static U32 last_font_id = 0;
+    // the number of times the renderers lost the contents of their target textures
+    static U64 render_targets_resets = 0;
+    // the height of a line of text, as the size of the last font opened, which is how far apart lines are drawn
+    static S32 wheel_line_height = 16;
+    // the part of a pixel wheel scrolling has moved but not yet sent, as precise wheel deltas come in fractions of a
+    // notch
+    static float wheel_remainder = 0.0f;
+
+    [[nodiscard]] static Length hash_glyph(const U32 font_id, const U32 codepoint) {
+        static const constexpr U64 multiplier = 0x9E3779B97F4A7C15ull;
+        const U64 result = ((static_cast<U64>(font_id) << 32) | codepoint) * multiplier;
+        return static_cast<Length>(result ^ (result >> 32));
+    }
+
+    // the slot of the glyph, or the empty slot it would go in
+    [[nodiscard]] static Glyph* find_glyph(GlyphAtlas& atlas, const U32 font_id, const U32 codepoint) {
+        Length slot = hash_glyph(font_id, codepoint) & (atlas.capacity - 1);
+        while (atlas.glyphs[slot].font_id != 0 &&
+            (atlas.glyphs[slot].font_id != font_id || atlas.glyphs[slot].codepoint != codepoint)) {
+            slot = (slot + 1) & (atlas.capacity - 1);
+        }
+        return &atlas.glyphs[slot];
+    }
+
+    static void set_glyph_capacity(GlyphAtlas& atlas, const Length capacity) {
+        Glyph* const old_glyphs = atlas.glyphs;
+        const Length old_capacity = atlas.capacity;
+        atlas.glyphs = static_cast<Glyph*>(calloc(capacity, sizeof(Glyph)));
+        atlas.capacity = capacity;
+        for (Length i = 0; i < old_capacity; ++i) {
+            if (old_glyphs[i].font_id != 0) {
+                *find_glyph(atlas, old_glyphs[i].font_id, old_glyphs[i].codepoint) = old_glyphs[i];
+            }
+        }
+        free(static_cast<void*>(old_glyphs));
+    }
+
+    static void flush_text(Window& window) {
+        if (window.batch.quads == 0) {
+            return;
+        }
+
+        if (SDL_RenderGeometry(window.renderer,
+                window.atlas.texture,
+                window.batch.vertices,
+                static_cast<int>(window.batch.quads * 4),
+                window.batch.indices,
+                static_cast<int>(window.batch.quads * 6)) != 0) {
+            TTE_DBG("Failed to render text: %s", SDL_GetError());
+        }
+        window.batch.quads = 0;
+    }
+
+    // forgets every glyph, the glyphs already batched are drawn first as their part of the texture is reused
+    static void empty_atlas(Window& window) {
+        flush_text(window);
+        memset(static_cast<void*>(window.atlas.glyphs), 0, sizeof(Glyph) * window.atlas.capacity);
+        window.atlas.length = 0;
+        window.atlas.shelf_x = 0;
+        window.atlas.shelf_y = 0;
+        window.atlas.shelf_height = 0;
+    }
+
+    // finds space for a width by height glyph, a pixel apart from the others so filtering does not blend them
+    // returns false if the atlas is full
+    [[nodiscard]] static bool pack_glyph(GlyphAtlas& atlas, const S32 width, const S32 height, SDL_Rect* rect) {
+        if (width > glyph_atlas_size || height > glyph_atlas_size) {
+            return false;
+        }
+        if (atlas.shelf_x + width > glyph_atlas_size) {
+            atlas.shelf_x = 0;
+            atlas.shelf_y += atlas.shelf_height + 1;
+            atlas.shelf_height = 0;
+        }
+        if (atlas.shelf_y + height > glyph_atlas_size) {
+            return false;
+        }
+        *rect = SDL_Rect{atlas.shelf_x, atlas.shelf_y, width, height};
+        atlas.shelf_x += width + 1;
+        atlas.shelf_height = std::max(atlas.shelf_height, height);
+        return true;
+    }
+
+    // rasterises the glyph white on transparent into the atlas, the text colour is applied when it is drawn
+    [[nodiscard]] static bool rasterise_glyph(Window& window, Font& font, const U32 codepoint, Glyph* glyph) {
+        glyph->font_id = font.id;
+        glyph->codepoint = codepoint;
+        glyph->rect = SDL_Rect{0, 0, 0, 0};
+        glyph->advance = 0;
+        S32 min_x, max_x, min_y, max_y;
+        if (TTF_GlyphMetrics32(font.font, codepoint, &min_x, &max_x, &min_y, &max_y, &glyph->advance) != 0) {
+            // drawn as nothing, like a glyph the font does not have
+            return true;
+        }
+
+        SDL_Surface* surface = TTF_RenderGlyph32_Blended(font.font, codepoint, SDL_Color{0xFF, 0xFF, 0xFF, 0xFF});
+        if (!surface) {
+            return true;
+        }
+
+        bool result = true;
+        if (surface->w != 0 && surface->h != 0) {
+            if (!pack_glyph(window.atlas, surface->w, surface->h, &glyph->rect)) {
+                result = false;
+            } else if (SDL_UpdateTexture(window.atlas.texture, &glyph->rect, surface->pixels, surface->pitch) != 0) {
+                TTE_DBG("Failed to update glyph atlas: %s", SDL_GetError());
+                glyph->rect = SDL_Rect{0, 0, 0, 0};
+            }
+        }
+        SDL_FreeSurface(surface);
+        return result;
+    }
+
+    // returns nullptr if the atlas can not be created
+    [[nodiscard]] static const Glyph* get_glyph(Window& window, Font& font, const U32 codepoint) {
+        GlyphAtlas& atlas = window.atlas;
+        if (!atlas.texture) {
+            atlas.texture = SDL_CreateTexture(window.renderer,
+                SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_STATIC,
+                glyph_atlas_size,
+                glyph_atlas_size);
+            if (!atlas.texture) {
+                TTE_DBG("Failed to create glyph atlas: %s", SDL_GetError());
+                return nullptr;
+            }
+            SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+            set_glyph_capacity(atlas, min_glyph_table_capacity);
+        }
+
+        Glyph* glyph = find_glyph(atlas, font.id, codepoint);
+        if (glyph->font_id != 0) {
+            return glyph;
+        }
+
+        // at most half full
+        if ((atlas.length + 1) * 2 > atlas.capacity) {
+            set_glyph_capacity(atlas, atlas.capacity * 2);
+            glyph = find_glyph(atlas, font.id, codepoint);
+        }
+        if (!rasterise_glyph(window, font, codepoint, glyph)) {
+            empty_atlas(window);
+            glyph = find_glyph(atlas, font.id, codepoint);
+            if (!rasterise_glyph(window, font, codepoint, glyph)) {
+                // larger than the atlas
+                glyph->rect = SDL_Rect{0, 0, 0, 0};
+            }
+        }
+        ++atlas.length;
+        return glyph;
+    }
+
+    static void batch_glyph(Window& window, const Glyph& glyph, const S32 x, const S32 y, const SDL_Color colour) {
+        TextBatch& batch = window.batch;
+        if (batch.quads == batch.capacity) {
+            const Length capacity = std::max(min_text_batch_capacity, batch.capacity * 2);
+            batch.vertices = static_cast<SDL_Vertex*>(realloc(batch.vertices, sizeof(SDL_Vertex) * 4 * capacity));
+            batch.indices = static_cast<int*>(realloc(batch.indices, sizeof(int) * 6 * capacity));
+            for (Length i = batch.capacity; i < capacity; ++i) {
+                const int first = static_cast<int>(i * 4);
+                int* indices = batch.indices + i * 6;
+                indices[0] = first;
+                indices[1] = first + 1;
+                indices[2] = first + 2;
+                indices[3] = first + 2;
+                indices[4] = first + 3;
+                indices[5] = first;
+            }
+            batch.capacity = capacity;
+        }
+
+        const float left = static_cast<float>(x);
+        const float top = static_cast<float>(y);
+        const float right = static_cast<float>(x + glyph.rect.w);
+        const float bottom = static_cast<float>(y + glyph.rect.h);
+        const float scale = 1.0f / static_cast<float>(glyph_atlas_size);
+        const float u0 = static_cast<float>(glyph.rect.x) * scale;
+        const float v0 = static_cast<float>(glyph.rect.y) * scale;
+        const float u1 = static_cast<float>(glyph.rect.x + glyph.rect.w) * scale;
+        const float v1 = static_cast<float>(glyph.rect.y + glyph.rect.h) * scale;
+        SDL_Vertex* vertices = batch.vertices + batch.quads * 4;
+        vertices[0] = SDL_Vertex{SDL_FPoint{left, top}, colour, SDL_FPoint{u0, v0}};
+        vertices[1] = SDL_Vertex{SDL_FPoint{right, top}, colour, SDL_FPoint{u1, v0}};
+        vertices[2] = SDL_Vertex{SDL_FPoint{right, bottom}, colour, SDL_FPoint{u1, v1}};
+        vertices[3] = SDL_Vertex{SDL_FPoint{left, bottom}, colour, SDL_FPoint{u0, v1}};
+        ++batch.quads;
+    }
+
+    // decodes the codepoint at *text and moves *text past it, malformed sequences are one replacement character
+    [[nodiscard]] static U32 next_codepoint(const char** text) {
+        const U8* at = reinterpret_cast<const U8*>(*text);
+        Length length;
+        U32 result;
+        if (at[0] < 0x80) {
+            length = 1;
+            result = at[0];
+        } else if ((at[0] & 0xE0) == 0xC0) {
+            length = 2;
+            result = at[0] & 0x1Fu;
+        } else if ((at[0] & 0xF0) == 0xE0) {
+            length = 3;
+            result = at[0] & 0x0Fu;
+        } else if ((at[0] & 0xF8) == 0xF0) {
+            length = 4;
+            result = at[0] & 0x07u;
+        } else {
+            ++*text;
+            return replacement_codepoint;
+        }
+        for (Length i = 1; i < length; ++i) {
+            if ((at[i] & 0xC0) != 0x80) {
+                *text += i;
+                return replacement_codepoint;
+            }
+            result = (result << 6) | (at[i] & 0x3Fu);
+        }
+        *text += length;
+        return result;
+    }
+
+    // batches the glyphs of the text from x, up to end_x
+    static void batch_text(Window& window,
+        Font& font,
+        const char* text,
+        const char* const end,
+        S32 x,
+        const S32 y,
+        const S32 end_x,
+        const SDL_Color colour) {
+        while (text < end && x < end_x) {
+            const Glyph* glyph = get_glyph(window, font, next_codepoint(&text));
+            if (!glyph) {
+                return;
+            }
+            if (glyph->rect.w != 0) {
+                batch_glyph(window, *glyph, x, y, colour);
+            }
+            x += glyph->advance;
+        }
+    }
+
+    [[nodiscard]] static U64 hash_line(const char* text, const Length length, const U32 font_id, const U32 colour) {
+        static const constexpr U64 multiplier = 0x9E3779B97F4A7C15ull;
+        U64 result = (((static_cast<U64>(font_id) << 32) | colour) ^ length) * multiplier;
+        Length i = 0;
+        for (; i + sizeof(U64) <= length; i += sizeof(U64)) {
+            U64 word;
+            memcpy(&word, text + i, sizeof(U64));
+            result = (result ^ word) * multiplier;
+            result ^= result >> 29;
+        }
+        U64 word = 0;
+        memcpy(&word, text + i, length - i);
+        result = (result ^ word) * multiplier;
+        return result ^ (result >> 32);
+    }
+
+    // the slot of the line, or the empty slot it would go in
+    [[nodiscard]] static LineTexture** find_line(LineCache& cache,
+        const U64 hash,
+        const char* text,
+        const Length text_length,
+        const U32 font_id,
+        const U32 colour) {
+        Length slot = hash & (cache.capacity - 1);
+        while (LineTexture* const line = cache.entries[slot]) {
+            if (line->hash == hash && line->font_id == font_id && line->colour == colour &&
+                line->text_length == text_length && memcmp(line->text, text, text_length) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (cache.capacity - 1);
+        }
+        return &cache.entries[slot];
+    }
+
+    static void set_line_capacity(LineCache& cache, const Length capacity) {
+        LineTexture** const entries = static_cast<LineTexture**>(calloc(capacity, sizeof(LineTexture*)));
+        for (Length i = 0; i < cache.capacity; ++i) {
+            if (LineTexture* const line = cache.entries[i]) {
+                Length slot = line->hash & (capacity - 1);
+                while (entries[slot]) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                entries[slot] = line;
+            }
+        }
+        free(static_cast<void*>(cache.entries));
+        cache.entries = entries;
+        cache.capacity = capacity;
+    }
+
+    static void unlink_line(LineCache& cache, LineTexture& line) {
+        (line.previous ? line.previous->next : cache.most_recent) = line.next;
+        (line.next ? line.next->previous : cache.least_recent) = line.previous;
+        line.previous = nullptr;
+        line.next = nullptr;
+    }
+
+    static void link_most_recent(LineCache& cache, LineTexture& line) {
+        line.previous = nullptr;
+        line.next = cache.most_recent;
+        (cache.most_recent ? cache.most_recent->previous : cache.least_recent) = &line;
+        cache.most_recent = &line;
+    }
+
+    [[nodiscard]] static Length get_texture_memory(const LineTexture& line) {
+        return static_cast<Length>(line.width) * static_cast<Length>(line.height) * 4;
+    }
+
+    static void destroy_line(LineCache& cache, LineTexture& line) {
+        cache.memory_usage -= get_texture_memory(line);
+        SDL_DestroyTexture(line.texture);
+        free(static_cast<void*>(line.text));
+        free(static_cast<void*>(&line));
+    }
+
+    // removes the line from the table, moving back the lines after it that would not be found past its empty slot
+    static void remove_line(LineCache& cache, LineTexture& line) {
+        Length slot = line.hash & (cache.capacity - 1);
+        while (cache.entries[slot] != &line) {
+            slot = (slot + 1) & (cache.capacity - 1);
+        }
+        Length next = (slot + 1) & (cache.capacity - 1);
+        while (LineTexture* const entry = cache.entries[next]) {
+            const Length home = entry->hash & (cache.capacity - 1);
+            // whether home is cyclically outside (slot, next]
+            if ((next > slot && (home <= slot || home > next)) || (next < slot && home <= slot && home > next)) {
+                cache.entries[slot] = entry;
+                slot = next;
+            }
+            next = (next + 1) & (cache.capacity - 1);
+        }
+        cache.entries[slot] = nullptr;
+        --cache.length;
+        unlink_line(cache, line);
+        destroy_line(cache, line);
+    }
+
+    static void empty_line_cache(LineCache& cache) {
+        while (cache.least_recent) {
+            remove_line(cache, *cache.least_recent);
+        }
+    }
+
+    // colour + background * (1 - alpha), for textures whose colour is already multiplied by their alpha
+    [[nodiscard]] static SDL_BlendMode get_premultiplied_blend_mode() {
+        static const SDL_BlendMode result = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD);
+        return result;
+    }
+
+    // renders the text into a new texture, glyph by glyph from the atlas
+    // returns false if the texture can not be created
+    [[nodiscard]] static bool render_line(Window& window, Font& font, LineTexture& line, const SDL_Color colour) {
+        S32 width = 0;
+        const char* at = line.text;
+        const char* const end = line.text + line.text_length;
+        while (at < end) {
+            const Glyph* glyph = get_glyph(window, font, next_codepoint(&at));
+            if (!glyph) {
+                return false;
+            }
+            width += glyph->advance;
+        }
+        line.width = std::min(std::max(width, 1), max_line_texture_width);
+        line.height = std::max(TTF_FontHeight(font.font), 1);
+        line.texture = SDL_CreateTexture(window.renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_TARGET,
+            line.width,
+            line.height);
+        if (!line.texture) {
+            TTE_DBG("Failed to create line texture: %s", SDL_GetError());
+            return false;
+        }
+        // blending the glyphs into the transparent texture multiplies their colour by their coverage, blending the
+        // texture again would multiply the edges by it twice
+        if (SDL_SetTextureBlendMode(line.texture, get_premultiplied_blend_mode()) != 0) {
+            TTE_DBG("Failed to set line texture blend mode: %s", SDL_GetError());
+            SDL_DestroyTexture(line.texture);
+            line.texture = nullptr;
+            window.line_cache.unsupported = true;
+            return false;
+        }
+
+        flush_text(window);
+        SDL_SetRenderTarget(window.renderer, line.texture);
+        SDL_SetRenderDrawColor(window.renderer, 0, 0, 0, 0);
+        SDL_RenderClear(window.renderer);
+        // the glyphs are in the atlas already, unless it was emptied by a glyph of this line
+        batch_text(window, font, line.text, end, 0, 0, line.width, colour);
+        flush_text(window);
+        SDL_SetRenderTarget(window.renderer, window.frame);
+        return true;
+    }
+
+    // returns nullptr if the line can not be rendered
+    [[nodiscard]] static LineTexture* get_line_texture(Window& window, Font& font, const char* text, const SDL_Color colour) {
+        LineCache& cache = window.line_cache;
+        if (cache.unsupported) {
+            return nullptr;
+        }
+        if (!cache.entries) {
+            set_line_capacity(cache, min_line_cache_capacity);
+        }
+
+        const Length text_length = strlen(text);
+        const U32 packed_colour = (static_cast<U32>(colour.r) << 16) | (static_cast<U32>(colour.g) << 8) | colour.b;
+        const U64 hash = hash_line(text, text_length, font.id, packed_colour);
+        LineTexture** slot = find_line(cache, hash, text, text_length, font.id, packed_colour);
+        if (LineTexture* const line = *slot) {
+            unlink_line(cache, *line);
+            link_most_recent(cache, *line);
+            return line;
+        }
+
+        LineTexture* line = static_cast<LineTexture*>(malloc(sizeof(LineTexture)));
+        memset(static_cast<void*>(line), 0, sizeof(LineTexture));
+        line->hash = hash;
+        line->font_id = font.id;
+        line->colour = packed_colour;
+        line->text = static_cast<char*>(malloc(text_length + 1));
+        memcpy(line->text, text, text_length + 1);
+        line->text_length = text_length;
+        if (!render_line(window, font, *line, colour)) {
+            free(static_cast<void*>(line->text));
+            free(static_cast<void*>(line));
+            return nullptr;
+        }
+
+        cache.memory_usage += get_texture_memory(*line);
+        while (cache.least_recent && cache.memory_usage > line_cache_budget) {
+            remove_line(cache, *cache.least_recent);
+        }
+        // at most half full
+        if ((cache.length + 1) * 2 > cache.capacity) {
+            set_line_capacity(cache, cache.capacity * 2);
+        }
+        *find_line(cache, hash, text, text_length, font.id, packed_colour) = line;
+        ++cache.length;
+        link_most_recent(cache, *line);
+        return line;
+    }
+
+    static void destroy_frame(Window& window) {
+        if (window.frame) {
+            SDL_DestroyTexture(window.frame);
+            SDL_DestroyTexture(window.scratch);
+        }
+        window.frame = nullptr;
+        window.scratch = nullptr;
+    }
+
+    // makes the frame the size of the window, unless the renderer can not render to textures
+    static void update_frame(Window& window) {
+        S32 width;
+        S32 height;
+        if (SDL_GetRendererOutputSize(window.renderer, &width, &height) != 0) {
+            width = 0;
+            height = 0;
+        }
+        if (window.frame && width == window.frame_width && height == window.frame_height) {
+            return;
+        }
+
+        SDL_SetRenderTarget(window.renderer, nullptr);
+        destroy_frame(window);
+        if (width <= 0 || height <= 0) {
+            return;
+        }
+        window.frame =
+            SDL_CreateTexture(window.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        window.scratch =
+            SDL_CreateTexture(window.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!window.frame || !window.scratch) {
+            TTE_DBG("Failed to create frame texture: %s", SDL_GetError());
+            if (window.frame) {
+                SDL_DestroyTexture(window.frame);
+            }
+            if (window.scratch) {
+                SDL_DestroyTexture(window.scratch);
+            }
+            window.frame = nullptr;
+            window.scratch = nullptr;
+            return;
+        }
+        // copied as they are, not blended with what they are copied onto
+        SDL_SetTextureBlendMode(window.frame, SDL_BLENDMODE_NONE);
+        SDL_SetTextureBlendMode(window.scratch, SDL_BLENDMODE_NONE);
+        window.frame_width = width;
+        window.frame_height = height;
+        SDL_SetRenderTarget(window.renderer, window.frame);
+    }
+
+    // #endregion
+
+    bool init(PlatformLayer*) {
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
             TTE_DBG("Failed to init SDL: %s", SDL_GetError());
             return false;
@@ -64,14 +662,15 @@ namespace tte { namespace platform_layer {
         return true;
     }
 
-    void deinit() {
+    void deinit(PlatformLayer*) {
         TTF_Quit();
         IMG_Quit();
         SDL_Quit();
     }
 
-    Window* create_window(U32 width, U32 height) {
+    Window* create_window(PlatformLayer*, U32 width, U32 height) {
         Window* result = static_cast<Window*>(malloc(sizeof(Window)));
+        memset(static_cast<void*>(result), 0, sizeof(Window));
         result->window = SDL_CreateWindow("TTE",
             SDL_WINDOWPOS_UNDEFINED,
             SDL_WINDOWPOS_UNDEFINED,
@@ -95,68 +694,113 @@ namespace tte { namespace platform_layer {
         return result;
     }
 
-    void destroy_window(Window& window) {
+    void destroy_window(PlatformLayer*, Window& window) {
+        destroy_frame(window);
+        empty_line_cache(window.line_cache);
+        free(static_cast<void*>(window.line_cache.entries));
+        if (window.atlas.texture) {
+            SDL_DestroyTexture(window.atlas.texture);
+        }
+        free(static_cast<void*>(window.atlas.glyphs));
+        free(static_cast<void*>(window.batch.vertices));
+        free(static_cast<void*>(window.batch.indices));
         SDL_DestroyRenderer(window.renderer);
         SDL_DestroyWindow(window.window);
         free(&window);
     }
 
-    void fill_rect(Window& window, U32 x, U32 y, U32 width, U32 height, U8 r, U8 g, U8 b) {
+    void fill_rect(PlatformLayer*, Window& window, U32 x, U32 y, U32 width, U32 height, U8 r, U8 g, U8 b) {
+        // drawn over the text before it
+        flush_text(window);
         SDL_Rect rect{static_cast<int>(x), static_cast<int>(y), static_cast<int>(width), static_cast<int>(height)};
         SDL_SetRenderDrawColor(window.renderer, r, g, b, 0xFF);
         SDL_RenderFillRect(window.renderer, &rect);
     }
 
-    bool poll_events(Event& e) {
-        SDL_Event sdl_e;
-        while (SDL_PollEvent(&sdl_e)) {
-            if (sdl_e.type == SDL_QUIT) {
-                create_quit_event(e);
-                return true;
-            } else if (sdl_e.type == SDL_WINDOWEVENT) {
-                if (sdl_e.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    create_window_resized_event(e);
-                    return true;
-                }
-            } else if (sdl_e.type == SDL_KEYDOWN) {
-                create_key_down_event(e, sdl_key_to_tte_key(sdl_e.key.keysym.sym), sdl_e.key.repeat);
-                return true;
+    void clear_buffer(PlatformLayer*, Window& window, U8 r, U8 g, U8 b, U8 a) {
+        // the text batched so far would be cleared
+        window.batch.quads = 0;
+        if (window.resets != render_targets_resets) {
+            empty_line_cache(window.line_cache);
+            if (window.atlas.glyphs) {
+                empty_atlas(window);
             }
+            window.resets = render_targets_resets;
         }
-        return false;
-    }
-
-    void clear_buffer(Window& window, U8 r, U8 g, U8 b, U8 a) {
+        update_frame(window);
         SDL_SetRenderDrawColor(window.renderer, r, g, b, a);
         SDL_RenderClear(window.renderer);
     }
 
-    void show_buffer(Window& window) { SDL_RenderPresent(window.renderer); }
+    void show_buffer(PlatformLayer*, Window& window) {
+        flush_text(window);
+        if (window.frame) {
+            SDL_SetRenderTarget(window.renderer, nullptr);
+            SDL_RenderCopy(window.renderer, window.frame, nullptr, nullptr);
+            SDL_RenderPresent(window.renderer);
+            SDL_SetRenderTarget(window.renderer, window.frame);
+        } else {
+            SDL_RenderPresent(window.renderer);
+        }
+    }
+
+    // the back buffer is undefined after presenting, so the whole frame is copied to it
+    void show_buffer_rect(PlatformLayer* platform_layer, Window& window, U32, U32, U32, U32) {
+        show_buffer(platform_layer, window);
+    }
+
+    bool buffer_kept(PlatformLayer*, Window& window) {
+        S32 width;
+        S32 height;
+        return window.frame && window.resets == render_targets_resets &&
+            SDL_GetRendererOutputSize(window.renderer, &width, &height) == 0 && width == window.frame_width &&
+            height == window.frame_height;
+    }
+
+    // the frame is copied, moved, into the scratch texture, as a texture can not be copied onto itself
+    bool scroll_buffer(PlatformLayer* platform_layer, Window& window, S32 dy) {
+        if (!buffer_kept(platform_layer, window)) {
+            return false;
+        }
+
+        flush_text(window);
+        const S32 distance = std::min(dy < 0 ? -dy : dy, window.frame_height);
+        const S32 kept_height = window.frame_height - distance;
+        SDL_SetRenderTarget(window.renderer, window.scratch);
+        if (kept_height != 0) {
+            const SDL_Rect source{0, dy < 0 ? distance : 0, window.frame_width, kept_height};
+            const SDL_Rect destination{0, dy < 0 ? 0 : distance, window.frame_width, kept_height};
+            SDL_RenderCopy(window.renderer, window.frame, &source, &destination);
+        }
+        std::swap(window.frame, window.scratch);
+        SDL_SetRenderTarget(window.renderer, window.frame);
+        return true;
+    }
 
-    void render_text(Window& window, Font& font, const char* text, S32 x, S32 y, U8 r, U8 g, U8 b) {
+    // the glyphs are batched, the text is drawn by the next other draw call (see TextBatch)
+    void render_text(PlatformLayer*, Window& window, Font& font, const char* text, S32 x, S32 y, U8 r, U8 g, U8 b) {
         TTE_ASSERT(text);
-        SDL_Color colour{r, g, b, 0xFF};
-        SDL_Surface* textSurface = TTF_RenderUTF8_Solid(font.font, text, colour);
-        if (!textSurface) {
-            TTE_DBG("Failed to render text surface: %s", TTF_GetError());
+        if (*text == '\0') {
             return;
         }
-
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(window.renderer, textSurface);
-        if (!texture) {
-            TTE_DBG("Failed to create texture from text surface: %s", SDL_GetError());
-            SDL_FreeSurface(textSurface);
+        // lines that did not change since they were last drawn are copied from their texture
+        const SDL_Color colour{r, g, b, 0xFF};
+        const LineTexture* line = get_line_texture(window, font, text, colour);
+        if (!line) {
+            // e.g. the renderer has no target textures or custom blend modes
+            batch_text(window, font, text, text + strlen(text), x, y, std::numeric_limits<S32>::max(), colour);
             return;
         }
-
-        SDL_Rect renderQuad = {x, y, textSurface->w, textSurface->h};
-        SDL_RenderCopyEx(window.renderer, texture, nullptr, &renderQuad, 0, nullptr, SDL_FLIP_NONE);
-        SDL_DestroyTexture(texture);
-        SDL_FreeSurface(textSurface);
+        flush_text(window);
+        const SDL_Rect rect{x, y, line->width, line->height};
+        SDL_RenderCopy(window.renderer, line->texture, nullptr, &rect);
     }
 
-    Font* open_font(const char* path, U32 size) {
-        TTE_ASSERT(path);
+    // there is no built-in font
+    Font* open_font(PlatformLayer*, const char* path, U32 size) {
+        if (!path) {
+            return nullptr;
+        }
         TTF_Font* font = TTF_OpenFont(path, static_cast<S32>(size));
         if (!font) {
             TTE_DBG("Failed to load font: %s", TTF_GetError());
@@ -165,71 +809,78 @@ namespace tte { namespace platform_layer {
 
         Font* result = static_cast<Font*>(malloc(sizeof(Font)));
         result->font = font;
+        result->id = ++last_font_id;
+        wheel_line_height = std::max(static_cast<S32>(size), 1);
         return result;
     }
 
-    void close_font(Font& font) {
+    void close_font(PlatformLayer*, Font& font) {
         TTF_CloseFont(font.font);
         free(&font);
     }
 
-    U32 get_cursor_x(Font& font, const char* line, Length cursorIndex) {
+    // the advances of the glyphs, as render_text places them
+    void get_advances(PlatformLayer*, Font& font, const char* line, Length length, U32* xs) {
         TTE_ASSERT(line);
-        S32 w, h;
-        if (cursorIndex < strlen(line)) {
-            char* substring = static_cast<char*>(malloc(sizeof(char) * cursorIndex + 1));
-            memcpy(substring, line, cursorIndex);
-            substring[cursorIndex] = '\0';
-            const bool success = TTF_SizeUTF8(font.font, substring, &w, &h) == 0;
-            free(substring);
-            if (!success) {
-                TTE_ASSERT(false);
-                return 0;
-            }
-        }
-
-        if (TTF_SizeUTF8(font.font, line, &w, &h) == -1) {
-            TTE_ASSERT(false);
-            return 0;
-        }
-
-        TTE_ASSERT(w >= 0);
-        TTE_ASSERT(h >= 0);
-        return static_cast<U32>(w);
-    }
-
-    Length get_fonts(platform_layer::Font** fonts, const U32 font_size) {
-        const std::filesystem::path fonts_directory_path(
-            std::filesystem::relative(std::filesystem::path("resources/fonts")));
-        if (std::filesystem::directory_entry(fonts_directory_path).is_directory()) {
-            Length size = 0;
-            Length capacity = 5;
-            *fonts = static_cast<Font*>(malloc(sizeof(Font) * capacity));
-            for (const auto& x : std::filesystem::directory_iterator(fonts_directory_path)) {
-                if (x.is_regular_file() && x.path().extension() == ".ttf") {
-                    if (Font* font = open_font(std::filesystem::absolute(x.path()).c_str(), font_size)) {
-                        if (size == capacity) {
-                            const Length old_capacity = capacity;
-                            capacity *= 2;
-                            Font* new_fonts = static_cast<Font*>(malloc(sizeof(Font) * capacity));
-                            memcpy(new_fonts, *fonts, old_capacity);
-                            free(*fonts);
-                            *fonts = new_fonts;
-                        }
-
-                        (*fonts)[size] = *font;
-                        ++size;
-                    }
-                }
+        TTE_ASSERT(xs);
+        const char* at = line;
+        U32 x = 0;
+        xs[0] = 0;
+        while (static_cast<Length>(at - line) < length) {
+            const char* const character = at;
+            S32 min_x, max_x, min_y, max_y, advance;
+            if (TTF_GlyphMetrics32(font.font, next_codepoint(&at), &min_x, &max_x, &min_y, &max_y, &advance) == 0) {
+                x += static_cast<U32>(std::max(advance, 0));
             }
-            if (size == 0) {
-                free(*fonts);
-                *fonts = nullptr;
+            // a character cut by the end of the line ends with it
+            const Length end = std::min(static_cast<Length>(at - line), length);
+            for (Length i = static_cast<Length>(character - line) + 1; i <= end; ++i) {
+                xs[i] = x;
             }
-            return size;
+            at = line + end;
         }
+    }
 
-        *fonts = nullptr;
-        return 0;
+    void run(PlatformLayer* platform_layer) {
+        SDL_Event sdl_e;
+        while (SDL_PollEvent(&sdl_e)) {
+            common::Event e;
+            if (sdl_e.type == SDL_QUIT) {
+                create_quit_event(e);
+            } else if (sdl_e.type == SDL_WINDOWEVENT && sdl_e.window.event == SDL_WINDOWEVENT_RESIZED) {
+                create_window_resized_event(e);
+            } else if (sdl_e.type == SDL_RENDER_TARGETS_RESET || sdl_e.type == SDL_RENDER_DEVICE_RESET) {
+                // the textures lost their contents and are rendered again when the window is drawn whole, as after a
+                // resize
+                ++render_targets_resets;
+                create_window_resized_event(e);
+            } else if (sdl_e.type == SDL_MOUSEWHEEL) {
+                // wheel y is positive away from the user, which scrolls towards the start. precise y has the
+                // fractions of a notch a trackpad or smooth wheel moves.
+                const float notches =
+                    sdl_e.wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? sdl_e.wheel.preciseY : -sdl_e.wheel.preciseY;
+                const float pixels =
+                    wheel_remainder + notches * wheel_notch_lines * static_cast<float>(wheel_line_height);
+                const S32 y = static_cast<S32>(pixels);
+                wheel_remainder = pixels - static_cast<float>(y);
+                if (y == 0) {
+                    continue;
+                }
+                create_mouse_wheel_event(e, y);
+            } else if (sdl_e.type == SDL_KEYDOWN) {
+                create_key_down_event(e, sdl_key_to_tte_key(sdl_e.key.keysym.sym), sdl_e.key.repeat);
+            } else {
+                continue;
+            }
+            platform_layer->handle_event(e);
+        }
     }
+
+    // leaves the event in the queue for run
+    void wait_for_events(PlatformLayer*, U64 timeout_milliseconds) {
+        const U64 max_timeout = static_cast<U64>(std::numeric_limits<int>::max());
+        SDL_WaitEventTimeout(nullptr, static_cast<int>(std::min(timeout_milliseconds, max_timeout)));
+    }
+
+    void sleep(U64 milliseconds) { SDL_Delay(static_cast<U32>(milliseconds)); }
 }}
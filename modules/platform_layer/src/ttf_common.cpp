@@ -4,8 +4,20 @@
 #include "../include/tte/platform_layer/platform_layer.hpp"
 #include "../include/tte/platform_layer/ttf.hpp"
 #include <tte/common/assert.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTE_TTF_SSE2 1
+#include <emmintrin.h>
+#else
+#define TTE_TTF_SSE2 0
+#endif
 
 namespace tte { namespace ttf {
     namespace required_tables_bitset {
@@ -222,7 +234,6 @@ namespace tte { namespace ttf {
 
         platform_layer::read_big_endian_and_move_unchecked(file_iter, &name_table->count);
         platform_layer::read_big_endian_and_move_unchecked(file_iter, &name_table->string_offset);
-        const Length string_offset_full = table_directory->offset + name_table->string_offset;
         if (!platform_layer::has_enough_space_from_begin(file_iter, table_directory->offset + name_table->string_offset)) {
             return false;
         }
@@ -410,7 +421,7 @@ namespace tte { namespace ttf {
 
                 platform_layer::read_big_endian_and_move_unchecked(file_iter, &subtable->language_code);
                 if (static_cast<NameRecord_And_CMAPEncodingSubtable_PlatformId>(cmap_table->encoding_subtable_array[i].platform_id) == NameRecord_And_CMAPEncodingSubtable_PlatformId::Macintosh) {
-                    if (subtable->language_code < 0 || subtable->language_code > 33) {
+                    if (subtable->language_code > 33) {
                         return false;
                     }
                 } else if (subtable->language_code != 0) {
@@ -461,15 +472,15 @@ namespace tte { namespace ttf {
                 }
 
                 
-                const Length remaining_bytes = subtable->size - (file_iter->at - cmap_subtable_begin);
+                const Length remaining_bytes = subtable->size - static_cast<Length>(file_iter->at - cmap_subtable_begin);
                 if (remaining_bytes % sizeof(U16) != 0) {
                     return false;
                 }
 
                 subtable->glyph_index_array = static_cast<U16*>(malloc(remaining_bytes));
                 subtable->glyph_index_array_length = remaining_bytes / 2;
-                for (Length i = 0; i < subtable->glyph_index_array_length; ++i) {
-                    platform_layer::read_big_endian_and_move_unchecked(file_iter, &subtable->glyph_index_array[i]);
+                for (Length j = 0; j < subtable->glyph_index_array_length; ++j) {
+                    platform_layer::read_big_endian_and_move_unchecked(file_iter, &subtable->glyph_index_array[j]);
                 }
             } else {
                 cmap_table->encoding_subtable_array[i].subtable = static_cast<CMAPSubtable*>(malloc(sizeof(CMAPSubtable)));
@@ -483,15 +494,42 @@ namespace tte { namespace ttf {
         return true;
     }
 
+    // the unicode basic multilingual plane subtable, of the unicode platform or else of the microsoft platform
     [[nodiscard]] CMAPSubtableFormat4* get_format_4_table(CMAPTable* cmap_table) {
+        CMAPSubtableFormat4* result = nullptr;
         for (Length i = 0; i < cmap_table->number_encoding_subtables; ++i) {
-            if (cmap_table->encoding_subtable_array[i].platform_id == 0 &&
-                cmap_table->encoding_subtable_array[i].platform_specific_id == 3 &&
-                cmap_table->encoding_subtable_array[i].subtable->format == 4) {
-                    return static_cast<CMAPSubtableFormat4*>(cmap_table->encoding_subtable_array[i].subtable);
+            const CMAPEncodingSubtable& encoding_subtable = cmap_table->encoding_subtable_array[i];
+            if (encoding_subtable.subtable->format != 4) {
+                continue;
+            }
+            if (encoding_subtable.platform_id == 0 && encoding_subtable.platform_specific_id == 3) {
+                return static_cast<CMAPSubtableFormat4*>(encoding_subtable.subtable);
+            }
+            if (!result && encoding_subtable.platform_id == 3 && encoding_subtable.platform_specific_id == 1) {
+                result = static_cast<CMAPSubtableFormat4*>(encoding_subtable.subtable);
             }
         }
-        return nullptr;
+        return result;
+    }
+
+    // the glyph of a character code from start_code_array[i] to end_code_array[i]
+    [[nodiscard]] static U16 get_segment_glyph_id(CMAPSubtableFormat4* subtable,
+        const Length i,
+        const U16 character_code) {
+        const Length seg_count = subtable->seg_count_times_2 / 2;
+        TTE_ASSERT(i < seg_count);
+        TTE_ASSERT(subtable->start_code_array[i] <= character_code && character_code <= subtable->end_code_array[i]);
+        if (subtable->id_range_offset_array[i] == 0) {
+            return subtable->id_delta_array[i] + character_code;
+        }
+
+        const Length glyph_id_array_index = ((subtable->id_range_offset_array[i] / 2) + static_cast<Length>(character_code - subtable->start_code_array[i])) - (seg_count - i);
+        if (glyph_id_array_index >= subtable->glyph_index_array_length ||
+            subtable->glyph_index_array[glyph_id_array_index] == 0) {
+            return 0;
+        }
+
+        return subtable->glyph_index_array[glyph_id_array_index] + subtable->id_delta_array[i];
     }
 
     [[nodiscard]] U16 character_code_to_glyph_id(U16 character_code, CMAPTable* cmap_table) {
@@ -503,8 +541,6 @@ namespace tte { namespace ttf {
 
         const Length seg_count = subtable->seg_count_times_2 / 2;
 
-        bool failed = false;
-
         // find first end_code >= character_code
         Length i = 0;
         while (i < seg_count) {
@@ -528,17 +564,7 @@ namespace tte { namespace ttf {
             return 0;
         }
 
-        if (subtable->id_range_offset_array[i] == 0) {
-            return subtable->id_delta_array[i] + character_code;
-        }
-
-        TTE_ASSERT(subtable->start_code_array[i] < character_code);
-        const Length glyph_id_array_index = ((subtable->id_range_offset_array[i] / 2) + (character_code - subtable->start_code_array[i])) - (seg_count - i);
-        if (subtable->glyph_index_array[glyph_id_array_index] == 0) {
-            return 0;
-        }
-
-        return subtable->glyph_index_array[glyph_id_array_index] + subtable->id_delta_array[i];
+        return get_segment_glyph_id(subtable, i, character_code);
     }
 
     struct Fixed {
@@ -719,6 +745,70 @@ namespace tte { namespace ttf {
         return true;
     }
 
+    struct HHEATable {
+        U16 major_version;
+        U16 minor_version;
+        // from the baseline, y up
+        FWord ascender;
+        FWord descender;
+        FWord line_gap;
+        UFWord advance_width_max;
+        // the rest of the table is not read
+    };
+
+    static const constexpr Length hhea_table_size = sizeof(U16) * 2 + sizeof(FWord) * 3 + sizeof(UFWord);
+
+    [[nodiscard]] static bool read_hhea_table(platform_layer::FileIter* file_iter,
+        FontDirectory* font_directory,
+        HHEATable* hhea_table) {
+        TableDirectory* table_directory = find_first_table_directory_with_tag(font_directory, TableDirectory_Tag::HHEA);
+        if (!table_directory) {
+            return false;
+        }
+
+        if (table_directory->size < hhea_table_size) {
+            return false;
+        }
+
+        // table directories have already been validated that they are pointing to something in bounds
+        TTE_ASSERT(platform_layer::has_enough_space_from_begin(file_iter, table_directory->offset, table_directory->size));
+
+        file_iter->at = file_iter->begin + table_directory->offset;
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->major_version);
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->minor_version);
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->ascender);
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->descender);
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->line_gap);
+        read_big_endian_and_move_unchecked(file_iter, &hhea_table->advance_width_max);
+
+        return true;
+    }
+
+    // is_fixed_pitch of the post table, the rest of it is not read
+    static const constexpr Length post_table_is_fixed_pitch_offset = sizeof(Fixed) * 2 + sizeof(FWord) * 2;
+
+    [[nodiscard]] static bool read_is_fixed_pitch(platform_layer::FileIter* file_iter,
+        FontDirectory* font_directory,
+        bool* result) {
+        TableDirectory* table_directory = find_first_table_directory_with_tag(font_directory, TableDirectory_Tag::POST);
+        if (!table_directory) {
+            return false;
+        }
+
+        if (table_directory->size < post_table_is_fixed_pitch_offset + sizeof(U32)) {
+            return false;
+        }
+
+        // table directories have already been validated that they are pointing to something in bounds
+        TTE_ASSERT(platform_layer::has_enough_space_from_begin(file_iter, table_directory->offset, table_directory->size));
+
+        file_iter->at = file_iter->begin + table_directory->offset + post_table_is_fixed_pitch_offset;
+        U32 is_fixed_pitch;
+        read_big_endian_and_move_unchecked(file_iter, &is_fixed_pitch);
+        *result = is_fixed_pitch != 0;
+        return true;
+    }
+
     struct LOCATable {
         U32* offsets;
         U16 length;
@@ -744,13 +834,14 @@ namespace tte { namespace ttf {
         // TODO(TB): should we look for the extra last glyph in the loop and use that as the number of glyphs instead? incase there is less
         loca_table->length = num_glyphs;
         if (offset_size == OffsetSize::Short16) {
-            for (Length i = 0; i < num_glyphs + 1; ++i) {
-                read_big_endian_and_move_unchecked(file_iter, (U16*)&(loca_table->offsets[i]));
-                loca_table->offsets[i] *= 2;
+            for (Length i = 0; i < static_cast<Length>(num_glyphs) + 1; ++i) {
+                U16 offset;
+                read_big_endian_and_move_unchecked(file_iter, &offset);
+                loca_table->offsets[i] = static_cast<U32>(offset) * 2;
             }
         } else {
             TTE_ASSERT(offset_size == OffsetSize::Long32);
-            for (Length i = 0; i < num_glyphs + 1; ++i) {
+            for (Length i = 0; i < static_cast<Length>(num_glyphs) + 1; ++i) {
                 read_big_endian_and_move_unchecked(file_iter, &(loca_table->offsets[i]));
             }
         }
@@ -761,45 +852,1091 @@ namespace tte { namespace ttf {
     static void print(LOCATable* loca_table) {
         TTE_DBG("==== LOCA Table");
         TTE_DBG("\tindex\toffset\tsize");
-        for (Length i = 0; i < loca_table->length - 1; ++i) {
+        for (Length i = 0; i < loca_table->length; ++i) {
             TTE_DBG("\t%d\t%d\t%d", i, loca_table->offsets[i], loca_table->offsets[i + 1] - loca_table->offsets[i]);
         }
     }
 
-    void parse_file(const char* file_path) {
-        Length file_size;
+    void free_loca_table(LOCATable* loca_table) {
+        if (loca_table->offsets) {
+            free(loca_table->offsets);
+            loca_table->offsets = nullptr;
+        }
+    }
+
+    // #region glyf
+    namespace glyph_flags {
+        static const constexpr U8 on_curve_point = 1 << 0;
+        static const constexpr U8 x_short_vector = 1 << 1;
+        static const constexpr U8 y_short_vector = 1 << 2;
+        static const constexpr U8 repeat = 1 << 3;
+        // positive if the vector is short, else the coordinate is the same as the last
+        static const constexpr U8 x_is_same_or_positive_x_short_vector = 1 << 4;
+        static const constexpr U8 y_is_same_or_positive_y_short_vector = 1 << 5;
+    }
+
+    namespace component_flags {
+        static const constexpr U16 arg_1_and_2_are_words = 1 << 0;
+        static const constexpr U16 args_are_xy_values = 1 << 1;
+        static const constexpr U16 we_have_a_scale = 1 << 3;
+        static const constexpr U16 more_components = 1 << 5;
+        static const constexpr U16 we_have_an_x_and_y_scale = 1 << 6;
+        static const constexpr U16 we_have_a_two_by_two = 1 << 7;
+    }
+
+    static const constexpr Length glyph_header_size = sizeof(S16) * 5;
+    // compound glyphs nest their components no deeper than this, and no glyph has more points
+    static const constexpr Length max_component_depth = 8;
+    static const constexpr Length max_outline_points = 1 << 16;
+    static const constexpr Length min_outline_capacity = 64;
+    // no glyph is drawn larger, in pixels
+    static const constexpr Length max_glyph_bitmap_size = 4096;
+
+    struct GlyphPoint {
+        float x;
+        float y;
+        bool on_curve;
+    };
+
+    // the contours of a glyph in font units, y up, after the transforms of the compound glyphs it is a component of
+    struct GlyphOutline {
+        GlyphPoint* points;
+        Length num_points;
+        Length points_capacity;
+        // the index after the last point of each contour
+        Length* contour_ends;
+        Length num_contours;
+        Length contours_capacity;
+    };
+
+    void free_glyph_outline(GlyphOutline* outline) {
+        free(outline->points);
+        free(outline->contour_ends);
+        memset(outline, 0, sizeof(GlyphOutline));
+    }
+
+    static void reserve_glyph_outline(GlyphOutline* outline, const Length num_points, const Length num_contours) {
+        if (outline->num_points + num_points > outline->points_capacity) {
+            const Length capacity = std::max(
+                std::max(outline->num_points + num_points, outline->points_capacity * 2), min_outline_capacity);
+            GlyphPoint* const points = static_cast<GlyphPoint*>(malloc(sizeof(GlyphPoint) * capacity));
+            if (outline->num_points != 0) {
+                memcpy(points, outline->points, sizeof(GlyphPoint) * outline->num_points);
+            }
+            free(outline->points);
+            outline->points = points;
+            outline->points_capacity = capacity;
+        }
+        if (outline->num_contours + num_contours > outline->contours_capacity) {
+            const Length capacity = std::max(
+                std::max(outline->num_contours + num_contours, outline->contours_capacity * 2), min_outline_capacity);
+            Length* const contour_ends = static_cast<Length*>(malloc(sizeof(Length) * capacity));
+            if (outline->num_contours != 0) {
+                memcpy(contour_ends, outline->contour_ends, sizeof(Length) * outline->num_contours);
+            }
+            free(outline->contour_ends);
+            outline->contour_ends = contour_ends;
+            outline->contours_capacity = capacity;
+        }
+    }
+
+    // x' = a * x + c * y + e, y' = b * x + d * y + f
+    struct GlyphTransform {
+        float a;
+        float b;
+        float c;
+        float d;
+        float e;
+        float f;
+    };
+
+    [[nodiscard]] static GlyphTransform multiply(const GlyphTransform& outer, const GlyphTransform& inner) {
+        return GlyphTransform{outer.a * inner.a + outer.c * inner.b,
+            outer.b * inner.a + outer.d * inner.b,
+            outer.a * inner.c + outer.c * inner.d,
+            outer.b * inner.c + outer.d * inner.d,
+            outer.a * inner.e + outer.c * inner.f + outer.e,
+            outer.b * inner.e + outer.d * inner.f + outer.f};
+    }
+
+    [[nodiscard]] static float read_f2dot14(U8* const memory) {
+        S16 value;
+        platform_layer::read_big_endian(memory, &value);
+        return static_cast<float>(value) / 16384.0f;
+    }
+
+    // appends the contours of a simple glyph, numberOfContours and the bounding box already read, to the outline
+    [[nodiscard]] static bool read_simple_glyph(U8* at,
+        U8* const end,
+        const S16 number_of_contours,
+        const GlyphTransform& transform,
+        GlyphOutline* outline) {
+        const Length num_contours = static_cast<Length>(number_of_contours);
+        if (!platform_layer::has_enough_space(at, sizeof(U16) * num_contours + sizeof(U16), end)) {
+            return false;
+        }
+
+        // the contour ends are checked to increase, so the last is the number of points
+        reserve_glyph_outline(outline, 0, num_contours);
+        const Length first_point = outline->num_points;
+        Length num_points = 0;
+        for (Length i = 0; i < num_contours; ++i) {
+            U16 end_point;
+            at = platform_layer::read_big_endian_and_move(at, &end_point);
+            if (static_cast<Length>(end_point) + 1 <= num_points && i != 0) {
+                return false;
+            }
+            num_points = static_cast<Length>(end_point) + 1;
+            outline->contour_ends[outline->num_contours + i] = first_point + num_points;
+        }
+        if (first_point + num_points > max_outline_points) {
+            return false;
+        }
+
+        U16 instruction_length;
+        at = platform_layer::read_big_endian_and_move(at, &instruction_length);
+        if (!platform_layer::has_enough_space(at, instruction_length, end)) {
+            return false;
+        }
+        at += instruction_length;
+
+        // the flags are kept in on_curve until the coordinates are read
+        reserve_glyph_outline(outline, num_points, 0);
+        GlyphPoint* const points = outline->points + first_point;
+        U8* flags = static_cast<U8*>(malloc(num_points));
+        bool result = true;
+        for (Length i = 0; i < num_points && result;) {
+            if (!platform_layer::has_enough_space(at, sizeof(U8), end)) {
+                result = false;
+                break;
+            }
+            const U8 flag = *at++;
+            Length repeat = 1;
+            if (flag & glyph_flags::repeat) {
+                if (!platform_layer::has_enough_space(at, sizeof(U8), end)) {
+                    result = false;
+                    break;
+                }
+                repeat += *at++;
+            }
+            for (; repeat != 0 && i < num_points; --repeat, ++i) {
+                flags[i] = flag;
+            }
+        }
+
+        // x coordinates, then y coordinates, each a delta from the last
+        for (Length axis = 0; axis < 2 && result; ++axis) {
+            const U8 short_vector = axis == 0 ? glyph_flags::x_short_vector : glyph_flags::y_short_vector;
+            const U8 same_or_positive = axis == 0 ? glyph_flags::x_is_same_or_positive_x_short_vector :
+                                                    glyph_flags::y_is_same_or_positive_y_short_vector;
+            S32 coordinate = 0;
+            for (Length i = 0; i < num_points; ++i) {
+                if (flags[i] & short_vector) {
+                    if (!platform_layer::has_enough_space(at, sizeof(U8), end)) {
+                        result = false;
+                        break;
+                    }
+                    coordinate += (flags[i] & same_or_positive) ? *at : -static_cast<S32>(*at);
+                    ++at;
+                } else if (!(flags[i] & same_or_positive)) {
+                    if (!platform_layer::has_enough_space(at, sizeof(S16), end)) {
+                        result = false;
+                        break;
+                    }
+                    S16 delta;
+                    at = platform_layer::read_big_endian_and_move(at, &delta);
+                    coordinate += delta;
+                }
+                if (axis == 0) {
+                    points[i].x = static_cast<float>(coordinate);
+                } else {
+                    points[i].y = static_cast<float>(coordinate);
+                }
+            }
+        }
+
+        if (result) {
+            for (Length i = 0; i < num_points; ++i) {
+                const float x = points[i].x;
+                const float y = points[i].y;
+                points[i].x = transform.a * x + transform.c * y + transform.e;
+                points[i].y = transform.b * x + transform.d * y + transform.f;
+                points[i].on_curve = flags[i] & glyph_flags::on_curve_point;
+            }
+            outline->num_points += num_points;
+            outline->num_contours += num_contours;
+        }
+        free(flags);
+        return result;
+    }
+
+    [[nodiscard]] static bool read_glyph(platform_layer::FileIter* file_iter,
+        TableDirectory* glyf_table_directory,
+        LOCATable* loca_table,
+        U16 glyph_id,
+        const GlyphTransform& transform,
+        Length depth,
+        GlyphOutline* outline);
+
+    // appends the components of a compound glyph, numberOfContours and the bounding box already read, to the outline
+    [[nodiscard]] static bool read_compound_glyph(platform_layer::FileIter* file_iter,
+        TableDirectory* glyf_table_directory,
+        LOCATable* loca_table,
+        U8* at,
+        U8* const end,
+        const GlyphTransform& transform,
+        const Length depth,
+        GlyphOutline* outline) {
+        if (depth == max_component_depth) {
+            return false;
+        }
+
+        U16 flags;
+        do {
+            if (!platform_layer::has_enough_space(at, sizeof(U16) * 2, end)) {
+                return false;
+            }
+            U16 glyph_id;
+            at = platform_layer::read_big_endian_and_move(at, &flags);
+            at = platform_layer::read_big_endian_and_move(at, &glyph_id);
+
+            GlyphTransform component{1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+            if (flags & component_flags::arg_1_and_2_are_words) {
+                if (!platform_layer::has_enough_space(at, sizeof(S16) * 2, end)) {
+                    return false;
+                }
+                S16 argument_1;
+                S16 argument_2;
+                at = platform_layer::read_big_endian_and_move(at, &argument_1);
+                at = platform_layer::read_big_endian_and_move(at, &argument_2);
+                component.e = argument_1;
+                component.f = argument_2;
+            } else {
+                if (!platform_layer::has_enough_space(at, sizeof(S8) * 2, end)) {
+                    return false;
+                }
+                S8 argument_1;
+                S8 argument_2;
+                at = platform_layer::read_big_endian_and_move(at, &argument_1);
+                at = platform_layer::read_big_endian_and_move(at, &argument_2);
+                component.e = argument_1;
+                component.f = argument_2;
+            }
+            // the arguments can instead be points of the glyph and the component to match, which is not supported, the
+            // component is placed at the origin of the glyph
+            if (!(flags & component_flags::args_are_xy_values)) {
+                component.e = 0.0f;
+                component.f = 0.0f;
+            }
+
+            if (flags & component_flags::we_have_a_scale) {
+                if (!platform_layer::has_enough_space(at, sizeof(S16), end)) {
+                    return false;
+                }
+                component.a = component.d = read_f2dot14(at);
+                at += sizeof(S16);
+            } else if (flags & component_flags::we_have_an_x_and_y_scale) {
+                if (!platform_layer::has_enough_space(at, sizeof(S16) * 2, end)) {
+                    return false;
+                }
+                component.a = read_f2dot14(at);
+                component.d = read_f2dot14(at + sizeof(S16));
+                at += sizeof(S16) * 2;
+            } else if (flags & component_flags::we_have_a_two_by_two) {
+                if (!platform_layer::has_enough_space(at, sizeof(S16) * 4, end)) {
+                    return false;
+                }
+                component.a = read_f2dot14(at);
+                component.b = read_f2dot14(at + sizeof(S16));
+                component.c = read_f2dot14(at + sizeof(S16) * 2);
+                component.d = read_f2dot14(at + sizeof(S16) * 3);
+                at += sizeof(S16) * 4;
+            }
+
+            if (!read_glyph(file_iter,
+                    glyf_table_directory,
+                    loca_table,
+                    glyph_id,
+                    multiply(transform, component),
+                    depth + 1,
+                    outline)) {
+                return false;
+            }
+        } while (flags & component_flags::more_components);
+        return true;
+    }
+
+    // appends the contours of the glyph, transformed, to the outline
+    [[nodiscard]] static bool read_glyph(platform_layer::FileIter* file_iter,
+        TableDirectory* glyf_table_directory,
+        LOCATable* loca_table,
+        U16 glyph_id,
+        const GlyphTransform& transform,
+        Length depth,
+        GlyphOutline* outline) {
+        if (glyph_id >= loca_table->length) {
+            return false;
+        }
+        const U32 glyph_offset = loca_table->offsets[glyph_id];
+        const U32 glyph_end = loca_table->offsets[glyph_id + 1];
+        // a glyph with no data has no contours (e.g. space)
+        if (glyph_end <= glyph_offset) {
+            return glyph_end == glyph_offset;
+        }
+        if (glyph_end > glyf_table_directory->size || glyph_end - glyph_offset < glyph_header_size) {
+            return false;
+        }
+
+        // table directories have already been validated that they are pointing to something in bounds
+        U8* at = file_iter->begin + glyf_table_directory->offset + glyph_offset;
+        U8* const end = file_iter->begin + glyf_table_directory->offset + glyph_end;
+        S16 number_of_contours;
+        at = platform_layer::read_big_endian_and_move(at, &number_of_contours);
+        // the bounding box, the outline is measured from its points
+        at += sizeof(FWord) * 4;
+        if (number_of_contours >= 0) {
+            return read_simple_glyph(at, end, number_of_contours, transform, outline);
+        }
+        return read_compound_glyph(file_iter, glyf_table_directory, loca_table, at, end, transform, depth, outline);
+    }
+    // #endregion
+
+    // #region rasteriser
+    // the rasteriser accumulates the signed area each edge covers in each pixel of its rows, and the area it covers
+    // right of them, into the pixel at the right of the edge. a running sum along each row then gives the coverage of
+    // every pixel, with no sorting of edges or spans.
+    struct Rasteriser {
+        // width * height running sum terms, and 2 after them for edges on the right border of the last row
+        float* accumulation;
+        Length accumulation_capacity;
+        U8* coverage;
+        Length coverage_capacity;
+        U32 width;
+        U32 height;
+    };
+
+    void free_rasteriser(Rasteriser* rasteriser) {
+        free(rasteriser->accumulation);
+        free(rasteriser->coverage);
+        memset(rasteriser, 0, sizeof(Rasteriser));
+    }
+
+    // a line in pixels, y down
+    static void accumulate_line(Rasteriser* rasteriser, float x0, float y0, float x1, float y1) {
+        if (y0 == y1) {
+            return;
+        }
+        // the line goes down, up lines take area away
+        const float direction = y0 < y1 ? 1.0f : -1.0f;
+        if (y0 > y1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        if (y0 < 0.0f) {
+            x -= y0 * dxdy;
+        }
+        const float width = static_cast<float>(rasteriser->width);
+        float* const accumulation = rasteriser->accumulation;
+        const S64 end_y = std::min<S64>(static_cast<S64>(ceilf(y1)), rasteriser->height);
+        for (S64 y = std::max<S64>(static_cast<S64>(y0), 0); y < end_y; ++y) {
+            const Length row = static_cast<Length>(y) * rasteriser->width;
+            const float dy = std::min(static_cast<float>(y + 1), y1) - std::max(static_cast<float>(y), y0);
+            const float next_x = x + dxdy * dy;
+            const float d = dy * direction;
+            // the points are in the bitmap, the clamp only keeps rounding errors in it
+            const float left = std::min(std::max(std::min(x, next_x), 0.0f), width);
+            const float right = std::min(std::max(std::max(x, next_x), 0.0f), width);
+            const float left_floor = floorf(left);
+            const Length left_index = static_cast<Length>(left_floor);
+            const Length right_index = static_cast<Length>(ceilf(right));
+            if (right_index <= left_index + 1) {
+                // within one pixel, split by the middle of the line in it
+                const float middle = 0.5f * (x + next_x) - left_floor;
+                accumulation[row + left_index] += d - d * middle;
+                accumulation[row + left_index + 1] += d * middle;
+            } else {
+                // across pixels, the triangle in the first, a trapezoid in each between and what is left in the last
+                const float s = 1.0f / (right - left);
+                const float left_fraction = left - left_floor;
+                const float first_area = 0.5f * s * (1.0f - left_fraction) * (1.0f - left_fraction);
+                const float right_fraction = right - static_cast<float>(right_index) + 1.0f;
+                const float last_area = 0.5f * s * right_fraction * right_fraction;
+                accumulation[row + left_index] += d * first_area;
+                if (right_index == left_index + 2) {
+                    accumulation[row + left_index + 1] += d * (1.0f - first_area - last_area);
+                } else {
+                    const float second_area = s * (1.5f - left_fraction);
+                    accumulation[row + left_index + 1] += d * (second_area - first_area);
+                    for (Length i = left_index + 2; i < right_index - 1; ++i) {
+                        accumulation[row + i] += d * s;
+                    }
+                    const float before_last_area =
+                        second_area + static_cast<float>(right_index - left_index - 3) * s;
+                    accumulation[row + right_index - 1] += d * (1.0f - before_last_area - last_area);
+                }
+                accumulation[row + right_index] += d * last_area;
+            }
+            x = next_x;
+        }
+    }
+
+    // a quadratic bezier as lines, more the further its control point is from the line between its ends
+    static void accumulate_quadratic(
+        Rasteriser* rasteriser, float x0, float y0, float x1, float y1, float x2, float y2) {
+        const float deviation_x = x0 - 2.0f * x1 + x2;
+        const float deviation_y = y0 - 2.0f * y1 + y2;
+        const float deviation_squared = deviation_x * deviation_x + deviation_y * deviation_y;
+        if (deviation_squared < 1.0f / 3.0f) {
+            accumulate_line(rasteriser, x0, y0, x2, y2);
+            return;
+        }
+        const Length segments = 1 + static_cast<Length>(sqrtf(sqrtf(3.0f * deviation_squared)));
+        float last_x = x0;
+        float last_y = y0;
+        for (Length i = 1; i <= segments; ++i) {
+            const float t = static_cast<float>(i) / static_cast<float>(segments);
+            const float u = 1.0f - t;
+            const float x = u * u * x0 + 2.0f * u * t * x1 + t * t * x2;
+            const float y = u * u * y0 + 2.0f * u * t * y1 + t * t * y2;
+            accumulate_line(rasteriser, last_x, last_y, x, y);
+            last_x = x;
+            last_y = y;
+        }
+    }
+
+    // the contours, in pixels, into the accumulation. between two off curve points is an implied on curve point.
+    static void accumulate_outline(Rasteriser* rasteriser, const GlyphOutline& outline) {
+        Length begin = 0;
+        for (Length contour = 0; contour < outline.num_contours; begin = outline.contour_ends[contour], ++contour) {
+            const Length end = outline.contour_ends[contour];
+            const Length length = end - begin;
+            if (length < 2) {
+                continue;
+            }
+            // starts from an on curve point, or the point implied between the first two
+            Length first = 0;
+            while (first < length && !outline.points[begin + first].on_curve) {
+                ++first;
+            }
+            float start_x;
+            float start_y;
+            if (first == length) {
+                first = 0;
+                start_x = 0.5f * (outline.points[begin].x + outline.points[begin + 1].x);
+                start_y = 0.5f * (outline.points[begin].y + outline.points[begin + 1].y);
+            } else {
+                start_x = outline.points[begin + first].x;
+                start_y = outline.points[begin + first].y;
+            }
+
+            float x = start_x;
+            float y = start_y;
+            bool has_control = false;
+            float control_x = 0.0f;
+            float control_y = 0.0f;
+            for (Length i = 1; i <= length; ++i) {
+                const GlyphPoint& point = outline.points[begin + (first + i) % length];
+                const bool last = i == length;
+                if (point.on_curve || last) {
+                    const float to_x = last ? start_x : point.x;
+                    const float to_y = last ? start_y : point.y;
+                    if (last && !point.on_curve) {
+                        // the first point was implied, the last is the control point before it
+                        if (has_control) {
+                            const float middle_x = 0.5f * (control_x + point.x);
+                            const float middle_y = 0.5f * (control_y + point.y);
+                            accumulate_quadratic(rasteriser, x, y, control_x, control_y, middle_x, middle_y);
+                            x = middle_x;
+                            y = middle_y;
+                        }
+                        accumulate_quadratic(rasteriser, x, y, point.x, point.y, to_x, to_y);
+                    } else if (has_control) {
+                        accumulate_quadratic(rasteriser, x, y, control_x, control_y, to_x, to_y);
+                    } else {
+                        accumulate_line(rasteriser, x, y, to_x, to_y);
+                    }
+                    x = to_x;
+                    y = to_y;
+                    has_control = false;
+                } else {
+                    if (has_control) {
+                        const float middle_x = 0.5f * (control_x + point.x);
+                        const float middle_y = 0.5f * (control_y + point.y);
+                        accumulate_quadratic(rasteriser, x, y, control_x, control_y, middle_x, middle_y);
+                        x = middle_x;
+                        y = middle_y;
+                    }
+                    control_x = point.x;
+                    control_y = point.y;
+                    has_control = true;
+                }
+            }
+        }
+    }
+
+    // the coverage of a pixel from the running sum at it
+    [[nodiscard]] static U8 get_coverage(const float sum) {
+        return static_cast<U8>(std::min(fabsf(sum), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // the running sum of the accumulation from begin to end, starting from sum, into coverage
+    static void sum_coverage(const float* accumulation, U8* coverage, const Length begin, const Length end, float sum) {
+        for (Length i = begin; i < end; ++i) {
+            sum += accumulation[i];
+            coverage[i] = get_coverage(sum);
+        }
+    }
+
+    // the running sum four terms at a time, each added to the ones after it and then the sum of the terms before added.
+    // the terms are added in the order sum_coverage_sse2 adds them, so builds with and without SSE2 draw the same.
+    [[maybe_unused]] static void sum_coverage_scalar(const float* accumulation, U8* coverage, const Length length) {
+        Length i = 0;
+        float sum = 0.0f;
+        for (; i + 4 <= length; i += 4) {
+            const float* const x = accumulation + i;
+            const float x01 = x[1] + x[0];
+            const float sums[4] = {x[0], x01, (x[2] + x[1]) + x[0], (x[3] + x[2]) + x01};
+            for (Length j = 0; j < 4; ++j) {
+                coverage[i + j] = get_coverage(sums[j] + sum);
+            }
+            sum = sums[3] + sum;
+        }
+        sum_coverage(accumulation, coverage, i, length, sum);
+    }
+
+#if TTE_TTF_SSE2
+    // sum_coverage_scalar in SSE2: each term is added to the ones after it in the same register, in two shifts
+    static void sum_coverage_sse2(const float* accumulation, U8* coverage, const Length length) {
+        Length i = 0;
+        const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 offset = _mm_setzero_ps();
+        for (; i + 4 <= length; i += 4) {
+            __m128 x = _mm_loadu_ps(accumulation + i);
+            x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+            x = _mm_add_ps(x, _mm_shuffle_ps(_mm_setzero_ps(), x, 0x40));
+            x = _mm_add_ps(x, offset);
+            const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_and_ps(x, abs_mask), one), scale), half);
+            const __m128i z = _mm_cvttps_epi32(y);
+            const __m128i z16 = _mm_packs_epi32(z, z);
+            const int z8 = _mm_cvtsi128_si32(_mm_packus_epi16(z16, z16));
+            memcpy(coverage + i, &z8, sizeof(z8));
+            offset = _mm_shuffle_ps(x, x, 0xFF);
+        }
+        sum_coverage(accumulation, coverage, i, length, _mm_cvtss_f32(offset));
+    }
+#endif
+
+    // the running sum of the accumulation, all of it, into coverage
+    static void sum_coverage(const float* accumulation, U8* coverage, const Length length) {
+#if TTE_TTF_SSE2
+        sum_coverage_sse2(accumulation, coverage, length);
+#else
+        sum_coverage_scalar(accumulation, coverage, length);
+#endif
+    }
+    // #endregion
+
+    struct FontFile {
+        // the file, mapped (see platform_layer::map_file)
+        platform_layer::FileIter file_iter;
+        FontDirectory font_directory;
+        HeadTable head_table;
+        MAXPTable maxp_table;
+        LOCATable loca_table;
+        CMAPTable cmap_table;
+        TableDirectory* glyf_table_directory;
+        // reused for every glyph, so rasterising allocates only to grow them
+        GlyphOutline outline;
+        Rasteriser rasteriser;
+    };
+
+    void close_font_file(FontFile& font_file) {
+        free_rasteriser(&font_file.rasteriser);
+        free_glyph_outline(&font_file.outline);
+        free_cmap_table(&font_file.cmap_table);
+        free_loca_table(&font_file.loca_table);
+        free_font_directory(&font_file.font_directory);
+        platform_layer::unmap_file(&font_file.file_iter);
+        free(&font_file);
+    }
+
+    FontFile* open_font_file(const char* file_path) {
+        FontFile* result = static_cast<FontFile*>(malloc(sizeof(FontFile)));
+        memset(static_cast<void*>(result), 0, sizeof(FontFile));
+        platform_layer::FileIter& file_iter = result->file_iter;
+        if (!platform_layer::map_file(file_path, &file_iter)) {
+            free(result);
+            return nullptr;
+        }
+
+        if (!read_font_directory(&file_iter, &result->font_directory) ||
+            !read_head_table(&file_iter, &result->font_directory, &result->head_table) ||
+            !read_maxp_table(&file_iter, &result->font_directory, &result->maxp_table) ||
+            !read_loca_table(&file_iter,
+                &result->font_directory,
+                &result->loca_table,
+                result->head_table.index_to_loc_format == 0 ? OffsetSize::Short16 : OffsetSize::Long32,
+                result->maxp_table.num_glyphs) ||
+            !read_cmap_table(&file_iter, &result->font_directory, &result->cmap_table) ||
+            !get_format_4_table(&result->cmap_table) || result->head_table.units_per_em == 0) {
+            close_font_file(*result);
+            return nullptr;
+        }
+        result->glyf_table_directory =
+            find_first_table_directory_with_tag(&result->font_directory, TableDirectory_Tag::GLYF);
+        return result;
+    }
+
+    U16 get_glyph_id(FontFile& font_file, U32 codepoint) {
+        // the format 4 cmap maps the basic multilingual plane
+        if (codepoint > 0xFFFF) {
+            return 0;
+        }
+        return character_code_to_glyph_id(static_cast<U16>(codepoint), &font_file.cmap_table);
+    }
+
+    bool rasterise_glyph(FontFile& font_file, U16 glyph_id, float pixels_per_em, GlyphBitmap* result) {
+        GlyphOutline& outline = font_file.outline;
+        outline.num_points = 0;
+        outline.num_contours = 0;
+        // y down
+        const float scale = pixels_per_em / static_cast<float>(font_file.head_table.units_per_em);
+        const GlyphTransform transform{scale, 0.0f, 0.0f, -scale, 0.0f, 0.0f};
+        memset(static_cast<void*>(result), 0, sizeof(GlyphBitmap));
+        if (!read_glyph(&font_file.file_iter,
+                font_file.glyf_table_directory,
+                &font_file.loca_table,
+                glyph_id,
+                transform,
+                0,
+                &outline)) {
+            return false;
+        }
+        if (outline.num_points == 0) {
+            return true;
+        }
+
+        // the bitmap is around the points, which are not trusted to be in the bounding box of the glyph
+        float min_x = outline.points[0].x;
+        float min_y = outline.points[0].y;
+        float max_x = min_x;
+        float max_y = min_y;
+        for (Length i = 1; i < outline.num_points; ++i) {
+            min_x = std::min(min_x, outline.points[i].x);
+            min_y = std::min(min_y, outline.points[i].y);
+            max_x = std::max(max_x, outline.points[i].x);
+            max_y = std::max(max_y, outline.points[i].y);
+        }
+        const float left = floorf(min_x);
+        const float top = floorf(min_y);
+        const float width = ceilf(max_x) - left;
+        const float height = ceilf(max_y) - top;
+        if (width > static_cast<float>(max_glyph_bitmap_size) || height > static_cast<float>(max_glyph_bitmap_size)) {
+            return false;
+        }
+        for (Length i = 0; i < outline.num_points; ++i) {
+            outline.points[i].x -= left;
+            outline.points[i].y -= top;
+        }
+
+        Rasteriser& rasteriser = font_file.rasteriser;
+        rasteriser.width = static_cast<U32>(width);
+        rasteriser.height = static_cast<U32>(height);
+        const Length size = static_cast<Length>(rasteriser.width) * rasteriser.height;
+        if (size + 2 > rasteriser.accumulation_capacity) {
+            free(rasteriser.accumulation);
+            rasteriser.accumulation_capacity = std::max(size + 2, rasteriser.accumulation_capacity * 2);
+            rasteriser.accumulation = static_cast<float*>(malloc(sizeof(float) * rasteriser.accumulation_capacity));
+        }
+        if (size > rasteriser.coverage_capacity) {
+            free(rasteriser.coverage);
+            rasteriser.coverage_capacity = std::max(size, rasteriser.coverage_capacity * 2);
+            rasteriser.coverage = static_cast<U8*>(malloc(rasteriser.coverage_capacity));
+        }
+        memset(rasteriser.accumulation, 0, sizeof(float) * (size + 2));
+        accumulate_outline(&rasteriser, outline);
+        sum_coverage(rasteriser.accumulation, rasteriser.coverage, size);
+
+        result->coverage = rasteriser.coverage;
+        result->width = rasteriser.width;
+        result->height = rasteriser.height;
+        result->left = static_cast<S32>(left);
+        result->top = static_cast<S32>(top);
+        return true;
+    }
+
+    // #region font index
+    static const constexpr U32 font_index_magic = tag_value("tfix");
+    // changed with the layout of the index file
+    static const constexpr U32 font_index_version = 2;
+    static const constexpr Length min_font_index_capacity = 16;
+    static const constexpr U16 family_name_id = 1;
+    static const constexpr U16 subfamily_name_id = 2;
+
+    // a font file, its size and modification time when it was read, and what was read
+    struct IndexedFont {
+        char* path;
+        U64 file_size;
+        S64 modification_time_seconds;
+        S64 modification_time_nanoseconds;
+        FontInfo info;
+    };
+
+    struct FontIndex {
+        IndexedFont* fonts;
+        Length length;
+        Length capacity;
+    };
+
+    // the start of an index file, followed for each font by the length of its path, its path without a null terminator,
+    // its size, modification time in seconds and nanoseconds, and FontInfo. in the byte order of the machine, as the
+    // index is a cache of its fonts.
+    struct FontIndexHeader {
+        U32 magic;
+        U32 version;
+        U64 info_size;
+        U64 number_of_fonts;
+    };
+
+    // takes the path of the font
+    static void add_indexed_font(FontIndex* font_index, const IndexedFont& font) {
+        if (font_index->length == font_index->capacity) {
+            const Length capacity = std::max(min_font_index_capacity, font_index->capacity * 2);
+            IndexedFont* fonts = static_cast<IndexedFont*>(malloc(sizeof(IndexedFont) * capacity));
+            if (font_index->length != 0) {
+                memcpy(static_cast<void*>(fonts), font_index->fonts, sizeof(IndexedFont) * font_index->length);
+            }
+            free(static_cast<void*>(font_index->fonts));
+            font_index->fonts = fonts;
+            font_index->capacity = capacity;
+        }
+        font_index->fonts[font_index->length] = font;
+        ++font_index->length;
+    }
+
+    static void free_indexed_fonts(FontIndex* font_index) {
+        for (Length i = 0; i < font_index->length; ++i) {
+            free(font_index->fonts[i].path);
+        }
+        free(static_cast<void*>(font_index->fonts));
+        font_index->fonts = nullptr;
+        font_index->length = 0;
+        font_index->capacity = 0;
+    }
+
+    [[nodiscard]] static bool read_bytes_and_move(platform_layer::FileIter* file_iter, void* result, Length size) {
+        if (!platform_layer::has_enough_space_from_at(file_iter, size)) {
+            return false;
+        }
+        memcpy(result, file_iter->at, size);
+        file_iter->at += size;
+        return true;
+    }
+
+    // the fonts of the index file, up to the first that cannot be read. none if the file is of another version.
+    static void read_font_index_file(const char* index_path, FontIndex* font_index) {
         platform_layer::FileIter file_iter;
-        file_iter.begin = file_iter.at = platform_layer::read_file(file_path, &file_iter.size);
+        file_iter.begin = file_iter.at = platform_layer::read_file(index_path, &file_iter.size);
         if (!file_iter.begin) {
-            TTE_DBG("failed to read file\n");
             return;
         }
 
+        FontIndexHeader header;
+        if (read_bytes_and_move(&file_iter, &header, sizeof(FontIndexHeader)) && header.magic == font_index_magic &&
+            header.version == font_index_version && header.info_size == sizeof(FontInfo)) {
+            for (U64 i = 0; i < header.number_of_fonts; ++i) {
+                U64 path_length;
+                if (!read_bytes_and_move(&file_iter, &path_length, sizeof(U64)) ||
+                    !platform_layer::has_enough_space_from_at(&file_iter, path_length)) {
+                    break;
+                }
+                IndexedFont font;
+                font.path = static_cast<char*>(malloc(sizeof(char) * (path_length + 1)));
+                memcpy(font.path, file_iter.at, path_length);
+                font.path[path_length] = '\0';
+                file_iter.at += path_length;
+                if (!read_bytes_and_move(&file_iter, &font.file_size, sizeof(U64)) ||
+                    !read_bytes_and_move(&file_iter, &font.modification_time_seconds, sizeof(S64)) ||
+                    !read_bytes_and_move(&file_iter, &font.modification_time_nanoseconds, sizeof(S64)) ||
+                    !read_bytes_and_move(&file_iter, &font.info, sizeof(FontInfo))) {
+                    free(font.path);
+                    break;
+                }
+                font.info.family[sizeof(font.info.family) - 1] = '\0';
+                font.info.subfamily[sizeof(font.info.subfamily) - 1] = '\0';
+                add_indexed_font(font_index, font);
+            }
+        }
+        free(file_iter.begin);
+    }
+
+    // writes the index beside index_path and moves it over index_path, so a reader never sees it partly written
+    [[nodiscard]] static bool write_font_index_file(const char* index_path, const FontIndex& font_index) {
+        static const constexpr char temporary_extension[] = ".tmp";
+        const Length index_path_length = strlen(index_path);
+        char* temporary_path =
+            static_cast<char*>(malloc(sizeof(char) * (index_path_length + sizeof(temporary_extension))));
+        memcpy(temporary_path, index_path, index_path_length);
+        memcpy(temporary_path + index_path_length, temporary_extension, sizeof(temporary_extension));
+
+        bool result = false;
+        if (FILE* file = fopen(temporary_path, "wb")) {
+            const FontIndexHeader header{font_index_magic, font_index_version, sizeof(FontInfo), font_index.length};
+            result = fwrite(&header, sizeof(FontIndexHeader), 1, file) == 1;
+            for (Length i = 0; result && i < font_index.length; ++i) {
+                const IndexedFont& font = font_index.fonts[i];
+                const U64 path_length = strlen(font.path);
+                result = fwrite(&path_length, sizeof(U64), 1, file) == 1 &&
+                    fwrite(font.path, sizeof(char), path_length, file) == path_length &&
+                    fwrite(&font.file_size, sizeof(U64), 1, file) == 1 &&
+                    fwrite(&font.modification_time_seconds, sizeof(S64), 1, file) == 1 &&
+                    fwrite(&font.modification_time_nanoseconds, sizeof(S64), 1, file) == 1 &&
+                    fwrite(&font.info, sizeof(FontInfo), 1, file) == 1;
+            }
+            result = fclose(file) == 0 && result && rename(temporary_path, index_path) == 0;
+            if (!result) {
+                remove(temporary_path);
+            }
+        }
+        free(temporary_path);
+        return result;
+    }
+
+    // the name with name_id as utf-8, cut to fit in capacity bytes with its null terminator. the english name of the
+    // microsoft platform is preferred, then that of the macintosh platform, then the name of the unicode platform.
+    // empty if the font has none of them.
+    static void read_name(platform_layer::FileIter* file_iter,
+        NameTable* name_table,
+        const U16 name_id,
+        char* name,
+        const Length capacity) {
+        TTE_ASSERT(capacity != 0);
+        using PlatformId = NameRecord_And_CMAPEncodingSubtable_PlatformId;
+        const NameRecord* best_record = nullptr;
+        U32 best_rank = 0;
+        for (Length i = 0; i < name_table->count; ++i) {
+            const NameRecord& record = name_table->name_record_array[i];
+            if (record.name_id != name_id) {
+                continue;
+            }
+            U32 rank = 0;
+            if (record.platform_id == static_cast<U16>(PlatformId::Microsoft) &&
+                record.language_id == static_cast<U16>(NameRecord_MicrosoftPlatform_LanguageId::English_UnitedStates)) {
+                rank = 3;
+            } else if (record.platform_id == static_cast<U16>(PlatformId::Macintosh) &&
+                record.platform_specific_id == static_cast<U16>(MacintoshQuickDrawScriptCode::Roman) &&
+                record.language_id == static_cast<U16>(NameRecord_MacintoshPlatform_LanguageId::English)) {
+                rank = 2;
+            } else if (record.platform_id == static_cast<U16>(PlatformId::Unicode)) {
+                rank = 1;
+            }
+            if (rank > best_rank) {
+                best_record = &record;
+                best_rank = rank;
+            }
+        }
+
+        Length length = 0;
+        if (best_record) {
+            // read_name_table checked the string is in the file
+            const U8* at = file_iter->begin + name_table->table_directory->offset + name_table->string_offset +
+                best_record->offset;
+            const U8* const end = at + best_record->size;
+            if (best_record->platform_id == static_cast<U16>(PlatformId::Macintosh)) {
+                // mac roman, of which only ascii is kept
+                for (; at != end && length + 1 < capacity; ++at) {
+                    name[length++] = *at < 0x80 ? static_cast<char>(*at) : '?';
+                }
+            } else {
+                // utf-16 big endian, of which surrogate pairs are not kept
+                for (; end - at >= 2; at += 2) {
+                    U32 codepoint = static_cast<U32>(TTE_READ_BIG_ENDIAN_16(at));
+                    if (codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+                        codepoint = '?';
+                    }
+                    const Length codepoint_length = codepoint < 0x80 ? 1 : (codepoint < 0x800 ? 2 : 3);
+                    if (length + codepoint_length >= capacity) {
+                        break;
+                    }
+                    if (codepoint_length == 1) {
+                        name[length++] = static_cast<char>(codepoint);
+                    } else if (codepoint_length == 2) {
+                        name[length++] = static_cast<char>(0xC0 | (codepoint >> 6));
+                        name[length++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                    } else {
+                        name[length++] = static_cast<char>(0xE0 | (codepoint >> 12));
+                        name[length++] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                        name[length++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                    }
+                }
+            }
+        }
+        name[length] = '\0';
+    }
+
+    // sets the bit of each character the subtable maps to a glyph. a character in more than one segment is looked up in
+    // the first, as in character_code_to_glyph_id.
+    static void add_coverage(CMAPSubtableFormat4* subtable, U8* coverage) {
+        const Length seg_count = subtable->seg_count_times_2 / 2;
+        U32 begin = 0;
+        for (Length i = 0; i < seg_count; ++i) {
+            for (U32 character_code = std::max<U32>(begin, subtable->start_code_array[i]);
+                 character_code <= subtable->end_code_array[i];
+                 ++character_code) {
+                if (get_segment_glyph_id(subtable, i, static_cast<U16>(character_code)) != 0) {
+                    coverage[character_code / 8] |= static_cast<U8>(1 << (character_code % 8));
+                }
+            }
+            begin = std::max<U32>(begin, static_cast<U32>(subtable->end_code_array[i]) + 1);
+        }
+    }
+
+    // false if the file is not a font the index can describe
+    [[nodiscard]] static bool read_font_info(const char* path, FontInfo* info) {
+        // only the tables read are loaded
+        platform_layer::FileIter file_iter;
+        if (!platform_layer::map_file(path, &file_iter)) {
+            return false;
+        }
+
         FontDirectory font_directory{};
-        if (read_font_directory(&file_iter, &font_directory)) {
-            //print(&font_directory);
-            NameTable name_table{};
-            if (read_name_table(&file_iter, &font_directory, &name_table)) {
-                //print_english(&file_iter, &name_table);
-            }
-            free_name_table(&name_table);
-            HeadTable head_table{};
-            if (read_head_table(&file_iter, &font_directory, &head_table)) {
-                //TTE_DBG("success reading head table, offset: %s", head_table.index_to_loc_format == 0 ? "short" : "long");
-                MAXPTable maxp_table{};
-                if (read_maxp_table(&file_iter, &font_directory, &maxp_table)) {
-                    //TTE_DBG("success reqding maxp table, num glyphs: %d", maxp_table.num_glyphs);
-                    LOCATable loca_table{};
-                    read_loca_table(&file_iter, &font_directory, &loca_table, head_table.index_to_loc_format == 0 ? OffsetSize::Short16 : OffsetSize::Long32, maxp_table.num_glyphs);
-                    print(&loca_table);
-                }
-            }
-            CMAPTable cmap_table{};
-            if (read_cmap_table(&file_iter, &font_directory, &cmap_table)) {
-                //print(&cmap_table);
-            }
-            free_cmap_table(&cmap_table);
+        HeadTable head_table{};
+        MAXPTable maxp_table{};
+        HHEATable hhea_table{};
+        CMAPTable cmap_table{};
+        NameTable name_table{};
+        bool monospaced = false;
+        CMAPSubtableFormat4* subtable = nullptr;
+        const bool result = read_font_directory(&file_iter, &font_directory) &&
+            read_head_table(&file_iter, &font_directory, &head_table) && head_table.units_per_em != 0 &&
+            read_maxp_table(&file_iter, &font_directory, &maxp_table) &&
+            read_hhea_table(&file_iter, &font_directory, &hhea_table) &&
+            read_is_fixed_pitch(&file_iter, &font_directory, &monospaced) &&
+            read_cmap_table(&file_iter, &font_directory, &cmap_table) &&
+            (subtable = get_format_4_table(&cmap_table)) != nullptr &&
+            read_name_table(&file_iter, &font_directory, &name_table);
+        if (result) {
+            memset(static_cast<void*>(info), 0, sizeof(FontInfo));
+            read_name(&file_iter, &name_table, family_name_id, info->family, sizeof(info->family));
+            read_name(&file_iter, &name_table, subfamily_name_id, info->subfamily, sizeof(info->subfamily));
+            info->units_per_em = head_table.units_per_em;
+            info->num_glyphs = maxp_table.num_glyphs;
+            info->ascender = hhea_table.ascender;
+            info->descender = hhea_table.descender;
+            info->line_gap = hhea_table.line_gap;
+            info->x_min = head_table.x_min;
+            info->y_min = head_table.y_min;
+            info->x_max = head_table.x_max;
+            info->y_max = head_table.y_max;
+            info->monospaced = monospaced;
+            add_coverage(subtable, info->coverage);
         }
+
+        free_name_table(&name_table);
+        free_cmap_table(&cmap_table);
         free_font_directory(&font_directory);
+        platform_layer::unmap_file(&file_iter);
+        return result;
+    }
+
+    [[nodiscard]] static IndexedFont* find_indexed_font(FontIndex* font_index, const char* path) {
+        for (Length i = 0; i < font_index->length; ++i) {
+            if (strcmp(font_index->fonts[i].path, path) == 0) {
+                return &font_index->fonts[i];
+            }
+        }
+        return nullptr;
+    }
+    // #endregion
+
+    FontIndex& load_font_index(const char* directory_path, const char* index_path) {
+        FontIndex cached{};
+        read_font_index_file(index_path, &cached);
+
+        FontIndex* result = static_cast<FontIndex*>(malloc(sizeof(FontIndex)));
+        memset(static_cast<void*>(result), 0, sizeof(FontIndex));
+        // whether a font was read, which the index did not have or had out of date
+        bool read = false;
+        if (DIR* directory = opendir(directory_path)) {
+            const Length directory_path_length = strlen(directory_path);
+            while (const dirent* entry = readdir(directory)) {
+                const Length name_length = strlen(entry->d_name);
+                if (name_length < 4 || strcmp(entry->d_name + name_length - 4, ".ttf") != 0) {
+                    continue;
+                }
+
+                IndexedFont font;
+                font.path = static_cast<char*>(malloc(sizeof(char) * (directory_path_length + name_length + 2)));
+                memcpy(font.path, directory_path, directory_path_length);
+                font.path[directory_path_length] = '/';
+                memcpy(font.path + directory_path_length + 1, entry->d_name, name_length + 1);
+                struct stat data;
+                if (stat(font.path, &data) != 0 || !S_ISREG(data.st_mode)) {
+                    free(font.path);
+                    continue;
+                }
+                font.file_size = static_cast<U64>(data.st_size);
+                // to the nanosecond, so a font rewritten within a second of being indexed is read again
+#if defined(__APPLE__)
+                font.modification_time_seconds = static_cast<S64>(data.st_mtimespec.tv_sec);
+                font.modification_time_nanoseconds = static_cast<S64>(data.st_mtimespec.tv_nsec);
+#else
+                font.modification_time_seconds = static_cast<S64>(data.st_mtim.tv_sec);
+                font.modification_time_nanoseconds = static_cast<S64>(data.st_mtim.tv_nsec);
+#endif
+
+                const IndexedFont* cached_font = find_indexed_font(&cached, font.path);
+                if (cached_font && cached_font->file_size == font.file_size &&
+                    cached_font->modification_time_seconds == font.modification_time_seconds &&
+                    cached_font->modification_time_nanoseconds == font.modification_time_nanoseconds) {
+                    font.info = cached_font->info;
+                } else if (read_font_info(font.path, &font.info)) {
+                    read = true;
+                } else {
+                    // not kept, so it is read again next time
+                    TTE_DBG("Failed to read font: %s", font.path);
+                    free(font.path);
+                    continue;
+                }
+                add_indexed_font(result, font);
+            }
+            closedir(directory);
+        }
+
+        std::sort(result->fonts, result->fonts + result->length, [](const IndexedFont& a, const IndexedFont& b) {
+            return strcmp(a.path, b.path) < 0;
+        });
+        // without reads the fonts are some of the cached ones, all of them unless some were removed
+        if ((read || result->length != cached.length) && !write_font_index_file(index_path, *result)) {
+            TTE_DBG("Failed to write font index: %s", index_path);
+        }
+        free_indexed_fonts(&cached);
+        return *result;
+    }
+
+    void destroy_font_index(FontIndex& font_index) {
+        free_indexed_fonts(&font_index);
+        free(static_cast<void*>(&font_index));
+    }
+
+    Length get_font_count(FontIndex& font_index) { return font_index.length; }
+
+    const char* get_font_path(FontIndex& font_index, const Length index) {
+        TTE_ASSERT(index < font_index.length);
+        return font_index.fonts[index].path;
+    }
+
+    const FontInfo& get_font_info(FontIndex& font_index, const Length index) {
+        TTE_ASSERT(index < font_index.length);
+        return font_index.fonts[index].info;
+    }
+
+    bool has_glyph(const FontInfo& font_info, const U32 codepoint) {
+        return codepoint <= 0xFFFF && (font_info.coverage[codepoint / 8] & (1 << (codepoint % 8))) != 0;
     }
 }}
@@ -0,0 +1,53 @@
+#include <tte/platform_layer/platform_layer.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+
+#include "font_fixture.hpp"
+
+TEST(file, mappedBytesAreTheFile) {
+    const std::string path = get_temporary_path("mapped.bin");
+    // more than a page, with every byte value
+    std::string content;
+    for (tte::Length i = 0; i < 3 * 4096 + 17; ++i) {
+        content += static_cast<char>(i * 7 % 256);
+    }
+    write_file(path, content);
+
+    tte::platform_layer::FileIter file_iter;
+    ASSERT_TRUE(tte::platform_layer::map_file(path.c_str(), &file_iter));
+    ASSERT_EQ(file_iter.at, file_iter.begin);
+    tte::Length size;
+    tte::U8* data = tte::platform_layer::read_file(path.c_str(), &size);
+    ASSERT_TRUE(data);
+    ASSERT_EQ(file_iter.size, size);
+    ASSERT_EQ(std::string(reinterpret_cast<const char*>(file_iter.begin), file_iter.size),
+        std::string(reinterpret_cast<const char*>(data), size));
+    free(data);
+    tte::platform_layer::unmap_file(&file_iter);
+    ASSERT_FALSE(file_iter.begin);
+    ASSERT_EQ(file_iter.size, 0u);
+}
+
+TEST(file, emptyFileIsNotMapped) {
+    const std::string path = get_temporary_path("empty.bin");
+    write_file(path, "");
+    tte::platform_layer::FileIter file_iter;
+    ASSERT_FALSE(tte::platform_layer::map_file(path.c_str(), &file_iter));
+}
+
+TEST(file, directoryIsNotMapped) {
+    const std::string path = get_temporary_path("directory");
+    mkdir(path.c_str(), 0755);
+    tte::platform_layer::FileIter file_iter;
+    ASSERT_FALSE(tte::platform_layer::map_file(path.c_str(), &file_iter));
+}
+
+TEST(file, missingFileIsNotMapped) {
+    const std::string path = get_temporary_path("missing.bin");
+    remove(path.c_str());
+    tte::platform_layer::FileIter file_iter;
+    ASSERT_FALSE(tte::platform_layer::map_file(path.c_str(), &file_iter));
+}
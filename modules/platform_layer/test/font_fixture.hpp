@@ -0,0 +1,254 @@
+#pragma once
+
+#include <tte/common/number_types.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// a small font built in memory for the ttf tests, with the tables ttf_common.cpp reads and no more
+
+// a path in the test's temporary directory
+[[nodiscard]] inline std::string get_temporary_path(const char* name) { return testing::TempDir() + name; }
+
+// writes content to path
+inline void write_file(const std::string& path, const std::string& content) {
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+    ASSERT_EQ(fclose(file), 0);
+}
+
+inline void append_16(std::string& data, const tte::U32 value) {
+    data += static_cast<char>((value >> 8) & 0xFF);
+    data += static_cast<char>(value & 0xFF);
+}
+
+inline void append_32(std::string& data, const tte::U32 value) {
+    append_16(data, value >> 16);
+    append_16(data, value & 0xFFFF);
+}
+
+// a point of a glyph in font units, y up
+struct FixturePoint {
+    tte::S16 x;
+    tte::S16 y;
+};
+
+// a component of a compound glyph, the glyph moved by x and y in font units
+struct FixtureComponent {
+    tte::U16 glyph_id;
+    tte::S16 x;
+    tte::S16 y;
+};
+
+// a simple glyph with a contour through the points of each contour, all of them on the curve
+[[nodiscard]] inline std::string make_simple_glyph(const std::vector<std::vector<FixturePoint>>& contours) {
+    std::vector<FixturePoint> points;
+    for (const std::vector<FixturePoint>& contour : contours) {
+        points.insert(points.end(), contour.begin(), contour.end());
+    }
+    std::string result;
+    append_16(result, static_cast<tte::U16>(contours.size()));
+    // the bounding box, which is not read
+    append_32(result, 0);
+    append_32(result, 0);
+    tte::U32 end_point = 0;
+    for (const std::vector<FixturePoint>& contour : contours) {
+        end_point += static_cast<tte::U32>(contour.size());
+        append_16(result, end_point - 1);
+    }
+    // no instructions
+    append_16(result, 0);
+    // on the curve, each coordinate a 16 bit delta from the last
+    result.append(points.size(), '\x01');
+    tte::S16 last = 0;
+    for (const FixturePoint& point : points) {
+        append_16(result, static_cast<tte::U16>(point.x - last));
+        last = point.x;
+    }
+    last = 0;
+    for (const FixturePoint& point : points) {
+        append_16(result, static_cast<tte::U16>(point.y - last));
+        last = point.y;
+    }
+    return result;
+}
+
+// a rectangle from x0, y0 to x1, y1
+[[nodiscard]] inline std::string make_rectangle_glyph(
+    const tte::S16 x0, const tte::S16 y0, const tte::S16 x1, const tte::S16 y1) {
+    return make_simple_glyph({{{x0, y0}, {x0, y1}, {x1, y1}, {x1, y0}}});
+}
+
+[[nodiscard]] inline std::string make_compound_glyph(const std::vector<FixtureComponent>& components) {
+    // arg_1_and_2_are_words, args_are_xy_values and more_components
+    static const constexpr tte::U16 flags = 0x3;
+    static const constexpr tte::U16 more_components = 0x20;
+    std::string result;
+    append_16(result, 0xFFFF);
+    append_32(result, 0);
+    append_32(result, 0);
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        append_16(result, i + 1 < components.size() ? flags | more_components : flags);
+        append_16(result, components[i].glyph_id);
+        append_16(result, static_cast<tte::U16>(components[i].x));
+        append_16(result, static_cast<tte::U16>(components[i].y));
+    }
+    return result;
+}
+
+// the options of make_font
+struct FixtureFont {
+    // glyph 0 is the missing glyph, and the character 'A' + i is glyph i + 1
+    std::vector<std::string> glyphs;
+    tte::U16 units_per_em = 1024;
+    const char* family = "Fixture";
+    const char* subfamily = "Regular";
+    bool monospaced = false;
+};
+
+// a table of the font, its tag and data
+struct FixtureTable {
+    const char* tag;
+    std::string data;
+};
+
+// the name table with the family and subfamily, in utf-16 big endian on the microsoft platform in english
+[[nodiscard]] inline std::string make_name_table(const char* family, const char* subfamily) {
+    const std::string names[] = {family, subfamily};
+    std::string result;
+    append_16(result, 0);
+    append_16(result, 2);
+    append_16(result, 6 + 12 * 2);
+    tte::U32 offset = 0;
+    for (tte::U32 i = 0; i < 2; ++i) {
+        append_16(result, 3);
+        append_16(result, 1);
+        append_16(result, 0x409);
+        append_16(result, i + 1);
+        append_16(result, static_cast<tte::U32>(names[i].size() * 2));
+        append_16(result, offset);
+        offset += static_cast<tte::U32>(names[i].size() * 2);
+    }
+    for (const std::string& name : names) {
+        for (const char character : name) {
+            append_16(result, static_cast<tte::U8>(character));
+        }
+    }
+    return result;
+}
+
+// the bytes of a font file
+[[nodiscard]] inline std::string make_font(const FixtureFont& font) {
+    const tte::U32 num_glyphs = static_cast<tte::U32>(font.glyphs.size());
+    std::vector<FixtureTable> tables;
+
+    // a segment for 'A' onwards and the last segment, which must end at 0xFFFF
+    std::string cmap;
+    append_16(cmap, 0);
+    append_16(cmap, 1);
+    append_16(cmap, 3);
+    append_16(cmap, 1);
+    append_32(cmap, 12);
+    const tte::U32 last_character = 'A' + std::max<tte::U32>(num_glyphs, 2) - 2;
+    append_16(cmap, 4);
+    append_16(cmap, 16 + 8 * 2);
+    append_16(cmap, 0);
+    append_16(cmap, 2 * 2);
+    append_16(cmap, 4);
+    append_16(cmap, 1);
+    append_16(cmap, 0);
+    append_16(cmap, last_character);
+    append_16(cmap, 0xFFFF);
+    append_16(cmap, 0);
+    append_16(cmap, 'A');
+    append_16(cmap, 0xFFFF);
+    append_16(cmap, (1 - 'A') & 0xFFFF);
+    append_16(cmap, 1);
+    append_16(cmap, 0);
+    append_16(cmap, 0);
+    tables.push_back({"cmap", cmap});
+
+    std::string glyf;
+    std::string loca;
+    for (const std::string& glyph : font.glyphs) {
+        append_32(loca, static_cast<tte::U32>(glyf.size()));
+        glyf += glyph;
+    }
+    append_32(loca, static_cast<tte::U32>(glyf.size()));
+    tables.push_back({"glyf", glyf});
+
+    std::string head;
+    append_32(head, 0x00010000);
+    append_32(head, 0x00010000);
+    append_32(head, 0);
+    append_32(head, 0x5F0F3CF5);
+    append_16(head, 0);
+    append_16(head, font.units_per_em);
+    head.append(16, '\0');
+    append_16(head, 0);
+    append_16(head, 0);
+    append_16(head, font.units_per_em);
+    append_16(head, font.units_per_em);
+    append_16(head, 0);
+    append_16(head, 8);
+    append_16(head, 2);
+    // long loca offsets, so glyphs can be any length
+    append_16(head, 1);
+    append_16(head, 0);
+    tables.push_back({"head", head});
+
+    std::string hhea;
+    append_32(hhea, 0x00010000);
+    append_16(hhea, font.units_per_em * 3u / 4u);
+    append_16(hhea, (0x10000u - font.units_per_em / 4u) & 0xFFFFu);
+    append_16(hhea, 0);
+    append_16(hhea, font.units_per_em);
+    hhea.append(22, '\0');
+    append_16(hhea, 1);
+    tables.push_back({"hhea", hhea});
+
+    std::string hmtx;
+    append_16(hmtx, font.units_per_em);
+    append_16(hmtx, 0);
+    tables.push_back({"hmtx", hmtx});
+    tables.push_back({"loca", loca});
+
+    std::string maxp;
+    append_32(maxp, 0x00010000);
+    append_16(maxp, num_glyphs);
+    maxp.append(26, '\0');
+    tables.push_back({"maxp", maxp});
+    tables.push_back({"name", make_name_table(font.family, font.subfamily)});
+
+    std::string post;
+    append_32(post, 0x00030000);
+    post.append(8, '\0');
+    append_32(post, font.monospaced ? 1 : 0);
+    post.append(16, '\0');
+    tables.push_back({"post", post});
+
+    std::string result;
+    append_32(result, 0x00010000);
+    append_16(result, static_cast<tte::U32>(tables.size()));
+    append_16(result, 8 * 16);
+    append_16(result, 3);
+    append_16(result, static_cast<tte::U32>(tables.size()) * 16 - 8 * 16);
+    // the tables after the directory, each 4 byte aligned
+    tte::U32 offset = static_cast<tte::U32>(12 + 16 * tables.size());
+    for (const FixtureTable& table : tables) {
+        append_32(result, static_cast<tte::U32>(table.tag[0]) << 24 | static_cast<tte::U32>(table.tag[1]) << 16 |
+                static_cast<tte::U32>(table.tag[2]) << 8 | static_cast<tte::U32>(table.tag[3]));
+        append_32(result, 0);
+        append_32(result, offset);
+        append_32(result, static_cast<tte::U32>(table.data.size()));
+        offset += (static_cast<tte::U32>(table.data.size()) + 3) & ~3u;
+    }
+    for (const FixtureTable& table : tables) {
+        result += table.data;
+        result.append((4 - table.data.size() % 4) % 4, '\0');
+    }
+    return result;
+}
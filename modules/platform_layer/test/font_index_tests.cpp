@@ -0,0 +1,142 @@
+#include <tte/platform_layer/platform_layer.hpp>
+#include <tte/platform_layer/ttf.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+
+#include "font_fixture.hpp"
+
+// the directory of fonts and its index for a test, with the index of an earlier run removed
+struct FontIndexDirectory {
+    std::string path;
+    std::string font_path;
+    std::string index_path;
+};
+
+[[nodiscard]] static FontIndexDirectory make_font_directory(const char* name) {
+    FontIndexDirectory result;
+    result.path = get_temporary_path(name);
+    mkdir(result.path.c_str(), 0755);
+    result.font_path = result.path + "/fixture.ttf";
+    result.index_path = result.path + ".index";
+    remove(result.index_path.c_str());
+    return result;
+}
+
+// a font whose family is family, the same size for families of the same length
+[[nodiscard]] static std::string make_family_font(const char* family) {
+    FixtureFont font;
+    font.glyphs = {"", make_rectangle_glyph(0, 0, 512, 512)};
+    font.family = family;
+    return make_font(font);
+}
+
+static void set_modification_time(const std::string& path, const time_t seconds, const long nanoseconds) {
+    timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = seconds;
+    times[1].tv_nsec = nanoseconds;
+    ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+}
+
+// the family of the only font of the directory, empty if it has none
+[[nodiscard]] static std::string load_family(const FontIndexDirectory& directory) {
+    tte::ttf::FontIndex& font_index = tte::ttf::load_font_index(directory.path.c_str(), directory.index_path.c_str());
+    const std::string result =
+        tte::ttf::get_font_count(font_index) == 1 ? tte::ttf::get_font_info(font_index, 0).family : "";
+    tte::ttf::destroy_font_index(font_index);
+    return result;
+}
+
+[[nodiscard]] static std::string read_index(const FontIndexDirectory& directory) {
+    tte::Length size;
+    tte::U8* data = tte::platform_layer::read_file(directory.index_path.c_str(), &size);
+    std::string result = data ? std::string(reinterpret_cast<const char*>(data), size) : "";
+    free(data);
+    return result;
+}
+
+TEST(fontIndex, isWrittenOnFirstLoad) {
+    const FontIndexDirectory directory = make_font_directory("first_load");
+    write_file(directory.font_path, make_family_font("Fixture"));
+    tte::ttf::FontIndex& font_index = tte::ttf::load_font_index(directory.path.c_str(), directory.index_path.c_str());
+    ASSERT_EQ(tte::ttf::get_font_count(font_index), 1u);
+    ASSERT_EQ(std::string(tte::ttf::get_font_path(font_index, 0)), directory.font_path);
+    const tte::ttf::FontInfo& info = tte::ttf::get_font_info(font_index, 0);
+    ASSERT_STREQ(info.family, "Fixture");
+    ASSERT_STREQ(info.subfamily, "Regular");
+    ASSERT_EQ(info.units_per_em, 1024);
+    ASSERT_EQ(info.num_glyphs, 2);
+    ASSERT_TRUE(tte::ttf::has_glyph(info, 'A'));
+    ASSERT_FALSE(tte::ttf::has_glyph(info, 'B'));
+    tte::ttf::destroy_font_index(font_index);
+    // the header and the font
+    ASSERT_GT(read_index(directory).size(), sizeof(tte::ttf::FontInfo));
+}
+
+TEST(fontIndex, secondLoadReusesIndexWithoutReadingFont) {
+    const FontIndexDirectory directory = make_font_directory("second_load");
+    const std::string font = make_family_font("Fixture");
+    write_file(directory.font_path, font);
+    set_modification_time(directory.font_path, 1000, 500);
+    ASSERT_EQ(load_family(directory), "Fixture");
+
+    // not a font any more, but of the same size and modification time, so it is not read
+    write_file(directory.font_path, std::string(font.size(), 'x'));
+    set_modification_time(directory.font_path, 1000, 500);
+    const std::string index = read_index(directory);
+    ASSERT_EQ(load_family(directory), "Fixture");
+    // and nothing changed to write
+    ASSERT_EQ(read_index(directory), index);
+}
+
+TEST(fontIndex, changedFontIsReadAgain) {
+    const FontIndexDirectory directory = make_font_directory("changed");
+    write_file(directory.font_path, make_family_font("Fixture"));
+    set_modification_time(directory.font_path, 1000, 0);
+    ASSERT_EQ(load_family(directory), "Fixture");
+
+    // the same size, modified within the same second
+    write_file(directory.font_path, make_family_font("Changed"));
+    set_modification_time(directory.font_path, 1000, 1);
+    ASSERT_EQ(load_family(directory), "Changed");
+
+    // the same modification time, another size
+    write_file(directory.font_path, make_family_font("Resized font"));
+    set_modification_time(directory.font_path, 1000, 1);
+    ASSERT_EQ(load_family(directory), "Resized font");
+}
+
+TEST(fontIndex, invalidIndexIsIgnored) {
+    const FontIndexDirectory directory = make_font_directory("invalid");
+    // magic, version
+    const tte::Length version_offset = sizeof(tte::U32);
+    for (tte::Length i = 0; i < 3; ++i) {
+        remove(directory.index_path.c_str());
+        write_file(directory.font_path, make_family_font("Fixture"));
+        set_modification_time(directory.font_path, 1000, 0);
+        ASSERT_EQ(load_family(directory), "Fixture");
+        std::string index = read_index(directory);
+        if (i == 0) {
+            index.resize(index.size() / 2);
+        } else if (i == 1) {
+            index[0] = static_cast<char>(~index[0]);
+        } else {
+            tte::U32 version;
+            memcpy(&version, index.data() + version_offset, sizeof(version));
+            ++version;
+            memcpy(&index[version_offset], &version, sizeof(version));
+        }
+        write_file(directory.index_path, index);
+
+        // read again, as the index does not have it
+        write_file(directory.font_path, make_family_font("Changed"));
+        set_modification_time(directory.font_path, 1000, 0);
+        ASSERT_EQ(load_family(directory), "Changed") << i;
+    }
+}
@@ -0,0 +1,157 @@
+#include <tte/platform_layer/platform_layer.hpp>
+#include <tte/platform_layer/ttf.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+// the code shared by the platform layers is built into the tests as it is into each of them (see
+// headless/platform_layer.cpp), so its internal functions can be tested too
+#include "platform_layer_common.cpp"
+#include "ttf_common.cpp"
+
+#include "font_fixture.hpp"
+
+// the glyphs of the fixture font, at 16 pixels per em of 1024 units each unit is 1/64 of a pixel
+static const constexpr float fixture_pixels_per_em = 16.0f;
+static const constexpr tte::U16 rectangle_glyph_id = 1;
+static const constexpr tte::U16 compound_glyph_id = 2;
+static const constexpr tte::U16 decreasing_contour_ends_glyph_id = 3;
+static const constexpr tte::U16 truncated_glyph_id = 4;
+static const constexpr tte::U16 recursive_glyph_id = 5;
+static const constexpr tte::U16 missing_component_glyph_id = 6;
+
+[[nodiscard]] static FixtureFont get_fixture_font() {
+    FixtureFont result;
+    result.glyphs.push_back("");
+    // 8.5 by 8 pixels, on the baseline
+    result.glyphs.push_back(make_rectangle_glyph(0, 0, 544, 512));
+    // the rectangle twice, 16 pixels apart
+    result.glyphs.push_back(make_compound_glyph({{rectangle_glyph_id, 0, 0}, {rectangle_glyph_id, 1024, 0}}));
+    // the end of the second contour before the end of the first
+    std::string decreasing =
+        make_simple_glyph({{{0, 0}, {0, 512}, {512, 512}, {512, 0}}, {{0, 0}, {0, 64}, {64, 64}, {64, 0}}});
+    decreasing[12] = 0;
+    decreasing[13] = 2;
+    result.glyphs.push_back(decreasing);
+    // the last y coordinate cut off
+    const std::string rectangle = make_rectangle_glyph(0, 0, 512, 512);
+    result.glyphs.push_back(rectangle.substr(0, rectangle.size() - 2));
+    result.glyphs.push_back(make_compound_glyph({{recursive_glyph_id, 0, 0}}));
+    result.glyphs.push_back(make_compound_glyph({{rectangle_glyph_id, 0, 0}, {100, 0, 0}}));
+    return result;
+}
+
+[[nodiscard]] static tte::ttf::FontFile* open_fixture_font(const char* name, const FixtureFont& font) {
+    const std::string path = get_temporary_path(name);
+    write_file(path, make_font(font));
+    return tte::ttf::open_font_file(path.c_str());
+}
+
+// the coverage of each row of the bitmap, the same for every row
+[[nodiscard]] static std::string repeat_row(const std::string& row, const tte::U32 height) {
+    std::string result;
+    for (tte::U32 y = 0; y < height; ++y) {
+        result += row;
+    }
+    return result;
+}
+
+[[nodiscard]] static std::string get_coverage(const tte::ttf::GlyphBitmap& bitmap) {
+    const tte::Length size = static_cast<tte::Length>(bitmap.width) * bitmap.height;
+    return std::string(reinterpret_cast<const char*>(bitmap.coverage), size);
+}
+
+TEST(ttf, simpleGlyphRasterisesToItsCoverage) {
+    tte::ttf::FontFile* font_file = open_fixture_font("simple.ttf", get_fixture_font());
+    ASSERT_TRUE(font_file);
+    ASSERT_EQ(tte::ttf::get_glyph_id(*font_file, 'A'), rectangle_glyph_id);
+    tte::ttf::GlyphBitmap bitmap;
+    ASSERT_TRUE(tte::ttf::rasterise_glyph(*font_file, rectangle_glyph_id, fixture_pixels_per_em, &bitmap));
+    ASSERT_EQ(bitmap.width, 9u);
+    ASSERT_EQ(bitmap.height, 8u);
+    ASSERT_EQ(bitmap.left, 0);
+    ASSERT_EQ(bitmap.top, -8);
+    // the half covered column is half of 255, rounded
+    ASSERT_EQ(get_coverage(bitmap), repeat_row(std::string(8, '\xFF') + '\x80', 8));
+    tte::ttf::close_font_file(*font_file);
+}
+
+TEST(ttf, compoundGlyphRasterisesToItsComponents) {
+    tte::ttf::FontFile* font_file = open_fixture_font("compound.ttf", get_fixture_font());
+    ASSERT_TRUE(font_file);
+    ASSERT_EQ(tte::ttf::get_glyph_id(*font_file, 'B'), compound_glyph_id);
+    tte::ttf::GlyphBitmap bitmap;
+    ASSERT_TRUE(tte::ttf::rasterise_glyph(*font_file, compound_glyph_id, fixture_pixels_per_em, &bitmap));
+    ASSERT_EQ(bitmap.width, 25u);
+    ASSERT_EQ(bitmap.height, 8u);
+    ASSERT_EQ(bitmap.left, 0);
+    ASSERT_EQ(bitmap.top, -8);
+    const std::string rectangle = std::string(8, '\xFF') + '\x80';
+    ASSERT_EQ(get_coverage(bitmap), repeat_row(rectangle + std::string(7, '\0') + rectangle, 8));
+    tte::ttf::close_font_file(*font_file);
+}
+
+TEST(ttf, glyphWithNoOutlineHasNoCoverage) {
+    tte::ttf::FontFile* font_file = open_fixture_font("empty.ttf", get_fixture_font());
+    ASSERT_TRUE(font_file);
+    tte::ttf::GlyphBitmap bitmap;
+    ASSERT_TRUE(tte::ttf::rasterise_glyph(*font_file, 0, fixture_pixels_per_em, &bitmap));
+    ASSERT_EQ(bitmap.width, 0u);
+    ASSERT_EQ(bitmap.height, 0u);
+    tte::ttf::close_font_file(*font_file);
+}
+
+TEST(ttf, malformedGlyphsAreNotRasterised) {
+    tte::ttf::FontFile* font_file = open_fixture_font("malformed.ttf", get_fixture_font());
+    ASSERT_TRUE(font_file);
+    const tte::U16 glyph_ids[] = {decreasing_contour_ends_glyph_id,
+        truncated_glyph_id,
+        recursive_glyph_id,
+        missing_component_glyph_id,
+        // past the last glyph
+        static_cast<tte::U16>(get_fixture_font().glyphs.size())};
+    for (const tte::U16 glyph_id : glyph_ids) {
+        tte::ttf::GlyphBitmap bitmap;
+        ASSERT_FALSE(tte::ttf::rasterise_glyph(*font_file, glyph_id, fixture_pixels_per_em, &bitmap)) << glyph_id;
+    }
+    // the font is still usable after them
+    tte::ttf::GlyphBitmap bitmap;
+    ASSERT_TRUE(tte::ttf::rasterise_glyph(*font_file, rectangle_glyph_id, fixture_pixels_per_em, &bitmap));
+    tte::ttf::close_font_file(*font_file);
+}
+
+TEST(ttf, truncatedFontIsNotOpened) {
+    const std::string font = make_font(get_fixture_font());
+    // cut in the directory, in the tables, and before the end of the last table
+    const tte::Length sizes[] = {0, 8, 100, font.size() / 2, font.size() - 4};
+    for (const tte::Length size : sizes) {
+        const std::string path = get_temporary_path("truncated.ttf");
+        write_file(path, font.substr(0, size));
+        tte::ttf::FontFile* font_file = tte::ttf::open_font_file(path.c_str());
+        ASSERT_FALSE(font_file) << size;
+    }
+}
+
+TEST(ttf, sumCoverageIsTheSameWithAndWithoutSSE2) {
+#if TTE_TTF_SSE2
+    // terms of many sizes, each other one mostly taking away the one before as where an edge leaves a row, so the order
+    // they are added in changes the last bits of the sums. of lengths that are and are not a multiple of 4.
+    tte::U32 seed = 1;
+    for (const tte::Length length : {tte::Length{1}, tte::Length{4}, tte::Length{7}, tte::Length{1 << 16} + 3}) {
+        std::vector<float> accumulation(length);
+        for (tte::Length i = 0; i < length; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            const float term =
+                static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) / static_cast<float>(1 << (seed % 8));
+            accumulation[i] = i % 2 == 0 ? term : accumulation[i - 1] * -0.999f + term * 0.001f;
+        }
+        std::vector<tte::U8> scalar(length);
+        std::vector<tte::U8> sse2(length);
+        tte::ttf::sum_coverage_scalar(accumulation.data(), scalar.data(), length);
+        tte::ttf::sum_coverage_sse2(accumulation.data(), sse2.data(), length);
+        ASSERT_EQ(scalar, sse2) << length;
+    }
+#else
+    GTEST_SKIP() << "SSE2 is not available in this build";
+#endif
+}